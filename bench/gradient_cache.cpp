@@ -0,0 +1,162 @@
+// Compares stored and quantized PerlinNoise gradients on a grid that does not fit into the cache.
+// Times random operator() samples and strip fills, and replays the gradient reads of both workloads
+// through a simulated cache hierarchy, so miss rates are available without hardware counters.
+
+#include <perlin.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <cstdint>
+
+
+using GradientSource = PerlinNoiseParameters::GradientSource;
+
+static constexpr int s_grid_size = 4000;
+static constexpr float s_grid_step = 2.0f;
+static constexpr size_t s_random_points = 4'000'000;
+static constexpr size_t s_replayed_points = 1'000'000;
+// the strips cover s_strip_size x s_strip_size pixels, s_strip_width columns at a time like the app's jobs
+static constexpr int s_strip_size = 6000;
+static constexpr int s_strip_width = 8;
+
+namespace {
+  // Set associative LRU cache with 64 byte lines
+  class Cache {
+  public:
+    static constexpr size_t s_line_size = 64;
+    static constexpr size_t s_ways = 8;
+
+    explicit Cache(size_t bytes) : m_sets(bytes / s_line_size / s_ways) {}
+
+    // true on a hit
+    bool access(uint64_t line) {
+      ++m_accesses;
+      auto& set = m_sets[line % m_sets.size()];
+      for (size_t i = 0; i < set.size(); ++i) {
+        if (set[i] == line) {
+          set.erase(set.begin() + std::ptrdiff_t(i));
+          set.insert(set.begin(), line);
+          return true;
+        }
+      }
+
+      ++m_misses;
+      set.insert(set.begin(), line);
+      if (set.size() > s_ways) {
+        set.pop_back();
+      }
+      return false;
+    }
+
+    // in percent of the given number of reads
+    double miss_rate(size_t reads) const {
+      return 100.0 * double(m_misses) / double(reads);
+    }
+
+    size_t m_accesses = 0;
+    size_t m_misses = 0;
+
+  private:
+    std::vector<std::vector<uint64_t>> m_sets;
+  };
+
+  // Typical desktop sizes, a line goes to the next level only when it misses the previous one
+  struct CacheHierarchy {
+    Cache l1{size_t(32) << 10};
+    Cache l2{size_t(1) << 20};
+    Cache l3{size_t(32) << 20};
+
+    void access(uint64_t address) {
+      const uint64_t line = address / Cache::s_line_size;
+      if (!l1.access(line) && !l2.access(line)) {
+        l3.access(line);
+      }
+    }
+  };
+}
+
+// Gradient reads of one sample at the same addresses PerlinNoise uses, the table entry read too for quantized
+static void replay_sample(const PerlinNoise& noise, CacheHierarchy& caches, float x, float y) {
+  const bool quantized = noise.m_parameters.gradient_source == GradientSource::quantized;
+  const uint64_t nodeBytes = quantized ? 1 : 2 * sizeof(float);
+  // the table lives somewhere after the grid
+  const uint64_t tableBase = uint64_t(s_grid_size) * uint64_t(s_grid_size) * nodeBytes + 4096;
+
+  const int cellX = int(x / s_grid_step);
+  const int cellY = int(y / s_grid_step);
+  for (int corner = 0; corner < 4; ++corner) {
+    const uint64_t node = uint64_t(cellY + (corner >> 1)) * uint64_t(s_grid_size) + uint64_t(cellX + (corner & 1));
+    caches.access(node * nodeBytes);
+    if (quantized) {
+      caches.access(tableBase + uint64_t(noise.m_gradient_indices[node]) * 2 * sizeof(float));
+    }
+  }
+}
+
+static void print_misses(const char* name, const CacheHierarchy& caches) {
+  const size_t reads = caches.l1.m_accesses;
+  std::printf("  %s misses per gradient read: L1 %.2f%%, L2 %.2f%%, L3 %.2f%%\n",
+              name, caches.l1.miss_rate(reads), caches.l2.miss_rate(reads), caches.l3.miss_rate(reads));
+}
+
+int main() {
+  std::mt19937 engine(5);
+  std::uniform_real_distribution<float> coordDistr(0.0f, float(s_grid_size - 1) * s_grid_step);
+  std::vector<std::array<float, 2>> points(s_random_points);
+  for (auto& point : points) {
+    point = {coordDistr(engine), coordDistr(engine)};
+  }
+
+  for (GradientSource source : {GradientSource::grid, GradientSource::quantized}) {
+    const PerlinNoise noise(PerlinNoiseParameters{
+      .grid_size_x = s_grid_size,
+      .grid_size_y = s_grid_size,
+      .grid_step_x = s_grid_step,
+      .grid_step_y = s_grid_step,
+      .gradient_source = source
+    }, 1);
+
+    // keeps the evaluations from being optimized out
+    float sink = 0.0f;
+
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& point : points) {
+      sink += noise(point[0], point[1]);
+    }
+    const double randomNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count()
+      / double(points.size());
+
+    std::vector<float> strip(size_t(s_strip_width) * size_t(s_strip_size));
+    start = std::chrono::steady_clock::now();
+    for (int x = 0; x < s_strip_size; x += s_strip_width) {
+      noise.fill(strip, x, 0, s_strip_width, s_strip_size, size_t(s_strip_width));
+      sink += strip[5];
+    }
+    const double stripNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count()
+      / double(s_strip_size) / double(s_strip_size);
+
+    CacheHierarchy randomCaches;
+    for (size_t k = 0; k < s_replayed_points; ++k) {
+      replay_sample(noise, randomCaches, points[k][0], points[k][1]);
+    }
+    CacheHierarchy stripCaches;
+    for (int x = 0; x < s_strip_size; x += s_strip_width) {
+      for (int y = 0; y < s_strip_size; ++y) {
+        for (int i = 0; i < s_strip_width; ++i) {
+          replay_sample(noise, stripCaches, float(x + i), float(y));
+        }
+      }
+    }
+
+    const bool quantized = source == GradientSource::quantized;
+    const size_t gridBytes = quantized ? noise.m_gradient_indices.size() : noise.m_grid_data.size() * sizeof(float);
+    std::printf("%s gradients, %zu MB (checksum %g)\n", quantized ? "quantized" : "stored", gridBytes >> 20, double(sink));
+    std::printf("  random operator() samples: %.1f ns/sample\n", randomNs);
+    print_misses("random", randomCaches);
+    std::printf("  %d column strip fill: %.2f ns/px\n", s_strip_width, stripNs);
+    print_misses("strip", stripCaches);
+  }
+}
@@ -0,0 +1,333 @@
+#include "blue_noise.hpp"
+
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <algorithm>
+#include <parallel.hpp>
+#include <gradients.hpp>
+
+
+static constexpr int s_tile_size = 8; // pixels of a tile side, the extremes are kept per tile
+static constexpr float s_kernel_radius_sigmas = 3.0f;
+static constexpr size_t s_min_tiles_per_thread = 64;
+static constexpr uint32_t s_ranks_per_progress = 1 << 12;
+static constexpr uint32_t s_no_pixel = std::numeric_limits<uint32_t>::max();
+
+namespace {
+  // Largest void and tightest cluster of a part of the field. Ties go to the lower pixel index,
+  // so the result does not depend on the order of the scans
+  struct Extremes {
+    float void_energy = std::numeric_limits<float>::infinity();
+    uint32_t void_pixel = s_no_pixel;
+    float cluster_energy = -std::numeric_limits<float>::infinity();
+    uint32_t cluster_pixel = s_no_pixel;
+
+    void add_void(float energy, uint32_t pixel) {
+      if (energy < void_energy || (energy == void_energy && pixel < void_pixel)) {
+        void_energy = energy;
+        void_pixel = pixel;
+      }
+    }
+
+    void add_cluster(float energy, uint32_t pixel) {
+      if (energy > cluster_energy || (energy == cluster_energy && pixel < cluster_pixel)) {
+        cluster_energy = energy;
+        cluster_pixel = pixel;
+      }
+    }
+
+    void add(const Extremes& other) {
+      if (other.void_pixel != s_no_pixel) {
+        add_void(other.void_energy, other.void_pixel);
+      }
+      if (other.cluster_pixel != s_no_pixel) {
+        add_cluster(other.cluster_energy, other.cluster_pixel);
+      }
+    }
+  };
+
+  // Toroidal gaussian filtered binary pattern. Setting or clearing a pixel adds or subtracts the kernel around it,
+  // only the tiles the kernel touched are scanned again, and their rows of tiles, before the next search
+  class EnergyField {
+  public:
+    EnergyField(int width, int height, float sigma)
+    : m_width(width)
+    , m_height(height)
+    , m_radius(std::max(1, int(std::ceil(sigma * s_kernel_radius_sigmas))))
+    , m_tiles_x((width + s_tile_size - 1) / s_tile_size)
+    , m_tiles_y((height + s_tile_size - 1) / s_tile_size)
+    , m_energy(size_t(width) * size_t(height), 0.0f)
+    , m_pattern(size_t(width) * size_t(height), 0)
+    , m_tiles(size_t(m_tiles_x) * size_t(m_tiles_y))
+    , m_tile_rows(size_t(m_tiles_y))
+    , m_dirty_tiles(m_tiles.size(), 0)
+    , m_dirty_tile_rows(m_tile_rows.size(), 0) {
+      const int side = 2 * m_radius + 1;
+      m_kernel.resize(size_t(side) * size_t(side));
+      for (int dy = -m_radius; dy <= m_radius; ++dy) {
+        for (int dx = -m_radius; dx <= m_radius; ++dx) {
+          m_kernel[size_t(dy + m_radius) * size_t(side) + size_t(dx + m_radius)] =
+            std::exp(-float(dx * dx + dy * dy) / (2.0f * sigma * sigma));
+        }
+      }
+    }
+
+    bool is_set(uint32_t pixel) const {
+      return m_pattern[pixel] != 0;
+    }
+
+    void set(uint32_t pixel, bool value) {
+      if (is_set(pixel) == value) {
+        return;
+      }
+      m_pattern[pixel] = value ? 1 : 0;
+      splat(pixel, value ? 1.0f : -1.0f);
+    }
+
+    // Zero pixel with the lowest energy
+    uint32_t largest_void() {
+      return find().void_pixel;
+    }
+
+    // Set pixel with the highest energy
+    uint32_t tightest_cluster() {
+      return find().cluster_pixel;
+    }
+
+    // Scans every tile, tiles are split between threads
+    void rescan(int threads) {
+      parallel::for_ranges(m_tiles.size(), s_min_tiles_per_thread, threads, [this](size_t begin, size_t end) {
+        for (size_t tile = begin; tile < end; ++tile) {
+          m_tiles[tile] = scan_tile(tile);
+        }
+      });
+
+      for (size_t row = 0; row < m_tile_rows.size(); ++row) {
+        m_tile_rows[row] = scan_tile_row(row);
+      }
+      std::fill(m_dirty_tiles.begin(), m_dirty_tiles.end(), 0);
+      std::fill(m_dirty_tile_rows.begin(), m_dirty_tile_rows.end(), 0);
+      m_dirty_list.clear();
+    }
+
+  private:
+    int wrap(int value, int size) const {
+      const int result = value % size;
+      return result < 0 ? result + size : result;
+    }
+
+    void splat(uint32_t pixel, float sign) {
+      const int cx = int(pixel % uint32_t(m_width));
+      const int cy = int(pixel / uint32_t(m_width));
+      const int side = 2 * m_radius + 1;
+      m_wrapped_x.resize(size_t(side));
+      for (int dx = -m_radius; dx <= m_radius; ++dx) {
+        m_wrapped_x[size_t(dx + m_radius)] = wrap(cx + dx, m_width);
+      }
+
+      for (int dy = -m_radius; dy <= m_radius; ++dy) {
+        const int y = wrap(cy + dy, m_height);
+        float* row = m_energy.data() + size_t(y) * size_t(m_width);
+        const float* weights = m_kernel.data() + size_t(dy + m_radius) * size_t(side);
+        for (int i = 0; i < side; ++i) {
+          row[m_wrapped_x[size_t(i)]] += sign * weights[i];
+        }
+        // whole rows of the kernel fall into the same row of tiles, their tiles are marked once per column
+        if (dy == -m_radius || y % s_tile_size == 0) {
+          for (int i = 0; i < side; ++i) {
+            if (i == 0 || m_wrapped_x[size_t(i)] % s_tile_size == 0) {
+              mark_dirty(size_t(y / s_tile_size) * size_t(m_tiles_x) + size_t(m_wrapped_x[size_t(i)] / s_tile_size));
+            }
+          }
+        }
+      }
+    }
+
+    void mark_dirty(size_t tile) {
+      if (m_dirty_tiles[tile] == 0) {
+        m_dirty_tiles[tile] = 1;
+        m_dirty_list.push_back(tile);
+      }
+    }
+
+    Extremes scan_tile(size_t tile) const {
+      const int x0 = int(tile % size_t(m_tiles_x)) * s_tile_size;
+      const int y0 = int(tile / size_t(m_tiles_x)) * s_tile_size;
+      const int x1 = std::min(x0 + s_tile_size, m_width);
+      const int y1 = std::min(y0 + s_tile_size, m_height);
+      // pixels go in increasing order, so keeping the first of equal energies is the lower index.
+      // Updates are rare, the branches are well predicted
+      Extremes result;
+      for (int y = y0; y < y1; ++y) {
+        for (int x = x0; x < x1; ++x) {
+          const uint32_t pixel = uint32_t(y) * uint32_t(m_width) + uint32_t(x);
+          const float energy = m_energy[pixel];
+          const bool set = m_pattern[pixel] != 0;
+          const float voidEnergy = set ? std::numeric_limits<float>::infinity() : energy;
+          const float clusterEnergy = set ? energy : -std::numeric_limits<float>::infinity();
+          if (voidEnergy < result.void_energy) {
+            result.void_energy = voidEnergy;
+            result.void_pixel = pixel;
+          }
+          if (clusterEnergy > result.cluster_energy) {
+            result.cluster_energy = clusterEnergy;
+            result.cluster_pixel = pixel;
+          }
+        }
+      }
+      return result;
+    }
+
+    Extremes scan_tile_row(size_t row) const {
+      Extremes result;
+      for (size_t tile = row * size_t(m_tiles_x); tile < (row + 1) * size_t(m_tiles_x); ++tile) {
+        result.add(m_tiles[tile]);
+      }
+      return result;
+    }
+
+    Extremes find() {
+      for (const size_t tile : m_dirty_list) {
+        m_tiles[tile] = scan_tile(tile);
+        m_dirty_tiles[tile] = 0;
+        m_dirty_tile_rows[tile / size_t(m_tiles_x)] = 1;
+      }
+      m_dirty_list.clear();
+      for (size_t row = 0; row < m_tile_rows.size(); ++row) {
+        if (m_dirty_tile_rows[row] != 0) {
+          m_tile_rows[row] = scan_tile_row(row);
+          m_dirty_tile_rows[row] = 0;
+        }
+      }
+
+      Extremes result;
+      for (const auto& row : m_tile_rows) {
+        result.add(row);
+      }
+      return result;
+    }
+
+    int m_width;
+    int m_height;
+    int m_radius;
+    int m_tiles_x;
+    int m_tiles_y;
+    std::vector<float> m_kernel;
+    std::vector<float> m_energy;
+    std::vector<uint8_t> m_pattern;
+    std::vector<Extremes> m_tiles;
+    std::vector<Extremes> m_tile_rows;
+    std::vector<uint8_t> m_dirty_tiles;
+    std::vector<uint8_t> m_dirty_tile_rows;
+    std::vector<size_t> m_dirty_list;
+    std::vector<int> m_wrapped_x;
+  };
+}
+
+BlueNoise::BlueNoise(const BlueNoiseParameters& parameters, uint64_t seed, const blue_noise_progress_t& progress)
+: m_parameters(parameters)
+, m_seed(seed)
+, m_width(std::max(parameters.size_x, 1))
+, m_height(std::max(parameters.size_y, 1))
+, m_ranks(size_t(m_width) * size_t(m_height), 0) {
+  const uint32_t pixelsCount = uint32_t(m_ranks.size());
+  if (pixelsCount < 2) {
+    return;
+  }
+
+  EnergyField field(m_width, m_height, std::max(m_parameters.sigma, 0.1f));
+
+  // initial pattern: the first pixels of a seeded shuffle
+  const uint32_t initialCount = std::clamp(uint32_t(float(pixelsCount) * m_parameters.initial_density), 1u, pixelsCount - 1);
+  std::vector<uint32_t> order(pixelsCount);
+  std::iota(order.begin(), order.end(), 0u);
+  for (uint32_t i = pixelsCount - 1; i > 0; --i) {
+    std::swap(order[i], order[gradients::counter_random(m_seed, i) % (uint64_t(i) + 1)]);
+  }
+  for (uint32_t i = 0; i < initialCount; ++i) {
+    field.set(order[i], true);
+  }
+  field.rescan(m_parameters.threads);
+
+  // moves the tightest cluster to the largest void until that is the same pixel
+  for (uint32_t i = 0; i < pixelsCount; ++i) {
+    const uint32_t cluster = field.tightest_cluster();
+    field.set(cluster, false);
+    const uint32_t emptiest = field.largest_void();
+    field.set(emptiest, true);
+    if (emptiest == cluster) {
+      break;
+    }
+  }
+  const EnergyField prototype = field;
+
+  // called once per s_ranks_per_progress ranks
+  auto report = [&](uint32_t ranked) {
+    return !progress || ranked % s_ranks_per_progress != 0 || progress(float(ranked) / float(pixelsCount));
+  };
+
+  // ranks of the initial pattern, the tightest cluster is removed and gets the highest remaining rank
+  for (uint32_t ones = initialCount; ones > 0; --ones) {
+    const uint32_t cluster = field.tightest_cluster();
+    field.set(cluster, false);
+    m_ranks[cluster] = ones - 1;
+    if (!report(initialCount - ones + 1)) {
+      return;
+    }
+  }
+
+  // the rest from the largest void on. Past half of the pixels the tightest cluster of the empty pixels
+  // is the same pixel as the largest void, the filtered energies of both patterns add up to a constant
+  field = prototype;
+  for (uint32_t rank = initialCount; rank < pixelsCount; ++rank) {
+    const uint32_t emptiest = field.largest_void();
+    field.set(emptiest, true);
+    m_ranks[emptiest] = rank;
+    if (!report(rank + 1)) {
+      return;
+    }
+  }
+}
+
+uint32_t BlueNoise::rank(int x, int y) const {
+  const int px = ((x % m_width) + m_width) % m_width;
+  const int py = ((y % m_height) + m_height) % m_height;
+  return m_ranks[size_t(py) * size_t(m_width) + size_t(px)];
+}
+
+float BlueNoise::operator()(float x, float y) const {
+  return (float(rank(int(std::floor(x)), int(std::floor(y)))) + 0.5f) / float(m_ranks.size());
+}
+
+template<typename T>
+static void fill_ranks(std::span<T> out, int x0, int y0, int w, int h, size_t stride, auto map) {
+  for (int j = 0; j < h; ++j) {
+    T* row = out.data() + size_t(j) * stride;
+    for (int i = 0; i < w; ++i) {
+      row[i] = map(x0 + i, y0 + j);
+    }
+  }
+}
+
+void BlueNoise::fill(std::span<float> out, int x0, int y0, int w, int h, size_t stride) const {
+  fill_ranks(out, x0, y0, w, h, stride, [this](int x, int y) { return (*this)(float(x), float(y)); });
+}
+
+void BlueNoise::fill_row(std::span<float> out, int x0, int y, int w) const {
+  fill(out, x0, y, w, 1, size_t(w));
+}
+
+void BlueNoise::fill_u8(std::span<uint8_t> out, int x0, int y0, int w, int h, size_t stride) const {
+  const uint64_t pixelsCount = m_ranks.size();
+  fill_ranks(out, x0, y0, w, h, stride, [this, pixelsCount](int x, int y) {
+    return static_cast<uint8_t>(uint64_t(rank(x, y)) * 256u / pixelsCount);
+  });
+}
+
+void BlueNoise::fill_u16(std::span<uint16_t> out, int x0, int y0, int w, int h, size_t stride) const {
+  const uint64_t pixelsCount = m_ranks.size();
+  fill_ranks(out, x0, y0, w, h, stride, [this, pixelsCount](int x, int y) {
+    return static_cast<uint16_t>(uint64_t(rank(x, y)) * 65536u / pixelsCount);
+  });
+}
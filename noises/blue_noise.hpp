@@ -0,0 +1,67 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+
+struct BlueNoiseParameters {
+  int size_x;
+  int size_y;
+
+  // deviation of the gaussian filter of the energy, in pixels. Larger values give smoother, more regular masks
+  float sigma = 1.5f;
+  // share of pixels in the initial pattern
+  float initial_density = 0.1f;
+
+  // threads of the full scans of the energy, 0 uses all hardware threads
+  int threads = 0;
+};
+
+// Gets the share of the pixels ranked so far, in [0, 1]. Returning false stops the ranking
+using blue_noise_progress_t = std::function<bool(float done)>;
+
+// Blue noise threshold map made by the void-and-cluster method. Every pixel gets a distinct rank, the pixels
+// with ranks below k * size_x * size_y form an evenly spread pattern for every k. The map is periodic with its size.
+// The whole map is ranked in the constructor, it depends only on the parameters and the seed
+class BlueNoise {
+public:
+  // The ranks are left incomplete when progress stops the ranking
+  BlueNoise(const BlueNoiseParameters& parameters, uint64_t seed, const blue_noise_progress_t& progress = {});
+
+  // (rank + 0.5) / pixel count, in (0, 1)
+  float operator()(float x, float y) const;
+
+  // Evaluates w x h samples starting at (x0, y0) into out, rows are stride floats apart
+  void fill(std::span<float> out, int x0, int y0, int w, int h, size_t stride) const;
+  void fill_row(std::span<float> out, int x0, int y, int w) const;
+
+  // Ranks scaled to the whole range of the integer type, rank * (max + 1) / pixel count.
+  // Every value is taken by the same count of pixels when the pixel count is a multiple of max + 1
+  void fill_u8(std::span<uint8_t> out, int x0, int y0, int w, int h, size_t stride) const;
+  void fill_u16(std::span<uint16_t> out, int x0, int y0, int w, int h, size_t stride) const;
+
+  int width() const {
+    return m_width;
+  }
+
+  int height() const {
+    return m_height;
+  }
+
+  // rank of every pixel, row by row
+  std::span<const uint32_t> ranks() const {
+    return m_ranks;
+  }
+
+  const BlueNoiseParameters m_parameters;
+  const uint64_t m_seed;
+
+private:
+  uint32_t rank(int x, int y) const;
+
+  int m_width;
+  int m_height;
+  std::vector<uint32_t> m_ranks;
+};
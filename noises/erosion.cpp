@@ -0,0 +1,306 @@
+#include "erosion.hpp"
+
+#include <array>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <parallel.hpp>
+#include <gradients.hpp>
+
+
+// droplets started on a tile in one pass, one per this many pixels of the tile
+static constexpr int s_pixels_per_droplet_in_pass = 16;
+static constexpr int s_min_tile_size = 32;
+// tiles along the shorter side at least, so every phase has tiles for a few threads
+static constexpr int s_min_tiles_per_side = 8;
+static constexpr int s_min_rows_per_thread = 16;
+// time of a droplet step in thermal erosion pixels, only for the progress
+static constexpr float s_droplet_step_cost = 8.0f;
+
+namespace {
+  struct BrushPoint {
+    // from the center pixel, in floats of the heights
+    ptrdiff_t offset;
+    float weight;
+  };
+
+  struct HeightAndGradient {
+    float height;
+    float gradient_x;
+    float gradient_y;
+  };
+
+  // A tile and the pixels its droplets may touch, [x0, x1) x [y0, y1)
+  struct Tile {
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+
+    int window_x0;
+    int window_y0;
+    int window_x1;
+    int window_y1;
+
+    // droplets per pass and the droplets of the tiles before it
+    uint64_t droplets;
+    uint64_t first_droplet;
+  };
+
+  // Tiles of the same parity along x and y are one phase, phases run one after another
+  struct Tiling {
+    std::vector<Tile> tiles;
+    std::array<size_t, 4> phase_ends;
+  };
+
+  class DropletSimulation {
+  public:
+    DropletSimulation(const ErosionParameters& parameters, std::span<float> heights, int width)
+    : m_parameters(parameters)
+    , m_heights(heights.data())
+    , m_width(width)
+    , m_margin(std::max(parameters.erosion_radius, 1)) {
+      const int radius = std::max(m_parameters.erosion_radius, 0);
+      float weightsSum = 0.0f;
+      for (int dy = -radius; dy <= radius; ++dy) {
+        for (int dx = -radius; dx <= radius; ++dx) {
+          const float weight = float(radius + 1) - std::sqrt(float(dx * dx + dy * dy));
+          if (weight > 0.0f) {
+            m_brush.push_back({ ptrdiff_t(dy) * ptrdiff_t(width) + dx, weight });
+            weightsSum += weight;
+          }
+        }
+      }
+      for (auto& point : m_brush) {
+        point.weight /= weightsSum;
+      }
+    }
+
+    // Pixels a droplet touches are at most this far from the one it is in
+    int reach() const {
+      return m_margin;
+    }
+
+    void run(const Tile& tile, float x, float y) const {
+      float directionX = 0.0f;
+      float directionY = 0.0f;
+      float speed = 1.0f;
+      float water = 1.0f;
+      float sediment = 0.0f;
+
+      const float inertia = m_parameters.inertia;
+      for (int step = 0; step < m_parameters.droplet_lifetime && inside(tile, x, y); ++step) {
+        const int cellX = int(x);
+        const int cellY = int(y);
+        const float fx = x - float(cellX);
+        const float fy = y - float(cellY);
+        const HeightAndGradient here = sample(cellX, cellY, fx, fy);
+
+        directionX = directionX * inertia - here.gradient_x * (1.0f - inertia);
+        directionY = directionY * inertia - here.gradient_y * (1.0f - inertia);
+        const float length = std::sqrt(directionX * directionX + directionY * directionY);
+        if (length == 0.0f) {
+          break;
+        }
+        directionX /= length;
+        directionY /= length;
+        x += directionX;
+        y += directionY;
+        if (!inside(tile, x, y)) {
+          break;
+        }
+
+        // positions inside of the window are not negative, truncation is the floor
+        const int nextCellX = int(x);
+        const int nextCellY = int(y);
+        const float heightDelta = sample(nextCellX, nextCellY, x - float(nextCellX), y - float(nextCellY)).height - here.height;
+        const float capacity = std::max(-heightDelta * speed * water * m_parameters.sediment_capacity, m_parameters.min_sediment_capacity);
+        if (sediment > capacity || heightDelta > 0.0f) {
+          // uphill the pit behind is filled, at most up to the new height
+          const float deposit = heightDelta > 0.0f ? std::min(heightDelta, sediment) : (sediment - capacity) * m_parameters.deposit_speed;
+          sediment -= deposit;
+          float* cell = m_heights + size_t(cellY) * size_t(m_width) + size_t(cellX);
+          cell[0] += deposit * (1.0f - fx) * (1.0f - fy);
+          cell[1] += deposit * fx * (1.0f - fy);
+          cell[m_width] += deposit * (1.0f - fx) * fy;
+          cell[m_width + 1] += deposit * fx * fy;
+        } else {
+          // never deeper than the drop, so the droplet does not dig a pit
+          const float amount = std::min((capacity - sediment) * m_parameters.erode_speed, -heightDelta);
+          float* center = m_heights + size_t(cellY) * size_t(m_width) + size_t(cellX);
+          for (const auto& point : m_brush) {
+            center[point.offset] -= amount * point.weight;
+          }
+          sediment += amount;
+        }
+
+        speed = std::sqrt(std::max(speed * speed - heightDelta * m_parameters.gravity, 0.0f));
+        water *= 1.0f - m_parameters.evaporate_speed;
+      }
+    }
+
+  private:
+    bool inside(const Tile& tile, float x, float y) const {
+      return x >= float(tile.window_x0 + m_margin) && x < float(tile.window_x1 - m_margin)
+          && y >= float(tile.window_y0 + m_margin) && y < float(tile.window_y1 - m_margin);
+    }
+
+    HeightAndGradient sample(int cellX, int cellY, float fx, float fy) const {
+      const float* cell = m_heights + size_t(cellY) * size_t(m_width) + size_t(cellX);
+      const float nw = cell[0];
+      const float ne = cell[1];
+      const float sw = cell[m_width];
+      const float se = cell[m_width + 1];
+      return {
+        .height = (nw * (1.0f - fx) + ne * fx) * (1.0f - fy) + (sw * (1.0f - fx) + se * fx) * fy,
+        .gradient_x = (ne - nw) * (1.0f - fy) + (se - sw) * fy,
+        .gradient_y = (sw - nw) * (1.0f - fx) + (se - ne) * fx
+      };
+    }
+
+    const ErosionParameters& m_parameters;
+    float* m_heights;
+    int m_width;
+    int m_margin;
+    std::vector<BrushPoint> m_brush;
+  };
+}
+
+// Tiles are twice the distance a droplet can travel and reach, and their windows extend by half a tile.
+// So the windows of tiles two apart along x or y touch but do not overlap, and the tiles of one parity run at once.
+// With long lifetimes on small fields the tiles are capped so every phase still has a few of them, droplets
+// stop at the edge of the window like at the edge of the field
+static Tiling make_tiles(const ErosionParameters& parameters, int reach, int width, int height) {
+  const int maxTileSize = std::max(s_min_tile_size, std::min(width, height) / s_min_tiles_per_side);
+  const int tileSize = std::clamp(2 * (std::max(parameters.droplet_lifetime, 0) + reach + 1), s_min_tile_size, maxTileSize);
+  const int margin = tileSize / 2;
+  const int tilesX = (width + tileSize - 1) / tileSize;
+  const int tilesY = (height + tileSize - 1) / tileSize;
+
+  Tiling tiling;
+  uint64_t firstDroplet = 0;
+  for (size_t parity = 0; parity < 4; ++parity) {
+    for (int ty = int(parity / 2); ty < tilesY; ty += 2) {
+      for (int tx = int(parity % 2); tx < tilesX; tx += 2) {
+        Tile tile;
+        tile.x0 = tx * tileSize;
+        tile.y0 = ty * tileSize;
+        tile.x1 = std::min(tile.x0 + tileSize, width);
+        tile.y1 = std::min(tile.y0 + tileSize, height);
+        tile.window_x0 = std::max(tile.x0 - margin, 0);
+        tile.window_y0 = std::max(tile.y0 - margin, 0);
+        tile.window_x1 = std::min(tile.x1 + margin, width);
+        tile.window_y1 = std::min(tile.y1 + margin, height);
+        const int area = (tile.x1 - tile.x0) * (tile.y1 - tile.y0);
+        tile.droplets = uint64_t((area + s_pixels_per_droplet_in_pass - 1) / s_pixels_per_droplet_in_pass);
+        tile.first_droplet = firstDroplet;
+        firstDroplet += tile.droplets;
+        tiling.tiles.push_back(tile);
+      }
+    }
+    tiling.phase_ends[parity] = tiling.tiles.size();
+  }
+  return tiling;
+}
+
+// One iteration from `from` into `to`. Every pair of neighbours exchanges the same amount in opposite
+// directions, so the material is kept. The amount is at most an eighth of the excess, a pixel can not
+// give away more than its lower neighbours are missing
+static void thermal_iteration(const float* from, float* to, int width, int height, float talus, float rate, int threads) {
+  const float share = rate / 8.0f;
+  parallel::for_ranges(size_t(height), s_min_rows_per_thread, threads, [=](size_t begin, size_t end) {
+    auto flow = [talus, share](float difference) {
+      return std::copysign(std::max(std::abs(difference) - talus, 0.0f), difference) * share;
+    };
+    for (size_t y = begin; y < end; ++y) {
+      const float* row = from + y * size_t(width);
+      const float* above = y > 0 ? row - width : nullptr;
+      const float* below = y + 1 < size_t(height) ? row + width : nullptr;
+      float* out = to + y * size_t(width);
+      for (int x = 0; x < width; ++x) {
+        const float value = row[x];
+        float change = 0.0f;
+        if (x > 0) {
+          change += flow(row[x - 1] - value);
+        }
+        if (x + 1 < width) {
+          change += flow(row[x + 1] - value);
+        }
+        if (above != nullptr) {
+          change += flow(above[x] - value);
+        }
+        if (below != nullptr) {
+          change += flow(below[x] - value);
+        }
+        out[x] = value + change;
+      }
+    }
+  });
+}
+
+bool erode(const ErosionParameters& parameters, uint64_t seed, std::span<float> heights, int width, int height,
+  const erosion_progress_t& progress) {
+  if (width < 2 || height < 2) {
+    return true;
+  }
+
+  const DropletSimulation simulation(parameters, heights, width);
+  const Tiling tiling = make_tiles(parameters, simulation.reach(), width, height);
+  const std::vector<Tile>& tiles = tiling.tiles;
+  const uint64_t dropletsPerPass = tiles.back().first_droplet + tiles.back().droplets;
+  const uint64_t dropletsCount = uint64_t(std::llround(double(std::max(parameters.droplets_per_pixel, 0.0f)) * double(width) * double(height)));
+  const uint64_t passes = (dropletsCount + dropletsPerPass - 1) / dropletsPerPass;
+  const int thermalIterations = std::max(parameters.thermal_iterations, 0);
+
+  const float passCost = float(dropletsPerPass) * float(std::max(parameters.droplet_lifetime, 0)) * s_droplet_step_cost;
+  const float iterationCost = float(width) * float(height);
+  const float totalCost = float(passes) * passCost + float(thermalIterations) * iterationCost;
+  auto report = [&](float done) {
+    return !progress || progress(totalCost > 0.0f ? std::min(done / totalCost, 1.0f) : 1.0f);
+  };
+
+  for (uint64_t pass = 0; pass < passes; ++pass) {
+    size_t phaseBegin = 0;
+    for (const size_t phaseEnd : tiling.phase_ends) {
+      parallel::for_ranges(phaseEnd - phaseBegin, 1, parameters.threads, [&](size_t begin, size_t end) {
+        for (size_t i = phaseBegin + begin; i < phaseBegin + end; ++i) {
+          const Tile& tile = tiles[i];
+          const uint64_t first = pass * dropletsPerPass + tile.first_droplet;
+          const uint64_t count = std::min(tile.droplets, dropletsCount - std::min(first, dropletsCount));
+          for (uint64_t k = 0; k < count; ++k) {
+            const uint64_t random = gradients::counter_random(seed, first + k);
+            const float u = float(random >> 40) * 0x1p-24f;
+            const float v = float((random >> 16) & 0xffffffu) * 0x1p-24f;
+            simulation.run(tile, float(tile.x0) + u * float(tile.x1 - tile.x0), float(tile.y0) + v * float(tile.y1 - tile.y0));
+          }
+        }
+      });
+      phaseBegin = phaseEnd;
+
+      // reported per phase, so a large field can be stopped soon
+      const uint64_t dropletsDone = phaseEnd < tiles.size() ? tiles[phaseEnd].first_droplet : dropletsPerPass;
+      if (!report((float(pass) + float(dropletsDone) / float(dropletsPerPass)) * passCost)) {
+        return false;
+      }
+    }
+  }
+
+  if (thermalIterations == 0) {
+    return true;
+  }
+
+  std::vector<float> buffer(heights.size());
+  float* from = heights.data();
+  float* to = buffer.data();
+  const float rate = std::clamp(parameters.thermal_rate, 0.0f, 1.0f);
+  bool finished = true;
+  for (int i = 0; i < thermalIterations && finished; ++i) {
+    thermal_iteration(from, to, width, height, parameters.talus, rate, parameters.threads);
+    std::swap(from, to);
+    finished = report(float(passes) * passCost + float(i + 1) * iterationCost);
+  }
+  if (from != heights.data()) {
+    std::copy(buffer.begin(), buffer.end(), heights.begin());
+  }
+  return finished;
+}
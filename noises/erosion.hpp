@@ -0,0 +1,45 @@
+#pragma once
+
+#include <span>
+#include <cstdint>
+#include <functional>
+
+
+struct ErosionParameters {
+  // Hydraulic erosion: droplets start at random pixels and run downhill, picking up sediment where they speed up
+  // and dropping it where they slow down or carry more than they can hold
+  float droplets_per_pixel = 1.0f;
+  // steps of a droplet, it moves by one pixel per step
+  int droplet_lifetime = 30;
+  // 0 follows the slope at once, 1 keeps the first direction
+  float inertia = 0.05f;
+  // sediment a droplet can hold is capacity * speed * water * height drop of the step
+  float sediment_capacity = 4.0f;
+  float min_sediment_capacity = 0.01f;
+  // shares of the missing capacity picked up and of the extra sediment dropped per step
+  float erode_speed = 0.3f;
+  float deposit_speed = 0.3f;
+  float evaporate_speed = 0.01f;
+  float gravity = 4.0f;
+  // pixels around a droplet it erodes, weighted by the distance
+  int erosion_radius = 3;
+
+  // Thermal erosion: material slides to lower neighbour pixels while the height difference is above the talus
+  int thermal_iterations = 0;
+  float talus = 0.01f;
+  // share of the excess over the talus that moves per iteration, in [0, 1]
+  float thermal_rate = 0.5f;
+
+  // 0 uses all hardware threads
+  int threads = 0;
+};
+
+// Gets the share of the work done so far, in [0, 1]. Returning false stops the erosion
+using erosion_progress_t = std::function<bool(float done)>;
+
+// Hydraulic and then thermal erosion of width x height heights stored row by row. Droplets run in parallel
+// on tiles far enough apart that no two droplets touch the same pixels at once, the result depends only on
+// the parameters and the seed. Tiles grow with droplet_lifetime up to an eighth of the shorter side, longer
+// droplets are cut short at the tile window. Returns false if progress stopped the erosion
+bool erode(const ErosionParameters& parameters, uint64_t seed, std::span<float> heights, int width, int height,
+  const erosion_progress_t& progress = {});
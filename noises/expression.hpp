@@ -0,0 +1,358 @@
+#pragma once
+
+#include <span>
+#include <array>
+#include <cmath>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <concepts>
+#include <white.hpp>
+
+
+// Noises combined by arithmetic, e.g. remap(source(a) * 0.7f + source(b) * 0.3f, 0.2f, 0.8f).
+// The whole expression is one type, its fill evaluates the sources for a block of rows into
+// cache sized scratch buffers and combines them straight into the output, so nothing is stored
+// per texture and the memory is passed over once. Sources still use their own block fills
+namespace noise_expression {
+  // Floats of one block of a source, 128 KiB. Fits the L2 cache and leaves enough rows
+  // for the per-column work of the source fills to pay off
+  inline constexpr size_t s_block_size = 1 << 15;
+
+  // Anything with the fill and operator() of PerlinNoise, SimplexNoise, FractalNoise, WorleyNoise.
+  // WhiteNoise gives colors instead and has its own source below
+  template<typename T>
+  concept Noise = requires(const T& noise, std::span<float> out) {
+    noise.fill(out, 0, 0, 1, 1, size_t(1));
+    { noise(0.0f, 0.0f) } -> std::convertible_to<float>;
+  };
+
+  // Nodes evaluate w x h samples starting at (x0, y0) into out with rows stride floats apart.
+  // s_scratch_blocks is the count of w x h buffers the node needs at the scratch pointer
+  template<typename T>
+  concept Expression = requires(const T& node, std::span<float> out, float* scratch) {
+    { T::s_scratch_blocks } -> std::convertible_to<size_t>;
+    node.eval_block(out, size_t(1), scratch, 0, 0, 1, 1);
+    { node.at(0.0f, 0.0f) } -> std::same_as<float>;
+  };
+
+  // Gives every node the interface of a noise, so an expression can be used wherever a noise is,
+  // e.g. as a source of another expression or in a threaded_fill_t
+  template<typename Derived>
+  class Node {
+  public:
+    float operator()(float x, float y) const {
+      return self().at(x, y);
+    }
+
+    // Same values as operator(), rows are stride floats apart
+    void fill(std::span<float> out, int x0, int y0, int w, int h, size_t stride) const {
+      if (w <= 0 || h <= 0) {
+        return;
+      }
+      const int rowsPerBlock = std::clamp(int(s_block_size / size_t(w)), 1, h);
+      const size_t blockSize = size_t(w) * size_t(rowsPerBlock);
+      std::vector<float> scratch(Derived::s_scratch_blocks * blockSize);
+      for (int y = 0; y < h; y += rowsPerBlock) {
+        const int rows = std::min(rowsPerBlock, h - y);
+        self().eval_block(out.subspan(size_t(y) * stride), stride, scratch.data(), x0, y0 + y, w, rows);
+      }
+    }
+
+    void fill_row(std::span<float> out, int x0, int y, int w) const {
+      fill(out, x0, y, w, 1, size_t(w));
+    }
+
+  private:
+    const Derived& self() const {
+      return static_cast<const Derived&>(*this);
+    }
+  };
+
+  template<Noise T>
+  class Source : public Node<Source<T>> {
+  public:
+    static constexpr size_t s_scratch_blocks = 0;
+
+    // The noise is not copied and must outlive the expression
+    explicit Source(const T& noise) : m_noise(&noise) {}
+
+    float at(float x, float y) const {
+      return (*m_noise)(x, y);
+    }
+
+    void eval_block(std::span<float> out, size_t stride, float*, int x0, int y0, int w, int h) const {
+      m_noise->fill(out, x0, y0, w, h, stride);
+    }
+
+  private:
+    const T* m_noise;
+  };
+
+  // Mean of the R, G and B channels of a WhiteNoise, in [0, 1]. The value of a pixel is used in all of it
+  class WhiteSource : public Node<WhiteSource> {
+  public:
+    static constexpr size_t s_scratch_blocks = 0;
+    // colors converted at once, on the stack
+    static constexpr int s_chunk_size = 256;
+
+    // The noise is not copied and must outlive the expression
+    explicit WhiteSource(const WhiteNoise& noise) : m_noise(&noise) {}
+
+    float at(float x, float y) const {
+      return brightness((*m_noise)(int(std::floor(x)), int(std::floor(y))));
+    }
+
+    void eval_block(std::span<float> out, size_t stride, float*, int x0, int y0, int w, int h) const {
+      std::array<uint32_t, s_chunk_size> colors;
+      for (int j = 0; j < h; ++j) {
+        float* row = out.data() + size_t(j) * stride;
+        for (int i = 0; i < w; i += s_chunk_size) {
+          const int count = std::min(s_chunk_size, w - i);
+          m_noise->fill_rgba(colors, x0 + i, y0 + j, count, 1, size_t(count));
+          for (int k = 0; k < count; ++k) {
+            row[i + k] = brightness(colors[size_t(k)]);
+          }
+        }
+      }
+    }
+
+  private:
+    static float brightness(uint32_t color) {
+      const uint32_t sum = (color & 0xffu) + ((color >> 8) & 0xffu) + ((color >> 16) & 0xffu);
+      return float(sum) / (3.0f * 255.0f);
+    }
+
+    const WhiteNoise* m_noise;
+  };
+
+  class Constant : public Node<Constant> {
+  public:
+    static constexpr size_t s_scratch_blocks = 0;
+
+    explicit Constant(float value) : m_value(value) {}
+
+    float at(float, float) const {
+      return m_value;
+    }
+
+    void eval_block(std::span<float> out, size_t stride, float*, int, int, int w, int h) const {
+      for (int j = 0; j < h; ++j) {
+        std::fill_n(out.data() + size_t(j) * stride, w, m_value);
+      }
+    }
+
+    float m_value;
+  };
+
+  struct Add {
+    float operator()(float a, float b) const { return a + b; }
+  };
+
+  struct Subtract {
+    float operator()(float a, float b) const { return a - b; }
+  };
+
+  struct Multiply {
+    float operator()(float a, float b) const { return a * b; }
+  };
+
+  // value * scale + shift
+  struct Affine {
+    float operator()(float value) const { return value * scale + shift; }
+
+    float scale;
+    float shift;
+  };
+
+  struct Clamp {
+    float operator()(float value) const { return std::clamp(value, min, max); }
+
+    float min;
+    float max;
+  };
+
+  template<typename Op, Expression E>
+  class Unary : public Node<Unary<Op, E>> {
+  public:
+    static constexpr size_t s_scratch_blocks = E::s_scratch_blocks;
+
+    Unary(Op op, E operand) : m_op(op), m_operand(std::move(operand)) {}
+
+    float at(float x, float y) const {
+      return m_op(m_operand.at(x, y));
+    }
+
+    void eval_block(std::span<float> out, size_t stride, float* scratch, int x0, int y0, int w, int h) const {
+      m_operand.eval_block(out, stride, scratch, x0, y0, w, h);
+      for (int j = 0; j < h; ++j) {
+        float* row = out.data() + size_t(j) * stride;
+        for (int i = 0; i < w; ++i) {
+          row[i] = m_op(row[i]);
+        }
+      }
+    }
+
+  private:
+    Op m_op;
+    E m_operand;
+  };
+
+  // A constant operand is applied directly instead of being filled into a buffer
+  template<typename Op, Expression L, Expression R>
+  class Binary : public Node<Binary<Op, L, R>> {
+    static constexpr bool s_constant_left = std::same_as<L, Constant>;
+    static constexpr bool s_constant_right = std::same_as<R, Constant>;
+
+  public:
+    static constexpr size_t s_scratch_blocks = s_constant_left ? R::s_scratch_blocks
+      : s_constant_right ? L::s_scratch_blocks
+      : std::max(L::s_scratch_blocks, R::s_scratch_blocks + 1);
+
+    Binary(L left, R right) : m_left(std::move(left)), m_right(std::move(right)) {}
+
+    float at(float x, float y) const {
+      return Op{}(m_left.at(x, y), m_right.at(x, y));
+    }
+
+    void eval_block(std::span<float> out, size_t stride, float* scratch, int x0, int y0, int w, int h) const {
+      if constexpr (s_constant_left) {
+        m_right.eval_block(out, stride, scratch, x0, y0, w, h);
+        transform_rows(out, stride, w, h, [left = m_left.m_value](float right) { return Op{}(left, right); });
+      } else if constexpr (s_constant_right) {
+        m_left.eval_block(out, stride, scratch, x0, y0, w, h);
+        transform_rows(out, stride, w, h, [right = m_right.m_value](float left) { return Op{}(left, right); });
+      } else {
+        // the right operand block goes first in the scratch, its own scratch after it
+        const size_t blockSize = size_t(w) * size_t(h);
+        m_left.eval_block(out, stride, scratch, x0, y0, w, h);
+        m_right.eval_block(std::span(scratch, blockSize), size_t(w), scratch + blockSize, x0, y0, w, h);
+        for (int j = 0; j < h; ++j) {
+          float* row = out.data() + size_t(j) * stride;
+          const float* right = scratch + size_t(j) * size_t(w);
+          for (int i = 0; i < w; ++i) {
+            row[i] = Op{}(row[i], right[i]);
+          }
+        }
+      }
+    }
+
+  private:
+    static void transform_rows(std::span<float> out, size_t stride, int w, int h, auto op) {
+      for (int j = 0; j < h; ++j) {
+        float* row = out.data() + size_t(j) * stride;
+        for (int i = 0; i < w; ++i) {
+          row[i] = op(row[i]);
+        }
+      }
+    }
+
+    L m_left;
+    R m_right;
+  };
+
+  // if_true where mask >= threshold, if_false elsewhere. Both branches are evaluated
+  template<Expression M, Expression T, Expression F>
+  class Select : public Node<Select<M, T, F>> {
+  public:
+    static constexpr size_t s_scratch_blocks = std::max({
+      M::s_scratch_blocks, T::s_scratch_blocks + 1, F::s_scratch_blocks + 2
+    });
+
+    Select(M mask, float threshold, T if_true, F if_false)
+    : m_mask(std::move(mask)), m_threshold(threshold), m_if_true(std::move(if_true)), m_if_false(std::move(if_false)) {}
+
+    float at(float x, float y) const {
+      const float mask = m_mask.at(x, y);
+      const float ifTrue = m_if_true.at(x, y);
+      const float ifFalse = m_if_false.at(x, y);
+      return mask >= m_threshold ? ifTrue : ifFalse;
+    }
+
+    void eval_block(std::span<float> out, size_t stride, float* scratch, int x0, int y0, int w, int h) const {
+      const size_t blockSize = size_t(w) * size_t(h);
+      float* ifTrue = scratch;
+      float* ifFalse = scratch + blockSize;
+      m_mask.eval_block(out, stride, scratch, x0, y0, w, h);
+      m_if_true.eval_block(std::span(ifTrue, blockSize), size_t(w), scratch + blockSize, x0, y0, w, h);
+      m_if_false.eval_block(std::span(ifFalse, blockSize), size_t(w), scratch + 2 * blockSize, x0, y0, w, h);
+      for (int j = 0; j < h; ++j) {
+        float* row = out.data() + size_t(j) * stride;
+        const size_t first = size_t(j) * size_t(w);
+        for (int i = 0; i < w; ++i) {
+          row[i] = row[i] >= m_threshold ? ifTrue[first + size_t(i)] : ifFalse[first + size_t(i)];
+        }
+      }
+    }
+
+  private:
+    M m_mask;
+    float m_threshold;
+    T m_if_true;
+    F m_if_false;
+  };
+
+  template<Noise T>
+  Source<T> source(const T& noise) {
+    return Source<T>(noise);
+  }
+
+  inline WhiteSource source(const WhiteNoise& noise) {
+    return WhiteSource(noise);
+  }
+
+  // Lets floats and expressions be mixed in the operators
+  template<typename T>
+  auto as_expression(T value) {
+    if constexpr (Expression<T>) {
+      return value;
+    } else {
+      return Constant(float(value));
+    }
+  }
+
+  template<typename A, typename B>
+  concept Operands = (Expression<A> && (Expression<B> || std::convertible_to<B, float>))
+                  || (std::convertible_to<A, float> && Expression<B>);
+
+  template<typename A, typename B> requires Operands<A, B>
+  auto operator+(A a, B b) {
+    return Binary<Add, decltype(as_expression(a)), decltype(as_expression(b))>(as_expression(a), as_expression(b));
+  }
+
+  template<typename A, typename B> requires Operands<A, B>
+  auto operator-(A a, B b) {
+    return Binary<Subtract, decltype(as_expression(a)), decltype(as_expression(b))>(as_expression(a), as_expression(b));
+  }
+
+  template<typename A, typename B> requires Operands<A, B>
+  auto operator*(A a, B b) {
+    return Binary<Multiply, decltype(as_expression(a)), decltype(as_expression(b))>(as_expression(a), as_expression(b));
+  }
+
+  template<Expression E>
+  auto operator-(E e) {
+    return Unary<Affine, E>(Affine{.scale = -1.0f, .shift = 0.0f}, std::move(e));
+  }
+
+  // Linear map of [from_min, from_max] to [to_min, to_max], values outside are not clamped
+  template<Expression E>
+  auto remap(E e, float from_min, float from_max, float to_min = 0.0f, float to_max = 1.0f) {
+    const float scale = (to_max - to_min) / (from_max - from_min);
+    return Unary<Affine, E>(Affine{.scale = scale, .shift = to_min - from_min * scale}, std::move(e));
+  }
+
+  template<Expression E>
+  auto clamp(E e, float min = 0.0f, float max = 1.0f) {
+    return Unary<Clamp, E>(Clamp{.min = min, .max = max}, std::move(e));
+  }
+
+  template<typename M, typename T, typename F>
+    requires Expression<M> && (Expression<T> || std::convertible_to<T, float>) && (Expression<F> || std::convertible_to<F, float>)
+  auto select(M mask, float threshold, T if_true, F if_false) {
+    return Select<M, decltype(as_expression(if_true)), decltype(as_expression(if_false))>(
+        std::move(mask), threshold, as_expression(if_true), as_expression(if_false));
+  }
+}
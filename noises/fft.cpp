@@ -0,0 +1,183 @@
+#include "fft.hpp"
+
+#include <bit>
+#include <cmath>
+#include <numbers>
+#include <algorithm>
+#include <parallel.hpp>
+
+
+using complex_t = fft::complex_t;
+
+// columns gathered into contiguous buffers at once, 8 complex numbers are a cache line
+static constexpr size_t s_column_block = 8;
+static constexpr size_t s_min_rows_per_thread = 16;
+
+// Plain product, the operator of std::complex checks for infinities and NaNs in a library call
+static complex_t mul(complex_t a, complex_t b) {
+  return complex_t(a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real());
+}
+
+static complex_t calc_unit_root(size_t k, size_t n, bool inverse) {
+  const double angle = (inverse ? 2.0 : -2.0) * std::numbers::pi * double(k) / double(n);
+  return complex_t(float(std::cos(angle)), float(std::sin(angle)));
+}
+
+fft::Plan::Plan(size_t size)
+: m_size(size)
+, m_twiddles(size / 2)
+, m_bit_reversed(size) {
+  for (size_t k = 0; k < m_twiddles.size(); ++k) {
+    m_twiddles[k] = calc_unit_root(k, size, false);
+  }
+
+  int bits = 0;
+  while ((size_t(1) << bits) < size) {
+    ++bits;
+  }
+  for (size_t i = 0; i < size; ++i) {
+    uint32_t reversed = 0;
+    for (int bit = 0; bit < bits; ++bit) {
+      reversed |= uint32_t((i >> bit) & 1u) << (bits - 1 - bit);
+    }
+    m_bit_reversed[i] = reversed;
+  }
+}
+
+// Iterative decimation in time on bit reversed input. Stages go in pairs as radix-4 butterflies,
+// a radix-2 stage is left first when the count of stages is odd
+void fft::Plan::transform(std::span<complex_t> data, bool inverse) const {
+  const size_t n = m_size;
+  for (size_t i = 0; i < n; ++i) {
+    const size_t j = m_bit_reversed[i];
+    if (i < j) {
+      std::swap(data[i], data[j]);
+    }
+  }
+
+  auto twiddle = [&](size_t k, size_t length) {
+    const complex_t w = m_twiddles[k * (n / length)];
+    return inverse ? std::conj(w) : w;
+  };
+
+  size_t length = 1; // half size of the transforms the next stage builds
+  if (n >= 2 && (std::countr_zero(n) & 1) != 0) {
+    for (size_t block = 0; block < n; block += 2) {
+      const complex_t a = data[block];
+      const complex_t b = data[block + 1];
+      data[block] = a + b;
+      data[block + 1] = a - b;
+    }
+    length = 2;
+  }
+
+  // multiplying by w^(n / 4) is a quarter turn
+  const complex_t quarter = inverse ? complex_t(0.0f, 1.0f) : complex_t(0.0f, -1.0f);
+  for (; length < n; length *= 4) {
+    for (size_t block = 0; block < n; block += 4 * length) {
+      complex_t* x = data.data() + block;
+      for (size_t j = 0; j < length; ++j) {
+        const complex_t w = twiddle(j, 2 * length);
+        const complex_t v = twiddle(j, 4 * length);
+        const complex_t wa1 = mul(w, x[j + length]);
+        const complex_t wa3 = mul(w, x[j + 3 * length]);
+        const complex_t b0 = x[j] + wa1;
+        const complex_t b1 = x[j] - wa1;
+        const complex_t b2 = x[j + 2 * length] + wa3;
+        const complex_t b3 = x[j + 2 * length] - wa3;
+        const complex_t vb2 = mul(v, b2);
+        const complex_t ub3 = mul(quarter, mul(v, b3));
+        x[j] = b0 + vb2;
+        x[j + 2 * length] = b0 - vb2;
+        x[j + length] = b1 + ub3;
+        x[j + 3 * length] = b1 - ub3;
+      }
+    }
+  }
+}
+
+// Transforms of all columns. Blocks of columns are copied into contiguous buffers, so a transform
+// does not read a cache line per element
+static void transform_columns(std::span<complex_t> data, size_t columns, size_t h, bool inverse, int threads) {
+  const fft::Plan plan(h);
+  const size_t blocks = (columns + s_column_block - 1) / s_column_block;
+  parallel::for_ranges(blocks, 1, threads, [&](size_t begin, size_t end) {
+    std::vector<complex_t> buffer(s_column_block * h);
+    for (size_t block = begin; block < end; ++block) {
+      const size_t first = block * s_column_block;
+      const size_t count = std::min(s_column_block, columns - first);
+      for (size_t y = 0; y < h; ++y) {
+        const complex_t* row = data.data() + y * columns + first;
+        for (size_t c = 0; c < count; ++c) {
+          buffer[c * h + y] = row[c];
+        }
+      }
+      for (size_t c = 0; c < count; ++c) {
+        plan.transform(std::span(buffer).subspan(c * h, h), inverse);
+      }
+      for (size_t y = 0; y < h; ++y) {
+        complex_t* row = data.data() + y * columns + first;
+        for (size_t c = 0; c < count; ++c) {
+          row[c] = buffer[c * h + y];
+        }
+      }
+    }
+  });
+}
+
+// A real row of w values is transformed as w / 2 complex numbers z[n] = x[2n] + i x[2n + 1],
+// the spectra of the even and odd values are separated from the result and combined
+void fft::forward_real_2d(std::span<complex_t> data, size_t w, size_t h, int threads) {
+  const size_t half = w / 2;
+  const size_t columns = half_spectrum_width(w);
+  const Plan plan(half);
+  std::vector<complex_t> roots(half);
+  for (size_t k = 0; k < half; ++k) {
+    roots[k] = calc_unit_root(k, w, false);
+  }
+
+  parallel::for_ranges(h, s_min_rows_per_thread, threads, [&](size_t begin, size_t end) {
+    std::vector<complex_t> z(half);
+    for (size_t y = begin; y < end; ++y) {
+      complex_t* row = data.data() + y * columns;
+      std::copy_n(row, half, z.begin());
+      plan.transform(z, false);
+      for (size_t k = 0; k <= half; ++k) {
+        const complex_t zk = z[k % half];
+        const complex_t zm = std::conj(z[(half - k) % half]);
+        const complex_t even = 0.5f * (zk + zm);
+        const complex_t odd = mul(complex_t(0.0f, -0.5f), zk - zm);
+        row[k] = even + mul(k < half ? roots[k] : complex_t(-1.0f, 0.0f), odd);
+      }
+    }
+  });
+
+  transform_columns(data, columns, h, false, threads);
+}
+
+void fft::inverse_real_2d(std::span<complex_t> data, size_t w, size_t h, int threads) {
+  const size_t half = w / 2;
+  const size_t columns = half_spectrum_width(w);
+  transform_columns(data, columns, h, true, threads);
+
+  const Plan plan(half);
+  std::vector<complex_t> roots(half);
+  for (size_t k = 0; k < half; ++k) {
+    roots[k] = calc_unit_root(k, w, true);
+  }
+
+  parallel::for_ranges(h, s_min_rows_per_thread, threads, [&](size_t begin, size_t end) {
+    std::vector<complex_t> z(half);
+    for (size_t y = begin; y < end; ++y) {
+      complex_t* row = data.data() + y * columns;
+      for (size_t k = 0; k < half; ++k) {
+        const complex_t xk = row[k];
+        const complex_t xm = std::conj(row[half - k]);
+        z[k] = (xk + xm) + mul(mul(complex_t(0.0f, 1.0f), roots[k]), xk - xm);
+      }
+      plan.transform(z, true);
+      // z[n] holds the values 2n and 2n + 1, the same floats as the first half of the row
+      std::copy(z.begin(), z.end(), row);
+    }
+  });
+}
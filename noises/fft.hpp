@@ -0,0 +1,67 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+
+
+// Power of two FFTs. Transforms are unnormalized, an inverse after a forward transform
+// multiplies the data by the size
+namespace fft {
+  using complex_t = std::complex<float>;
+
+  // Twiddles and the bit reversal of one transform size, shared by all transforms of that size
+  class Plan {
+  public:
+    // size must be a power of two
+    explicit Plan(size_t size);
+
+    size_t size() const {
+      return m_size;
+    }
+
+    // In place. Forward uses e^(-2 pi i k n / size), inverse e^(+2 pi i k n / size)
+    void transform(std::span<complex_t> data, bool inverse) const;
+
+  private:
+    size_t m_size;
+    // e^(-2 pi i k / size) for k in [0, size / 2)
+    std::vector<complex_t> m_twiddles;
+    std::vector<uint32_t> m_bit_reversed;
+  };
+
+  constexpr bool is_power_of_two(size_t value) {
+    return value != 0 && (value & (value - 1)) == 0;
+  }
+
+  constexpr size_t next_power_of_two(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+      result *= 2;
+    }
+    return result;
+  }
+
+  // Complex numbers in a row of the half spectrum of a real field of width w
+  constexpr size_t half_spectrum_width(size_t w) {
+    return w / 2 + 1;
+  }
+
+  // 2D transforms of a real w x h field, both powers of two and w at least 2. They work in place on
+  // h rows of half_spectrum_width(w) complex numbers: the spectrum for frequencies 0 to w / 2 along x,
+  // or the real field with rows of 2 * half_spectrum_width(w) floats, of which the first w are used.
+  // Rows and blocks of columns are split between threads, threads <= 0 uses all hardware threads
+  void forward_real_2d(std::span<complex_t> data, size_t w, size_t h, int threads = 0);
+  void inverse_real_2d(std::span<complex_t> data, size_t w, size_t h, int threads = 0);
+
+  // The real field in data after a transform, rows are 2 * half_spectrum_width(w) floats apart
+  inline float* real_field(complex_t* data) {
+    return reinterpret_cast<float*>(data);
+  }
+
+  inline const float* real_field(const complex_t* data) {
+    return reinterpret_cast<const float*>(data);
+  }
+}
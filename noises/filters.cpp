@@ -0,0 +1,193 @@
+#include "filters.hpp"
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <parallel.hpp>
+#include <simd/filter_simd.hpp>
+
+
+// Tiles are at least four radii high so the halo rows filtered along rows twice stay under half of the work,
+// and narrow down to keep the rows of a tile and its halo within the budget
+static constexpr int s_max_tile_width = 256;
+static constexpr int s_min_tile_width = 32;
+static constexpr int s_min_tile_height = 64;
+static constexpr size_t s_tile_rows_budget = 256 * 1024; // bytes
+static constexpr size_t s_min_tiles_per_thread = 4;
+// the gaussian is cut off this many deviations from the center
+static constexpr float s_gaussian_extent = 3.0f;
+
+// Weights of the taps from -radius to radius, they add up to 1
+static std::vector<float> make_weights(const FilterParameters& parameters) {
+  switch (parameters.kernel) {
+    case FilterParameters::Kernel::none:
+      return { 1.0f };
+    case FilterParameters::Kernel::box: {
+      const int radius = std::max(int(std::lround(parameters.radius)), 0);
+      return std::vector<float>(size_t(radius) * 2 + 1, 1.0f / float(radius * 2 + 1));
+    }
+    case FilterParameters::Kernel::gaussian:
+    case FilterParameters::Kernel::unsharp:
+      break;
+  }
+
+  const float sigma = std::max(parameters.radius, 0.1f);
+  const int radius = std::max(int(std::ceil(sigma * s_gaussian_extent)), 1);
+  std::vector<float> weights(size_t(radius) * 2 + 1);
+  float sum = 0.0f;
+  for (int k = -radius; k <= radius; ++k) {
+    const float weight = std::exp(-float(k * k) / (2.0f * sigma * sigma));
+    weights[size_t(k + radius)] = weight;
+    sum += weight;
+  }
+  for (auto& weight : weights) {
+    weight /= sum;
+  }
+  return weights;
+}
+
+struct TileSize {
+  int width;
+  int height;
+};
+
+static TileSize calc_tile_size(int radius) {
+  const int height = std::max(s_min_tile_height, radius * 4);
+  const size_t rowBytes = size_t(height + radius * 2) * sizeof(float);
+  const int width = int(std::clamp(s_tile_rows_budget / rowBytes, size_t(s_min_tile_width), size_t(s_max_tile_width)));
+  // whole vectors of the row kernels
+  return { .width = width / 16 * 16, .height = height };
+}
+
+static bool is_identity_levels(const FilterParameters& parameters) {
+  return parameters.in_black == 0.0f && parameters.in_white == 1.0f && parameters.gamma == 1.0f
+    && parameters.out_black == 0.0f && parameters.out_white == 1.0f;
+}
+
+namespace {
+  class TileFilter {
+  public:
+    TileFilter(const FilterParameters& parameters, const float* field, float* result, int width, int height) :
+      m_parameters(parameters),
+      m_weights(make_weights(parameters)),
+      m_radius(int(m_weights.size() / 2)),
+      m_kernel(simd::convolve_row_kernel()),
+      m_field(field),
+      m_result(result),
+      m_width(width),
+      m_height(height),
+      m_levels(!is_identity_levels(parameters)),
+      m_in_scale(parameters.in_white != parameters.in_black ? 1.0f / (parameters.in_white - parameters.in_black) : 0.0f),
+      m_inverse_gamma(1.0f / std::max(parameters.gamma, 0.01f))
+    {}
+
+    int radius() const {
+      return m_radius;
+    }
+
+    // Filters [x0, x1) x [y0, y1), the scratch buffers belong to the calling thread
+    void filter(int x0, int y0, int x1, int y1, std::vector<float>& padded, std::vector<float>& rows, std::vector<float>& columns) const {
+      const int tileWidth = x1 - x0;
+      const int taps = int(m_weights.size());
+      padded.resize(size_t(tileWidth + taps - 1));
+      rows.resize(size_t(tileWidth) * size_t(y1 - y0 + taps - 1));
+      columns.resize(size_t(tileWidth));
+
+      // along rows, the halo rows above and below the tile included
+      for (int y = y0 - m_radius; y < y1 + m_radius; ++y) {
+        const float* source = m_field + size_t(std::clamp(y, 0, m_height - 1)) * size_t(m_width);
+        const float* in = padded.data();
+        if (x0 >= m_radius && x1 + m_radius <= m_width) {
+          in = source + (x0 - m_radius);
+        } else {
+          for (int x = x0 - m_radius; x < x1 + m_radius; ++x) {
+            padded[size_t(x - x0 + m_radius)] = source[std::clamp(x, 0, m_width - 1)];
+          }
+        }
+        convolve(in, 1, rows.data() + size_t(y - y0 + m_radius) * size_t(tileWidth), tileWidth);
+      }
+
+      // along columns, then the per pixel part
+      for (int y = y0; y < y1; ++y) {
+        convolve(rows.data() + size_t(y - y0) * size_t(tileWidth), size_t(tileWidth), columns.data(), tileWidth);
+        const size_t offset = size_t(y) * size_t(m_width) + size_t(x0);
+        finish_row(m_field + offset, columns.data(), m_result + offset, tileWidth);
+      }
+    }
+
+  private:
+    void convolve(const float* in, size_t tapStride, float* out, int count) const {
+      int x = 0;
+      if (m_kernel != nullptr) {
+        x = m_kernel(simd::ConvolveRowArgs{
+          .in = in,
+          .tap_stride = tapStride,
+          .weights = m_weights.data(),
+          .taps = int(m_weights.size()),
+          .out = out,
+          .count = count
+        });
+      }
+      for (; x < count; ++x) {
+        float sum = 0.0f;
+        for (size_t k = 0; k < m_weights.size(); ++k) {
+          sum += m_weights[k] * in[size_t(x) + k * tapStride];
+        }
+        out[x] = sum;
+      }
+    }
+
+    void finish_row(const float* original, const float* filtered, float* out, int count) const {
+      const bool unsharp = m_parameters.kernel == FilterParameters::Kernel::unsharp;
+      for (int x = 0; x < count; ++x) {
+        // the single tap of none leaves the values as they are
+        float value = unsharp ? original[x] + m_parameters.amount * (original[x] - filtered[x]) : filtered[x];
+        if (m_levels) {
+          float level = std::clamp((value - m_parameters.in_black) * m_in_scale, 0.0f, 1.0f);
+          if (m_inverse_gamma != 1.0f) {
+            level = std::pow(level, m_inverse_gamma);
+          }
+          value = m_parameters.out_black + level * (m_parameters.out_white - m_parameters.out_black);
+        }
+        out[x] = value;
+      }
+    }
+
+    const FilterParameters& m_parameters;
+    const std::vector<float> m_weights;
+    const int m_radius;
+    const simd::convolve_row_kernel_t m_kernel;
+    const float* const m_field;
+    float* const m_result;
+    const int m_width;
+    const int m_height;
+    const bool m_levels;
+    const float m_in_scale;
+    const float m_inverse_gamma;
+  };
+}
+
+void apply_filters(const FilterParameters& parameters, std::span<float> field, int width, int height) {
+  if (width <= 0 || height <= 0 || (parameters.kernel == FilterParameters::Kernel::none && is_identity_levels(parameters))) {
+    return;
+  }
+
+  std::vector<float> result(field.size());
+  const TileFilter tileFilter(parameters, field.data(), result.data(), width, height);
+  const TileSize tileSize = calc_tile_size(tileFilter.radius());
+  const int tilesX = (width + tileSize.width - 1) / tileSize.width;
+  const int tilesY = (height + tileSize.height - 1) / tileSize.height;
+
+  parallel::for_ranges(size_t(tilesX) * size_t(tilesY), s_min_tiles_per_thread, parameters.threads, [&](size_t begin, size_t end) {
+    std::vector<float> padded;
+    std::vector<float> rows;
+    std::vector<float> columns;
+    for (size_t tile = begin; tile < end; ++tile) {
+      const int x0 = int(tile % size_t(tilesX)) * tileSize.width;
+      const int y0 = int(tile / size_t(tilesX)) * tileSize.height;
+      tileFilter.filter(x0, y0, std::min(x0 + tileSize.width, width), std::min(y0 + tileSize.height, height), padded, rows, columns);
+    }
+  });
+
+  std::copy(result.begin(), result.end(), field.begin());
+}
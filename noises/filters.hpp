@@ -0,0 +1,32 @@
+#pragma once
+
+#include <span>
+
+
+struct FilterParameters {
+  enum class Kernel {
+    none,
+    gaussian,
+    box,
+    unsharp // the field plus amount times its difference from the gaussian blur
+  } kernel = Kernel::gaussian;
+
+  // deviation of the gaussian, also the one unsharp masking blurs with, or the half width of the box. In pixels
+  float radius = 2.0f;
+  float amount = 1.0f;
+
+  // levels after the kernel: [in_black, in_white] is stretched to [out_black, out_white] through the gamma
+  float in_black = 0.0f;
+  float in_white = 1.0f;
+  float gamma = 1.0f;
+  float out_black = 0.0f;
+  float out_white = 1.0f;
+
+  // 0 uses all hardware threads
+  int threads = 0;
+};
+
+// Filters width x height values stored row by row, the field is extended past its edges by the edge values.
+// Kernels are separable: the field is split into tiles, every tile is filtered along rows with a halo of rows
+// above and below it, then along columns. Tiles are split between threads
+void apply_filters(const FilterParameters& parameters, std::span<float> field, int width, int height);
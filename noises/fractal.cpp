@@ -0,0 +1,198 @@
+#include "fractal.hpp"
+
+#include <cmath>
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include <gradients.hpp>
+#include <gradient_noise.hpp>
+#include <simplex.hpp>
+
+
+using Basis = FractalNoiseParameters::Basis;
+using Variant = FractalNoiseParameters::Variant;
+
+// how strongly a ridge of one octave lets the next octave through
+static constexpr float s_ridge_weight_gain = 2.0f;
+
+namespace {
+  // One coordinate of a sample in the lattice of one octave
+  struct OctaveAxis {
+    float coord;
+    gradient_noise::LatticeAxis lattice;
+  };
+}
+
+static void calc_octave_axes(const FractalNoise& noise, float coord, float offset, float step,
+                             const std::array<float, FractalNoise::s_max_octaves>& shifts, OctaveAxis* out) {
+  const float base = (coord - offset) / step;
+  for (int k = 0; k < noise.m_parameters.octaves; ++k) {
+    const float octaveCoord = base * noise.m_frequencies[size_t(k)] + shifts[size_t(k)];
+    out[k] = {
+      .coord = octaveCoord,
+      .lattice = gradient_noise::calc_lattice_axis<GradientNoiseInterpolation::quintic>(octaveCoord)
+    };
+  }
+}
+
+// Billow octave from |n|, in [-1, 1]. The squared fold flattens the tops into rounded puffs and keeps
+// the creases at the zero crossings
+static constexpr float fold_billow(float magnitude) {
+  const float inverse = 1.0f - magnitude;
+  return 1.0f - 2.0f * inverse * inverse;
+}
+
+// An affine fold would make billow a remap of turbulence, map_to_unit would then turn both into the same texture
+static_assert(fold_billow(0.5f) != (fold_billow(0.0f) + fold_billow(1.0f)) / 2.0f);
+
+template<Basis basis, Variant variant>
+static float calc_raw(const FractalNoise& noise, const OctaveAxis* xs, const OctaveAxis* ys) {
+  float sum = 0.0f;
+  float weight = 1.0f;
+  for (int k = 0; k < noise.m_parameters.octaves; ++k) {
+    const uint32_t seed = noise.m_hash_seeds[size_t(k)];
+    float value = 0.0f;
+    if constexpr (basis == Basis::perlin) {
+      value = gradient_noise::evaluate<2>(seed, {xs[k].lattice, ys[k].lattice});
+    } else {
+      value = SimplexNoise::calc_raw(seed, xs[k].coord, ys[k].coord);
+    }
+
+    if constexpr (variant == Variant::billow) {
+      value = fold_billow(std::abs(value));
+    } else if constexpr (variant == Variant::turbulence) {
+      value = std::abs(value);
+    } else if constexpr (variant == Variant::ridged) {
+      value = 1.0f - std::abs(value);
+      value *= value * weight;
+      weight = std::clamp(value * s_ridge_weight_gain, 0.0f, 1.0f);
+    }
+    sum += value * noise.m_amplitudes[size_t(k)];
+  }
+  return sum * noise.m_normalization;
+}
+
+template<Variant variant>
+static float map_to_unit(float raw) {
+  if constexpr (variant == Variant::fbm || variant == Variant::billow) {
+    return std::clamp((1.0f + raw) / 2.0f, 0.0f, 1.0f);
+  } else {
+    return std::clamp(raw, 0.0f, 1.0f);
+  }
+}
+
+template<Basis basis, Variant variant, bool map>
+static float evaluate(const FractalNoise& noise, const OctaveAxis* xs, const OctaveAxis* ys) {
+  const float raw = calc_raw<basis, variant>(noise, xs, ys);
+  if constexpr (map) {
+    return map_to_unit<variant>(raw);
+  } else {
+    return raw;
+  }
+}
+
+template<Basis basis, Variant variant, bool map>
+static float evaluate_point(const FractalNoise& noise, float x, float y) {
+  const auto& params = noise.m_parameters;
+  std::array<OctaveAxis, FractalNoise::s_max_octaves> xs;
+  std::array<OctaveAxis, FractalNoise::s_max_octaves> ys;
+  calc_octave_axes(noise, x, params.offset_x, params.grid_step_x, noise.m_shifts_x, xs.data());
+  calc_octave_axes(noise, y, params.offset_y, params.grid_step_y, noise.m_shifts_y, ys.data());
+  return evaluate<basis, variant, map>(noise, xs.data(), ys.data());
+}
+
+template<Basis basis, Variant variant, bool map>
+static void fill_block(const FractalNoise& noise, std::span<float> out, int x0, int y0, int w, int h, size_t stride) {
+  const auto& params = noise.m_parameters;
+  const size_t octaves = size_t(params.octaves);
+
+  // all octaves of a column are next to each other
+  std::vector<OctaveAxis> columns(static_cast<size_t>(w) * octaves);
+  for (int i = 0; i < w; ++i) {
+    calc_octave_axes(noise, float(x0 + i), params.offset_x, params.grid_step_x, noise.m_shifts_x, &columns[size_t(i) * octaves]);
+  }
+
+  std::array<OctaveAxis, FractalNoise::s_max_octaves> rowAxes;
+  for (int j = 0; j < h; ++j) {
+    float* row = out.data() + size_t(j) * stride;
+    calc_octave_axes(noise, float(y0 + j), params.offset_y, params.grid_step_y, noise.m_shifts_y, rowAxes.data());
+    for (int i = 0; i < w; ++i) {
+      row[i] = evaluate<basis, variant, map>(noise, &columns[size_t(i) * octaves], rowAxes.data());
+    }
+  }
+}
+
+// Calls f with std::integral_constant of the basis and the variant of the noise
+static decltype(auto) visit_fractal(const FractalNoiseParameters& params, auto&& f) {
+  auto withVariant = [&](auto basis) -> decltype(auto) {
+    switch (params.variant) {
+      case Variant::fbm: return f(basis, std::integral_constant<Variant, Variant::fbm>{});
+      case Variant::billow: return f(basis, std::integral_constant<Variant, Variant::billow>{});
+      case Variant::turbulence: return f(basis, std::integral_constant<Variant, Variant::turbulence>{});
+      case Variant::ridged: return f(basis, std::integral_constant<Variant, Variant::ridged>{});
+    }
+    std::unreachable();
+  };
+  switch (params.basis) {
+    case Basis::perlin: return withVariant(std::integral_constant<Basis, Basis::perlin>{});
+    case Basis::simplex: return withVariant(std::integral_constant<Basis, Basis::simplex>{});
+  }
+  std::unreachable();
+}
+
+static FractalNoiseParameters clamp_octaves(FractalNoiseParameters parameters) {
+  parameters.octaves = std::clamp(parameters.octaves, 1, FractalNoise::s_max_octaves);
+  return parameters;
+}
+
+FractalNoise::FractalNoise(const FractalNoiseParameters& parameters, uint64_t seed)
+: m_parameters(clamp_octaves(parameters))
+, m_seed(seed) {
+  float frequency = 1.0f;
+  float amplitude = 1.0f;
+  float amplitudesSum = 0.0f;
+  for (int k = 0; k < m_parameters.octaves; ++k) {
+    const size_t octave = size_t(k);
+    // first octave gets the same hash seed as SimplexNoise and hashed PerlinNoise
+    m_hash_seeds[octave] = static_cast<uint32_t>(gradients::counter_random(~seed, octave) >> 32);
+    // a different stream for the shifts, 24 bits of fraction each
+    const uint64_t shiftBits = gradients::counter_random(seed, octave);
+    m_shifts_x[octave] = k == 0 ? 0.0f : float(shiftBits >> 40) * 0x1p-24f;
+    m_shifts_y[octave] = k == 0 ? 0.0f : float((shiftBits >> 8) & 0xffffffu) * 0x1p-24f;
+
+    m_frequencies[octave] = frequency;
+    m_amplitudes[octave] = amplitude;
+    amplitudesSum += amplitude;
+    frequency *= m_parameters.lacunarity;
+    amplitude *= m_parameters.gain;
+  }
+  m_normalization = amplitudesSum > 0.0f ? 1.0f / amplitudesSum : 1.0f;
+}
+
+float FractalNoise::operator()(float x, float y) const {
+  return visit_fractal(m_parameters, [&](auto basis, auto variant) {
+    return evaluate_point<basis(), variant(), true>(*this, x, y);
+  });
+}
+
+float FractalNoise::raw(float x, float y) const {
+  return visit_fractal(m_parameters, [&](auto basis, auto variant) {
+    return evaluate_point<basis(), variant(), false>(*this, x, y);
+  });
+}
+
+void FractalNoise::fill(std::span<float> out, int x0, int y0, int w, int h, size_t stride) const {
+  visit_fractal(m_parameters, [&](auto basis, auto variant) {
+    fill_block<basis(), variant(), true>(*this, out, x0, y0, w, h, stride);
+  });
+}
+
+void FractalNoise::fill_row(std::span<float> out, int x0, int y, int w) const {
+  fill(out, x0, y, w, 1, size_t(w));
+}
+
+void FractalNoise::fill_raw(std::span<float> out, int x0, int y0, int w, int h, size_t stride) const {
+  visit_fractal(m_parameters, [&](auto basis, auto variant) {
+    fill_block<basis(), variant(), false>(*this, out, x0, y0, w, h, stride);
+  });
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <span>
+#include <array>
+#include <cstdint>
+
+
+struct FractalNoiseParameters {
+  // of the first octave
+  float grid_step_x;
+  float grid_step_y;
+
+  float offset_x = 0.0f;
+  float offset_y = 0.0f;
+
+  int octaves = 6;
+  // frequency multiplier from one octave to the next
+  float lacunarity = 2.0f;
+  // amplitude multiplier from one octave to the next
+  float gain = 0.5f;
+
+  enum class Basis {
+    perlin, // GradientNoise<2> with quintic fade
+    simplex
+  } basis = Basis::perlin;
+
+  enum class Variant {
+    fbm,        // sum of the octaves
+    billow,     // sum of 1 - 2(1 - |n|)^2, rounded puffs with creases between them
+    turbulence, // sum of |n|
+    ridged      // sum of (1 - |n|)^2, every octave weighted by the previous one
+  } variant = Variant::fbm;
+};
+
+// Sum of octaves of unbounded gradient noise, evaluated in one pass per sample.
+// Octaves are summed unclamped, only the final value is mapped to [0, 1].
+// Every octave has its own hash seed and lattice shift, so they do not line up at the origin
+class FractalNoise {
+public:
+  static constexpr int s_max_octaves = 16;
+
+  // Octave count is clamped to [1, s_max_octaves]
+  FractalNoise(const FractalNoiseParameters& parameters, uint64_t seed);
+
+  float operator()(float x, float y) const;
+  // Sum of the octaves divided by the sum of the amplitudes.
+  // In [-1, 1] for fbm and billow, in [0, 1] for turbulence and ridged. Not clamped
+  float raw(float x, float y) const;
+
+  // Evaluates w x h samples starting at (x0, y0) into out, rows are stride floats apart.
+  // Gives the same values as operator(), but per-column and per-row work of every octave is done once.
+  void fill(std::span<float> out, int x0, int y0, int w, int h, size_t stride) const;
+  void fill_row(std::span<float> out, int x0, int y, int w) const;
+  // Same as fill, but with the values of raw()
+  void fill_raw(std::span<float> out, int x0, int y0, int w, int h, size_t stride) const;
+
+  const FractalNoiseParameters m_parameters;
+  const uint64_t m_seed;
+
+  // per octave
+  std::array<uint32_t, s_max_octaves> m_hash_seeds{};
+  std::array<float, s_max_octaves> m_frequencies{};
+  std::array<float, s_max_octaves> m_amplitudes{};
+  std::array<float, s_max_octaves> m_shifts_x{};
+  std::array<float, s_max_octaves> m_shifts_y{};
+  // 1 / sum of the amplitudes
+  float m_normalization = 1.0f;
+};
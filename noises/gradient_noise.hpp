@@ -0,0 +1,248 @@
+#pragma once
+
+#include <span>
+#include <array>
+#include <cmath>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <interpolation.hpp>
+#include <gradients.hpp>
+
+
+enum class GradientNoiseInterpolation {
+  linear,  // N-linear blend of the corners, same as bilinear PerlinNoise
+  cubic,   // smoothstep weights, same as bicubic PerlinNoise with zero derivatives
+  quintic  // 6t^5 - 15t^4 + 10t^3, continuous second derivative
+};
+
+template<size_t N>
+struct GradientNoiseParameters {
+  std::array<float, N> grid_step;
+  std::array<float, N> offset{};
+
+  GradientNoiseInterpolation interpolation = GradientNoiseInterpolation::quintic;
+};
+
+namespace gradient_noise {
+  // One coordinate of a sample in the lattice
+  struct LatticeAxis {
+    int cell;
+    float fraction;
+    float fade;
+  };
+
+  template<GradientNoiseInterpolation interpolation>
+  float calc_fade(float t) {
+    if constexpr (interpolation == GradientNoiseInterpolation::linear) {
+      return t;
+    } else if constexpr (interpolation == GradientNoiseInterpolation::cubic) {
+      return t * t * (3.0f - 2.0f * t);
+    } else {
+      return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+    }
+  }
+
+  // coord is in grid steps
+  template<GradientNoiseInterpolation interpolation>
+  LatticeAxis calc_lattice_axis(float coord) {
+    const float cell = std::floor(coord);
+    const float fraction = coord - cell;
+    return {
+      .cell = int(cell),
+      .fraction = fraction,
+      .fade = calc_fade<interpolation>(fraction)
+    };
+  }
+
+  // Edge midpoints of the cube, 4 of them twice so the hash picks one with a shift
+  inline constexpr float s_gradients_3d[16][3] = {
+    { 1,  1,  0}, {-1,  1,  0}, { 1, -1,  0}, {-1, -1,  0},
+    { 1,  0,  1}, {-1,  0,  1}, { 1,  0, -1}, {-1,  0, -1},
+    { 0,  1,  1}, { 0, -1,  1}, { 0,  1, -1}, { 0, -1, -1},
+    { 1,  1,  0}, { 0, -1,  1}, {-1,  1,  0}, { 0, -1, -1}
+  };
+
+  // Edge midpoints of the tesseract
+  inline constexpr float s_gradients_4d[32][4] = {
+    { 0,  1,  1,  1}, { 0,  1,  1, -1}, { 0,  1, -1,  1}, { 0,  1, -1, -1},
+    { 0, -1,  1,  1}, { 0, -1,  1, -1}, { 0, -1, -1,  1}, { 0, -1, -1, -1},
+    { 1,  0,  1,  1}, { 1,  0,  1, -1}, { 1,  0, -1,  1}, { 1,  0, -1, -1},
+    {-1,  0,  1,  1}, {-1,  0,  1, -1}, {-1,  0, -1,  1}, {-1,  0, -1, -1},
+    { 1,  1,  0,  1}, { 1,  1,  0, -1}, { 1, -1,  0,  1}, { 1, -1,  0, -1},
+    {-1,  1,  0,  1}, {-1,  1,  0, -1}, {-1, -1,  0,  1}, {-1, -1,  0, -1},
+    { 1,  1,  1,  0}, { 1,  1, -1,  0}, { 1, -1,  1,  0}, { 1, -1, -1,  0},
+    {-1,  1,  1,  0}, {-1,  1, -1,  0}, {-1, -1,  1,  0}, {-1, -1, -1,  0}
+  };
+
+  // 2 / sqrt(N), the values of every dimension then spread about as much as in 2D.
+  // With the 3D and 4D gradients the extremes go a little past 1, for less than 0.01% of samples
+  inline constexpr float s_scales[5] = { 0.0f, 2.0f, 1.41421356f, 1.15470054f, 1.0f };
+
+  // Dot product of the node gradient with the offset from the node
+  template<size_t N>
+  float calc_gradient_dot(uint32_t hash, const std::array<float, N>& offset) {
+    if constexpr (N == 1) {
+      // slope in [-1, 1)
+      return offset[0] * (float(static_cast<int32_t>(hash)) * 0x1p-31f);
+    } else {
+      const float* gradient = nullptr;
+      if constexpr (N == 2) {
+        gradient = &gradients::s_unit_vectors[size_t(gradients::table_index(hash)) * 2];
+      } else if constexpr (N == 3) {
+        gradient = s_gradients_3d[hash >> 28];
+      } else {
+        gradient = s_gradients_4d[hash >> 27];
+      }
+      float dot = offset[0] * gradient[0];
+      for (size_t i = 1; i < N; ++i) {
+        dot += offset[i] * gradient[i];
+      }
+      return dot;
+    }
+  }
+
+  // Bit i of the corner index says if the corner is on the far side along axis i
+  template<size_t N, size_t corner>
+  float calc_corner(uint32_t seed, const std::array<LatticeAxis, N>& axes) {
+    std::array<int, N> node;
+    std::array<float, N> offset;
+    for (size_t i = 0; i < N; ++i) {
+      const bool far = ((corner >> i) & 1u) != 0;
+      node[i] = far ? axes[i].cell + 1 : axes[i].cell;
+      offset[i] = far ? axes[i].fraction - 1.0f : axes[i].fraction;
+    }
+    return calc_gradient_dot<N>(gradients::hash_node<N>(seed, node), offset);
+  }
+
+  // Halves the corners along one axis: pairs differ in the lowest bit
+  template<size_t count>
+  void blend_axis(std::array<float, count>& values, float fade) {
+    [&]<size_t... i>(std::index_sequence<i...>) {
+      ((values[i] = interpolation::lerp(values[2 * i], values[2 * i + 1], fade)), ...);
+    }(std::make_index_sequence<count / 2>{});
+  }
+
+  // Unclamped noise scaled to about [-1, 1]. All 2^N corners and blends are unrolled at compile time
+  template<size_t N>
+  float evaluate(uint32_t seed, const std::array<LatticeAxis, N>& axes) {
+    constexpr size_t cornersCount = size_t(1) << N;
+    std::array<float, cornersCount> values;
+    [&]<size_t... corner>(std::index_sequence<corner...>) {
+      ((values[corner] = calc_corner<N, corner>(seed, axes)), ...);
+    }(std::make_index_sequence<cornersCount>{});
+
+    [&]<size_t... axis>(std::index_sequence<axis...>) {
+      (blend_axis(values, axes[axis].fade), ...);
+    }(std::make_index_sequence<N>{});
+    return values[0] * s_scales[N];
+  }
+}
+
+// Gradient noise in N = 1..4 dimensions with hashed gradients, so it has no bounds and stores nothing.
+// 1D has random slopes, 2D the unit vectors of gradients::s_unit_vectors, 3D and 4D the edge midpoints
+// of the cube and the tesseract. PerlinNoise is the 2D version with a stored grid and vectorized kernels
+template<size_t N>
+class GradientNoise {
+  static_assert(N >= 1 && N <= 4);
+
+public:
+  using point_t = std::array<float, N>;
+
+  // Gradients depend only on the seed, they are the same on every platform
+  GradientNoise(const GradientNoiseParameters<N>& parameters, uint64_t seed)
+  : m_parameters(parameters)
+  , m_seed(seed)
+  // same stream as hashed PerlinNoise gradients
+  , m_hash_seed(static_cast<uint32_t>(gradients::counter_random(~seed, 0) >> 32)) {
+  }
+
+  // Mapped to [0, 1]
+  float operator()(const point_t& p) const {
+    return map_to_unit(raw(p));
+  }
+
+  // About [-1, 1], not clamped
+  float raw(const point_t& p) const {
+    return visit_interpolation([&]<GradientNoiseInterpolation interpolation>() {
+      std::array<gradient_noise::LatticeAxis, N> axes;
+      for (size_t i = 0; i < N; ++i) {
+        axes[i] = calc_axis<interpolation>(p[i], i);
+      }
+      return gradient_noise::evaluate<N>(m_hash_seed, axes);
+    });
+  }
+
+  // Evaluates w samples at origin + (i, 0, ...) for i in [0, w).
+  // Gives the same values as operator(), but the lattice setup of the other axes is done once
+  void fill_row(std::span<float> out, const point_t& origin, int w) const {
+    fill_block<true>(out, origin, w, 1, size_t(w));
+  }
+
+  // Evaluates w x h samples at origin + (i, j, 0, ...) into out, rows are stride floats apart
+  void fill(std::span<float> out, const point_t& origin, int w, int h, size_t stride) const requires (N >= 2) {
+    fill_block<true>(out, origin, w, h, stride);
+  }
+
+  // Same as fill, but with the values of raw()
+  void fill_raw(std::span<float> out, const point_t& origin, int w, int h, size_t stride) const {
+    fill_block<false>(out, origin, w, h, stride);
+  }
+
+  const GradientNoiseParameters<N> m_parameters;
+  const uint64_t m_seed;
+  const uint32_t m_hash_seed;
+
+private:
+  static float map_to_unit(float raw) {
+    return std::clamp((1.0f + raw) / 2.0f, 0.0f, 1.0f);
+  }
+
+  template<GradientNoiseInterpolation interpolation>
+  gradient_noise::LatticeAxis calc_axis(float coord, size_t axis) const {
+    return gradient_noise::calc_lattice_axis<interpolation>(
+        (coord - m_parameters.offset[axis]) / m_parameters.grid_step[axis]);
+  }
+
+  decltype(auto) visit_interpolation(auto&& f) const {
+    using enum GradientNoiseInterpolation;
+    switch (m_parameters.interpolation) {
+      case linear: return f.template operator()<linear>();
+      case cubic: return f.template operator()<cubic>();
+      case quintic: return f.template operator()<quintic>();
+    }
+    std::unreachable();
+  }
+
+  template<bool map>
+  void fill_block(std::span<float> out, const point_t& origin, int w, int h, size_t stride) const {
+    visit_interpolation([&]<GradientNoiseInterpolation interpolation>() {
+      std::array<gradient_noise::LatticeAxis, N> axes;
+      for (size_t i = 2; i < N; ++i) {
+        axes[i] = calc_axis<interpolation>(origin[i], i);
+      }
+
+      std::vector<gradient_noise::LatticeAxis> columns(static_cast<size_t>(w));
+      for (int i = 0; i < w; ++i) {
+        columns[size_t(i)] = calc_axis<interpolation>(origin[0] + float(i), 0);
+      }
+
+      for (int j = 0; j < h; ++j) {
+        float* row = out.data() + size_t(j) * stride;
+        if constexpr (N >= 2) {
+          axes[1] = calc_axis<interpolation>(origin[1] + float(j), 1);
+        }
+        for (int i = 0; i < w; ++i) {
+          axes[0] = columns[size_t(i)];
+          const float value = gradient_noise::evaluate<N>(m_hash_seed, axes);
+          if constexpr (map) {
+            row[i] = map_to_unit(value);
+          } else {
+            row[i] = value;
+          }
+        }
+      }
+    });
+  }
+};
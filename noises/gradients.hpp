@@ -0,0 +1,169 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <numbers>
+
+
+namespace gradients {
+  inline constexpr int s_table_size = 256;
+
+  // Taylor series in double precision. Evaluated by the compiler only,
+  // so the table is the same with every compiler and standard library
+  constexpr double sin_series(double x) {
+    double term = x;
+    double sum = x;
+    for (int i = 1; i < 20; ++i) {
+      term *= -x * x / double((2 * i) * (2 * i + 1));
+      sum += term;
+    }
+    return sum;
+  }
+
+  constexpr double cos_series(double x) {
+    double term = 1.0;
+    double sum = 1.0;
+    for (int i = 1; i < 20; ++i) {
+      term *= -x * x / double((2 * i - 1) * (2 * i));
+      sum += term;
+    }
+    return sum;
+  }
+
+  constexpr std::array<float, s_table_size * 2> make_unit_vectors() {
+    std::array<float, s_table_size * 2> result{};
+    for (int i = 0; i < s_table_size; ++i) {
+      // angles in [-pi, pi) keep the series accurate
+      const int turn = i < s_table_size / 2 ? i : i - s_table_size;
+      const double angle = 2.0 * std::numbers::pi * double(turn) / double(s_table_size);
+      result[size_t(i) * 2] = float(cos_series(angle));
+      result[size_t(i) * 2 + 1] = float(sin_series(angle));
+    }
+    return result;
+  }
+
+  // Evenly spaced unit vectors, x and y interleaved. 2KB, stays in L1
+  inline constexpr std::array<float, s_table_size * 2> s_unit_vectors = make_unit_vectors();
+
+  // Rounds half to even like the vector float to int conversion, |value| must be below 2^23
+  constexpr int32_t round_to_nearest_even(float value) {
+    int32_t result = int32_t(value);
+    const float fraction = value - float(result);
+    if (fraction > 0.5f || (fraction == 0.5f && (result & 1) != 0)) {
+      ++result;
+    } else if (fraction < -0.5f || (fraction == -0.5f && (result & 1) != 0)) {
+      --result;
+    }
+    return result;
+  }
+
+  // Gradient component with 15 fractional bits, clamped so that it fits into 16 bits
+  constexpr int32_t to_fixed_component(float value) {
+    const int32_t rounded = round_to_nearest_even(value * 32768.0f);
+    return rounded < -32767 ? -32767 : rounded > 32767 ? 32767 : rounded;
+  }
+
+  // Two 16-bit values in one word, x in the low half
+  constexpr int32_t pack_fixed_pair(int32_t x, int32_t y) {
+    return static_cast<int32_t>((static_cast<uint32_t>(x) & 0xffffu) | (static_cast<uint32_t>(y) << 16));
+  }
+
+  constexpr std::array<int32_t, s_table_size> make_fixed_unit_vectors() {
+    std::array<int32_t, s_table_size> result{};
+    for (size_t i = 0; i < result.size(); ++i) {
+      result[i] = pack_fixed_pair(to_fixed_component(s_unit_vectors[i * 2]), to_fixed_component(s_unit_vectors[i * 2 + 1]));
+    }
+    return result;
+  }
+
+  // s_unit_vectors with 15 fractional bits, both components of a vector packed into one word
+  inline constexpr std::array<int32_t, s_table_size> s_fixed_unit_vectors = make_fixed_unit_vectors();
+
+  inline constexpr uint32_t s_hash_x_multiplier = 0x8da6b343u;
+  inline constexpr uint32_t s_hash_y_multiplier = 0xd8163841u;
+  inline constexpr uint32_t s_hash_z_multiplier = 0xcb1ab31fu;
+  inline constexpr uint32_t s_hash_w_multiplier = 0x165667b1u;
+  inline constexpr std::array<uint32_t, 4> s_hash_multipliers = {
+    s_hash_x_multiplier, s_hash_y_multiplier, s_hash_z_multiplier, s_hash_w_multiplier
+  };
+  inline constexpr uint32_t s_mix_multiplier0 = 0x7feb352du;
+  inline constexpr uint32_t s_mix_multiplier1 = 0x846ca68bu;
+
+  constexpr uint32_t mix_hash(uint32_t h) {
+    h ^= h >> 16;
+    h *= s_mix_multiplier0;
+    h ^= h >> 15;
+    h *= s_mix_multiplier1;
+    h ^= h >> 16;
+    return h;
+  }
+
+  // 32-bit hash of the node coordinates, the vectorized kernels repeat it operation by operation
+  constexpr uint32_t hash_node(uint32_t seed, int x, int y) {
+    return mix_hash(seed ^ (static_cast<uint32_t>(x) * s_hash_x_multiplier) ^ (static_cast<uint32_t>(y) * s_hash_y_multiplier));
+  }
+
+  // Same hash for 1 to 4 dimensions, the 2D one matches hash_node(seed, x, y)
+  template<size_t N>
+  constexpr uint32_t hash_node(uint32_t seed, const std::array<int, N>& node) {
+    static_assert(N >= 1 && N <= s_hash_multipliers.size());
+    uint32_t h = seed;
+    for (size_t i = 0; i < N; ++i) {
+      h ^= static_cast<uint32_t>(node[i]) * s_hash_multipliers[i];
+    }
+    return mix_hash(h);
+  }
+
+  // top bits are mixed the best
+  static_assert(s_table_size == 256);
+  constexpr int table_index(uint32_t hash) {
+    return int(hash >> 24);
+  }
+
+  inline const float* hashed_gradient(uint32_t seed, int x, int y) {
+    return &s_unit_vectors[size_t(table_index(hash_node(seed, x, y))) * 2];
+  }
+
+  inline constexpr uint64_t s_splitmix_increment = 0x9e3779b97f4a7c15ull;
+  inline constexpr uint64_t s_splitmix_multiplier0 = 0xbf58476d1ce4e5b9ull;
+  inline constexpr uint64_t s_splitmix_multiplier1 = 0x94d049bb133111ebull;
+
+  // Value number counter of the SplitMix64 stream started from seed.
+  // Every value is computed on its own, so nodes can be generated in any order and on any thread
+  constexpr uint64_t counter_random(uint64_t seed, uint64_t counter) {
+    uint64_t z = seed + (counter + 1) * s_splitmix_increment;
+    z = (z ^ (z >> 30)) * s_splitmix_multiplier0;
+    z = (z ^ (z >> 27)) * s_splitmix_multiplier1;
+    return z ^ (z >> 31);
+  }
+
+  // Direction of a node as a fraction of the full turn, 32-bit fixed point
+  constexpr uint32_t random_turn(uint64_t seed, uint64_t node) {
+    return static_cast<uint32_t>(counter_random(seed, node) >> 32);
+  }
+
+  // Index of the table vector closest to the direction
+  constexpr uint8_t quantize_turn(uint32_t turn) {
+    return static_cast<uint8_t>((turn + (1u << 23)) >> 24);
+  }
+
+  // Unit vector of the direction. Only basic float arithmetic, so it is the same on every platform
+  // as long as nothing gets fused into fma (see -ffp-contract in CMakeLists.txt)
+  inline std::array<float, 2> turn_to_unit_vector(uint32_t turn) {
+    // quarter of the turn the direction is closest to, and the angle from it in [-pi/4, pi/4)
+    const uint32_t shifted = turn + (1u << 29);
+    const uint32_t quarter = shifted >> 30;
+    const float fraction = float(shifted & ((1u << 30) - 1)) * 0x1p-30f;
+    const float a = (fraction - 0.5f) * (std::numbers::pi_v<float> / 2.0f);
+    const float a2 = a * a;
+    const float sinA = a * (1.0f - a2 / 6.0f * (1.0f - a2 / 20.0f * (1.0f - a2 / 42.0f * (1.0f - a2 / 72.0f))));
+    const float cosA = 1.0f - a2 / 2.0f * (1.0f - a2 / 12.0f * (1.0f - a2 / 30.0f * (1.0f - a2 / 56.0f)));
+    switch (quarter) {
+      case 0: return { cosA, sinA };
+      case 1: return { -sinA, cosA };
+      case 2: return { -cosA, -sinA };
+      default: return { sinA, -cosA };
+    }
+  }
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <span>
+
 
 namespace interpolation{
   template<typename T>
@@ -14,6 +16,26 @@ namespace interpolation{
     return lerp(top_lerp, bot_lerp, dy);
   }
 
+  // Inverse of the bicubic system matrix, layout as on wikipedia
+  inline constexpr float s_bicubic_inverse_matrix[16 * 16] = {
+    1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+    0,  0,  0,  0,  1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+    -3,  3,  0,  0,  -2,  -1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+    2,  -2,  0,  0,  1,  1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+    0,  0,  0,  0,  0,  0,  0,  0,  1,  0,  0,  0,  0,  0,  0,  0,
+    0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  1,  0,  0,  0,
+    0,  0,  0,  0,  0,  0,  0,  0,  -3,  3,  0,  0,  -2,  -1,  0,  0,
+    0,  0,  0,  0,  0,  0,  0,  0,  2,  -2,  0,  0,  1,  1,  0,  0,
+    -3,  0,  3,  0,  0,  0,  0,  0,  -2,  0,  -1,  0,  0,  0,  0,  0,
+    0,  0,  0,  0,  -3,  0,  3,  0,  0,  0,  0,  0,  -2,  0,  -1,  0,
+    9,  -9,  -9,  9,  6,  3,  -6,  -3,  6,  -6,  3,  -3,  4,  2,  2,  1,
+    -6,  6,  6,  -6,  -3,  -3,  3,  3,  -4,  4,  -2,  2,  -2,  -2,  -1,  -1,
+    2,  0,  -2,  0,  0,  0,  0,  0,  1,  0,  1,  0,  0,  0,  0,  0,
+    0,  0,  0,  0,  2,  0,  -2,  0,  0,  0,  0,  0,  1,  0,  1,  0,
+    -6,  6,  6,  -6,  -4,  -2,  4,  2,  -3,  3,  -3,  3,  -2,  -1,  -2,  -1,
+    4,  -4,  -4,  4,  2,  2,  -2,  -2,  2,  -2,  2,  -2,  1,  1,  1,  1
+  };
+
   template<typename T>
   struct BicubicCoefficients{
     T a[16];
@@ -24,25 +46,6 @@ namespace interpolation{
                                                    T dFx_top_left, T dFx_top_right, T dFx_bot_left, T dFx_bot_right,
                                                    T dFy_top_left, T dFy_top_right, T dFy_bot_left, T dFy_bot_right,
                                                    T dFxy_top_left, T dFxy_top_right, T dFxy_bot_left, T dFxy_bot_right) {
-    float wikiInverseA[16 * 16] = {
-      1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-      0,  0,  0,  0,  1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-      -3,  3,  0,  0,  -2,  -1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-      2,  -2,  0,  0,  1,  1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-      0,  0,  0,  0,  0,  0,  0,  0,  1,  0,  0,  0,  0,  0,  0,  0,
-      0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  1,  0,  0,  0,
-      0,  0,  0,  0,  0,  0,  0,  0,  -3,  3,  0,  0,  -2,  -1,  0,  0,
-      0,  0,  0,  0,  0,  0,  0,  0,  2,  -2,  0,  0,  1,  1,  0,  0,
-      -3,  0,  3,  0,  0,  0,  0,  0,  -2,  0,  -1,  0,  0,  0,  0,  0,
-      0,  0,  0,  0,  -3,  0,  3,  0,  0,  0,  0,  0,  -2,  0,  -1,  0,
-      9,  -9,  -9,  9,  6,  3,  -6,  -3,  6,  -6,  3,  -3,  4,  2,  2,  1,
-      -6,  6,  6,  -6,  -3,  -3,  3,  3,  -4,  4,  -2,  2,  -2,  -2,  -1,  -1,
-      2,  0,  -2,  0,  0,  0,  0,  0,  1,  0,  1,  0,  0,  0,  0,  0,
-      0,  0,  0,  0,  2,  0,  -2,  0,  0,  0,  0,  0,  1,  0,  1,  0,
-      -6,  6,  6,  -6,  -4,  -2,  4,  2,  -3,  3,  -3,  3,  -2,  -1,  -2,  -1,
-      4,  -4,  -4,  4,  2,  2,  -2,  -2,  2,  -2,  2,  -2,  1,  1,  1,  1
-    };
-
     T wikiX[16] = {
       F_top_left, F_top_right, F_bot_left, F_bot_right,
       dFx_top_left, dFx_top_right, dFx_bot_left, dFx_bot_right,
@@ -54,7 +57,7 @@ namespace interpolation{
     for (int i = 0; i < 16; ++i) {
       wikiCoefs.a[i] = T{};
       for (int j = 0; j < 16; ++j) {
-        wikiCoefs.a[i] += wikiInverseA[16 * i + j] * wikiX[j];
+        wikiCoefs.a[i] += s_bicubic_inverse_matrix[16 * i + j] * wikiX[j];
       }
     }
     return wikiCoefs;
@@ -74,5 +77,89 @@ namespace interpolation{
 
     return res;
   }
-}
 
+  // Closed-form Hermite formulation of the same bicubic patch, no 16x16 matrix involved.
+  // Cubic Hermite basis on [0, 1]: weights of the values and of the derivatives at both ends
+  struct HermiteWeights {
+    float value_near;
+    float value_far;
+    float derivative_near;
+    float derivative_far;
+  };
+
+  inline HermiteWeights calc_hermite_weights(float t) {
+    const float t2 = t * t;
+    const float t3 = t2 * t;
+    return {
+      .value_near = 2.0f * t3 - 3.0f * t2 + 1.0f,
+      .value_far = 3.0f * t2 - 2.0f * t3,
+      .derivative_near = t3 - 2.0f * t2 + t,
+      .derivative_far = t3 - t2
+    };
+  }
+
+  // Derivatives of the weights by t, give the derivative of the curve when used in place of the weights
+  inline HermiteWeights calc_hermite_weight_derivatives(float t) {
+    const float t2 = t * t;
+    return {
+      .value_near = 6.0f * t2 - 6.0f * t,
+      .value_far = 6.0f * t - 6.0f * t2,
+      .derivative_near = 3.0f * t2 - 4.0f * t + 1.0f,
+      .derivative_far = 3.0f * t2 - 2.0f * t
+    };
+  }
+
+  template<typename T>
+  T hermite(const HermiteWeights& weights, T value_near, T value_far, T derivative_near, T derivative_far) {
+    return weights.value_near * value_near + weights.value_far * value_far
+      + weights.derivative_near * derivative_near + weights.derivative_far * derivative_far;
+  }
+
+  template<typename T>
+  struct BicubicCorners {
+    T F_top_left, F_top_right, F_bot_left, F_bot_right;
+    T dFx_top_left, dFx_top_right, dFx_bot_left, dFx_bot_right;
+    T dFy_top_left, dFy_top_right, dFy_bot_left, dFy_bot_right;
+    T dFxy_top_left, dFxy_top_right, dFxy_bot_left, dFxy_bot_right;
+  };
+
+  // The patch restricted to a single row is a cubic in x, this is its Hermite form
+  template<typename T>
+  struct BicubicRow {
+    T value_left;
+    T value_right;
+    T derivative_left;
+    T derivative_right;
+  };
+
+  template<typename T>
+  BicubicRow<T> calc_bicubic_row(const BicubicCorners<T>& c, const HermiteWeights& wy) {
+    return {
+      .value_left = hermite(wy, c.F_top_left, c.F_bot_left, c.dFy_top_left, c.dFy_bot_left),
+      .value_right = hermite(wy, c.F_top_right, c.F_bot_right, c.dFy_top_right, c.dFy_bot_right),
+      .derivative_left = hermite(wy, c.dFx_top_left, c.dFx_bot_left, c.dFxy_top_left, c.dFxy_bot_left),
+      .derivative_right = hermite(wy, c.dFx_top_right, c.dFx_bot_right, c.dFxy_top_right, c.dFxy_bot_right)
+    };
+  }
+
+  template<typename T>
+  T bicubic(const HermiteWeights& wx, const BicubicRow<T>& row) {
+    return hermite(wx, row.value_left, row.value_right, row.derivative_left, row.derivative_right);
+  }
+
+  template<typename T>
+  T bicubic(const HermiteWeights& wx, const HermiteWeights& wy, const BicubicCorners<T>& corners) {
+    return bicubic(wx, calc_bicubic_row(corners, wy));
+  }
+
+  // Samples of one row of the patch, wx are the precomputed weights of every sample.
+  // Same results as calling bicubic for each of them
+  template<typename T>
+  void bicubic_row(std::span<const HermiteWeights> wx, const HermiteWeights& wy, const BicubicCorners<T>& corners,
+                   std::span<T> out) {
+    const BicubicRow<T> row = calc_bicubic_row(corners, wy);
+    for (size_t i = 0; i < wx.size(); ++i) {
+      out[i] = bicubic(wx[i], row);
+    }
+  }
+}
@@ -0,0 +1,25 @@
+#include "normal_map.hpp"
+
+
+void fill_normal_map_from_field(std::span<const float> field, int width, int height, float height_scale,
+                                std::span<uint32_t> out, int x0, int y0, int w, int h, size_t stride) {
+  auto at = [&](int x, int y) {
+    return field[size_t(y) * size_t(width) + size_t(x)] * height_scale;
+  };
+
+  for (int j = 0; j < h; ++j) {
+    const int y = y0 + j;
+    const int up = std::max(y - 1, 0);
+    const int down = std::min(y + 1, height - 1);
+    uint32_t* row = out.data() + size_t(j) * stride;
+    for (int i = 0; i < w; ++i) {
+      const int x = x0 + i;
+      const int left = std::max(x - 1, 0);
+      const int right = std::min(x + 1, width - 1);
+      // a field one pixel wide or high is flat along that axis
+      const float slopeX = right > left ? (at(right, y) - at(left, y)) / float(right - left) : 0.0f;
+      const float slopeY = down > up ? (at(x, down) - at(x, up)) / float(down - up) : 0.0f;
+      row[i] = normal_map::pack(slopeX, slopeY);
+    }
+  }
+}
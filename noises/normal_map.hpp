@@ -0,0 +1,33 @@
+#pragma once
+
+#include <span>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+
+namespace normal_map {
+  // Maps a component from [-1, 1] to [0, 255]
+  inline uint32_t pack_component(float component) {
+    return static_cast<uint32_t>(std::clamp(component * 127.5f + 127.5f, 0.0f, 255.0f) + 0.5f) & 0xffu;
+  }
+
+  // Normal of a height field with the slopes dh/dx and dh/dy, (-dh/dx, -dh/dy, 1) normalized.
+  // Packed as 8-bit R, G, B, A from the lowest byte up, y goes down the rows and z out of the texture, alpha is 255
+  inline uint32_t pack(float slope_x, float slope_y) {
+    const float normalX = -slope_x;
+    const float normalY = -slope_y;
+    const float length = std::sqrt(normalX * normalX + normalY * normalY + 1.0f);
+    return pack_component(normalX / length)
+      | pack_component(normalY / length) << 8
+      | pack_component(1.0f / length) << 16
+      | 0xffu << 24;
+  }
+}
+
+// Normals of the height field value * height_scale from width x height values stored row by row.
+// Slopes are central differences, one-sided at the edges. Evaluates w x h normals starting at (x0, y0)
+// into out, rows are stride pixels apart
+void fill_normal_map_from_field(std::span<const float> field, int width, int height, float height_scale,
+                                std::span<uint32_t> out, int x0, int y0, int w, int h, size_t stride);
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+
+namespace parallel {
+  // Thread count for a threads setting, 0 or less is one per hardware thread
+  inline size_t max_threads(int threads) {
+    return threads > 0 ? size_t(threads) : size_t(std::max(std::thread::hardware_concurrency(), 1u));
+  }
+
+  // Runs f(begin, end) on contiguous parts of [0, count), each part at least min_per_thread long
+  // unless count is smaller. The calling thread takes the first part and returns when all of them are done
+  void for_ranges(size_t count, size_t min_per_thread, int threads, auto f) {
+    const size_t threadsCount = std::clamp(count / std::max(min_per_thread, size_t(1)), size_t(1), max_threads(threads));
+    const size_t perThread = (count + threadsCount - 1) / threadsCount;
+
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < threadsCount; ++t) {
+      workers.emplace_back(f, std::min(count, t * perThread), std::min(count, (t + 1) * perThread));
+    }
+    f(size_t(0), std::min(count, perThread));
+    for (auto& worker : workers) {
+      worker.join();
+    }
+  }
+}
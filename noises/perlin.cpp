@@ -1,42 +1,92 @@
 #include "perlin.hpp"
 
 #include <cmath>
+#include <cassert>
 #include <utility>
 #include <algorithm>
+#include <limits>
+#include <optional>
 #include <interpolation.hpp>
+#include <parallel.hpp>
+#include <normal_map.hpp>
+#include <gradients.hpp>
+#include <simd/perlin_simd.hpp>
 
 
-float PerlinNoise::operator()(float x, float y) const {
-  float centeredX = x - m_parameters.offset_x;
-  float centeredY = y - m_parameters.offset_y;
+using InterpolationAlgorithm = PerlinNoiseParameters::InterpolationAlgorithm;
 
-  float fIndexX = centeredX / m_parameters.grid_step_x;
-  float fIndexY = centeredY / m_parameters.grid_step_y;
+static constexpr size_t s_min_nodes_per_thread = 1 << 16; // gradient generation
+static constexpr int s_supersample_stripe_width = 256; // columns of one supersampled pass
+static constexpr size_t s_min_points_to_sort = 1 << 10; // sample_many
+static constexpr size_t s_max_sort_tiles = 1 << 12; // sample_many
+static constexpr size_t s_min_points_per_thread = 1 << 14; // sample_many
 
-  int left = int(fIndexX);
-  int top = int(fIndexY);
-  int right = left + 1;
-  int bot = top + 1;
+namespace {
+  // Everything about a sample that depends on a single coordinate only.
+  // For a block of samples it is the same for a whole column (or row) and is computed once.
+  struct AxisSample {
+    float centered;
+    int near_cell;
+    float near_pos;
+    float near_offset;
+    float far_offset;
+    float interp_k;
+    interpolation::HermiteWeights hermite;
+    bool is_near_half;
+    bool inside;
+  };
 
-  if (left < 0 || right >= m_parameters.grid_size_x) {
-    return 0.0f;
+  struct CellGradients {
+    const float* top_left;
+    const float* top_right;
+    const float* bot_right;
+    const float* bot_left;
+  };
+}
+
+// Unbounded noise has cells everywhere, bounded one only between the grid nodes.
+// Periodic noise wraps the coordinate into the first period, so the samples of every period are the same
+static AxisSample calc_axis_sample(float coord, float offset, float step, int grid_size, bool unbounded, int period = 0) {
+  float centered = coord - offset;
+  if (period > 0) {
+    const float length = step * float(period);
+    centered -= length * std::floor(centered / length);
   }
+  float fIndex = centered / step;
 
-  if (top < 0 || bot >= m_parameters.grid_size_y) {
-    return 0.0f;
+  int nearCell = unbounded ? int(std::floor(fIndex)) : int(fIndex);
+  if (period > 0) {
+    // centered just below the length may round up to it
+    nearCell = std::min(nearCell, period - 1);
   }
+  int farCell = nearCell + 1;
+
+  float nearPos = step * float(nearCell);
+  float farPos = step * float(farCell);
+  float interpK = (centered - nearPos) / step;
 
-  float leftPos = m_parameters.grid_step_x * float(left);
-  float rightPos = m_parameters.grid_step_x * float(right);
-  float topPos = m_parameters.grid_step_y * float(top);
-  float botPos = m_parameters.grid_step_y * float(bot);
+  return {
+    .centered = centered,
+    .near_cell = nearCell,
+    .near_pos = nearPos,
+    .near_offset = nearPos - centered,
+    .far_offset = farPos - centered,
+    .interp_k = interpK,
+    .hermite = interpolation::calc_hermite_weights(interpK),
+    .is_near_half = centered - nearPos <= step / 2.0f,
+    .inside = unbounded || (nearCell >= 0 && farCell < grid_size)
+  };
+}
 
-  float topLeftOffset[2] = { leftPos - centeredX, topPos - centeredY };
-  float topRightOffset[2] = { rightPos - centeredX, topPos - centeredY };
-  float botRightOffset[2] = { rightPos - centeredX, botPos - centeredY };
-  float botLeftOffset[2] = { leftPos - centeredX, botPos - centeredY };
+template<InterpolationAlgorithm algorithm, bool normalize_offsets>
+static float evaluate_in_cell(float cell_diagonal,
+                              const AxisSample& sx, const AxisSample& sy, const CellGradients& cell) {
+  float topLeftOffset[2] = { sx.near_offset, sy.near_offset };
+  float topRightOffset[2] = { sx.far_offset, sy.near_offset };
+  float botRightOffset[2] = { sx.far_offset, sy.far_offset };
+  float botLeftOffset[2] = { sx.near_offset, sy.far_offset };
 
-  if (m_parameters.normalize_offsets) {
+  if constexpr (normalize_offsets) {
     float topLeftOffsetLen = std::sqrt(topLeftOffset[0] * topLeftOffset[0] + topLeftOffset[1] * topLeftOffset[1]);
     topLeftOffset[0] /= topLeftOffsetLen;
     topLeftOffset[1] /= topLeftOffsetLen;
@@ -54,10 +104,10 @@ float PerlinNoise::operator()(float x, float y) const {
     botLeftOffset[1] /= botLeftOffsetLen;
   }
 
-  const float* topLeftValue = get_grid_node_data(left, top);
-  const float* topRightValue = get_grid_node_data(right, top);
-  const float* botRightValue = get_grid_node_data(right, bot);
-  const float* botLeftValue = get_grid_node_data(left, bot);
+  const float* topLeftValue = cell.top_left;
+  const float* topRightValue = cell.top_right;
+  const float* botRightValue = cell.bot_right;
+  const float* botLeftValue = cell.bot_left;
 
   float topLeftDot = topLeftOffset[0] * topLeftValue[0] + topLeftOffset[1] * topLeftValue[1];
   float topRightDot = topRightOffset[0] * topRightValue[0] + topRightOffset[1] * topRightValue[1];
@@ -66,68 +116,1014 @@ float PerlinNoise::operator()(float x, float y) const {
 
   float result = 0.0f;
   // interpolate between this values
-  switch (m_parameters.interpolation_algorithm) {
-    case PerlinNoiseParameters::InterpolationAlgorithm::bilinear: {
-      auto horInterpK = (centeredX - leftPos) / m_parameters.grid_step_x;
-      auto vertInterpK = (centeredY - topPos) / m_parameters.grid_step_y;
-
-      result = interpolation::bilinear(topLeftDot, topRightDot, botLeftDot, botRightDot, horInterpK, vertInterpK);
-      break;
-    }
-    case PerlinNoiseParameters::InterpolationAlgorithm::bicubic: {
-      auto coefs = interpolation::calc_bicubic_coefficients(
-          topLeftDot, topRightDot, botLeftDot, botRightDot,
-          topLeftValue[0], topRightValue[0], botLeftValue[0], botRightValue[0],
-          topLeftValue[1], topRightValue[1], botLeftValue[1], botRightValue[1],
-          0.0f, 0.0f, 0.0f, 0.0f
-      );
-
-      auto horInterpK = (centeredX - leftPos) / m_parameters.grid_step_x;
-      auto vertInterpK = (centeredY - topPos) / m_parameters.grid_step_y;
-
-      result = interpolation::bicubic(horInterpK, vertInterpK, coefs);
-      break;
-    }
-    case PerlinNoiseParameters::InterpolationAlgorithm::bicubic_zero: {
-      auto coefs = interpolation::calc_bicubic_coefficients(
-          topLeftDot, topRightDot, botLeftDot, botRightDot,
-          0.0f, 0.0f, 0.0f, 0.0f,
-          0.0f, 0.0f, 0.0f, 0.0f,
-          0.0f, 0.0f, 0.0f, 0.0f
-      );
-
-      auto horInterpK = (centeredX - leftPos) / m_parameters.grid_step_x;
-      auto vertInterpK = (centeredY - topPos) / m_parameters.grid_step_y;
-
-      result = interpolation::bicubic(horInterpK, vertInterpK, coefs);
-      break;
-    }
-    case PerlinNoiseParameters::InterpolationAlgorithm::nearest_neighboor: {
-      auto dx = centeredX - leftPos;
-      auto dy = centeredY - topPos;
-
-      bool isLeft = dx <= m_parameters.grid_step_x / 2.0f;
-      bool isTop = dy <= m_parameters.grid_step_y / 2.0f;
-
-      result = isLeft & isTop ? topLeftDot
-        : isLeft & !isTop ? botLeftDot
-        : !isLeft & isTop ? topRightDot
-        : botRightDot;
-      break;
-    }
-    default:
-      std::unreachable();
-  }
-  float cellDiagonal = std::sqrt(m_parameters.grid_step_x * m_parameters.grid_step_x + m_parameters.grid_step_y * m_parameters.grid_step_y);
-  float normalizedResult = m_parameters.normalize_offsets ? result : result / cellDiagonal;
+  if constexpr (algorithm == InterpolationAlgorithm::bilinear) {
+    result = interpolation::bilinear(topLeftDot, topRightDot, botLeftDot, botRightDot, sx.interp_k, sy.interp_k);
+  } else if constexpr (algorithm == InterpolationAlgorithm::bicubic) {
+    // gradients are the derivatives, there are no cross derivatives
+    result = interpolation::bicubic(sx.hermite, sy.hermite, interpolation::BicubicCorners<float>{
+      .F_top_left = topLeftDot, .F_top_right = topRightDot, .F_bot_left = botLeftDot, .F_bot_right = botRightDot,
+      .dFx_top_left = topLeftValue[0], .dFx_top_right = topRightValue[0],
+      .dFx_bot_left = botLeftValue[0], .dFx_bot_right = botRightValue[0],
+      .dFy_top_left = topLeftValue[1], .dFy_top_right = topRightValue[1],
+      .dFy_bot_left = botLeftValue[1], .dFy_bot_right = botRightValue[1],
+      .dFxy_top_left = 0.0f, .dFxy_top_right = 0.0f, .dFxy_bot_left = 0.0f, .dFxy_bot_right = 0.0f
+    });
+  } else if constexpr (algorithm == InterpolationAlgorithm::bicubic_zero) {
+    result = interpolation::bicubic(sx.hermite, sy.hermite, interpolation::BicubicCorners<float>{
+      .F_top_left = topLeftDot, .F_top_right = topRightDot, .F_bot_left = botLeftDot, .F_bot_right = botRightDot,
+      .dFx_top_left = 0.0f, .dFx_top_right = 0.0f, .dFx_bot_left = 0.0f, .dFx_bot_right = 0.0f,
+      .dFy_top_left = 0.0f, .dFy_top_right = 0.0f, .dFy_bot_left = 0.0f, .dFy_bot_right = 0.0f,
+      .dFxy_top_left = 0.0f, .dFxy_top_right = 0.0f, .dFxy_bot_left = 0.0f, .dFxy_bot_right = 0.0f
+    });
+  } else if constexpr (algorithm == InterpolationAlgorithm::nearest_neighboor) {
+    bool isLeft = sx.is_near_half;
+    bool isTop = sy.is_near_half;
+
+    result = isLeft & isTop ? topLeftDot
+      : isLeft & !isTop ? botLeftDot
+      : !isLeft & isTop ? topRightDot
+      : botRightDot;
+  } else {
+    std::unreachable();
+  }
+  float normalizedResult = normalize_offsets ? result : result / cell_diagonal;
   return std::clamp((1.0f + normalizedResult) / 2.0f, 0.0f, 1.0f);
 }
 
-float* PerlinNoise::get_grid_node_data(int x, int y) {
-  return &m_grid_data[size_t(x + y * m_parameters.grid_size_x) * 2];
+static float calc_cell_diagonal(const PerlinNoiseParameters& params) {
+  return std::sqrt(params.grid_step_x * params.grid_step_x + params.grid_step_y * params.grid_step_y);
+}
+
+static CellGradients get_cell_gradients(const PerlinNoise& noise, int left, int top) {
+  return {
+    .top_left = noise.gradient(left, top),
+    .top_right = noise.gradient(left + 1, top),
+    .bot_right = noise.gradient(left + 1, top + 1),
+    .bot_left = noise.gradient(left, top + 1)
+  };
+}
+
+namespace {
+  // Column data in the layout the vectorized row kernels read
+  struct ColumnArrays {
+    std::vector<float> near_offset;
+    std::vector<float> far_offset;
+    std::vector<float> interp_k;
+    std::vector<float> hermite_value_near;
+    std::vector<float> hermite_value_far;
+    std::vector<float> hermite_derivative_near;
+    std::vector<float> hermite_derivative_far;
+    std::vector<int> near_cell;
+    std::vector<int> is_near_half;
+    std::vector<int> inside;
+
+    explicit ColumnArrays(const std::vector<AxisSample>& columns) {
+      near_offset.reserve(columns.size());
+      far_offset.reserve(columns.size());
+      interp_k.reserve(columns.size());
+      hermite_value_near.reserve(columns.size());
+      hermite_value_far.reserve(columns.size());
+      hermite_derivative_near.reserve(columns.size());
+      hermite_derivative_far.reserve(columns.size());
+      near_cell.reserve(columns.size());
+      is_near_half.reserve(columns.size());
+      inside.reserve(columns.size());
+      for (const auto& column : columns) {
+        near_offset.push_back(column.near_offset);
+        far_offset.push_back(column.far_offset);
+        interp_k.push_back(column.interp_k);
+        hermite_value_near.push_back(column.hermite.value_near);
+        hermite_value_far.push_back(column.hermite.value_far);
+        hermite_derivative_near.push_back(column.hermite.derivative_near);
+        hermite_derivative_far.push_back(column.hermite.derivative_far);
+        near_cell.push_back(column.near_cell);
+        is_near_half.push_back(column.is_near_half ? -1 : 0);
+        inside.push_back(column.inside ? -1 : 0);
+      }
+    }
+  };
+}
+
+namespace {
+  // Per-column setup of a block, fills its rows one at a time.
+  // Columns are at x0 + i + shift_x, so supersampling can fill several sub-pixel columns of the same block
+  template<InterpolationAlgorithm algorithm, bool normalize_offsets>
+  class BlockRowFiller {
+  public:
+    BlockRowFiller(const PerlinNoise& noise, int x0, int w, float shift_x)
+    : m_noise(&noise)
+    , m_cell_diagonal(calc_cell_diagonal(noise.m_parameters))
+    , m_unbounded(noise.is_unbounded())
+    , m_columns(static_cast<size_t>(w))
+    , m_row_kernel(simd::perlin_row_kernel()) {
+      const auto& params = noise.m_parameters;
+      for (int i = 0; i < w; ++i) {
+        m_columns[size_t(i)] = calc_axis_sample(float(x0 + i) + shift_x, params.offset_x, params.grid_step_x, params.grid_size_x, m_unbounded, params.period_x);
+      }
+
+      if (m_row_kernel != nullptr) {
+        m_column_arrays.emplace(m_columns);
+      }
+    }
+
+    void fill_row(float* row, float y) {
+      const PerlinNoise& noise = *m_noise;
+      const auto& params = noise.m_parameters;
+      const int w = int(m_columns.size());
+      const AxisSample sy = calc_axis_sample(y, params.offset_y, params.grid_step_y, params.grid_size_y, m_unbounded, params.period_y);
+      if (!sy.inside) {
+        std::fill_n(row, w, 0.0f);
+        return;
+      }
+
+      int i = 0;
+      if (m_column_arrays) {
+        i = m_row_kernel(simd::PerlinRowArgs{
+          .grid = noise.m_grid_data.empty() ? nullptr : noise.m_grid_data.data(),
+          .gradient_indices = noise.m_gradient_indices.empty() ? nullptr : noise.m_gradient_indices.data(),
+          .grid_size_x = params.grid_size_x,
+          .gradient_table = gradients::s_unit_vectors.data(),
+          .gradient_seed = noise.m_hash_seed,
+          .top = sy.near_cell,
+
+          .near_offset_x = m_column_arrays->near_offset.data(),
+          .far_offset_x = m_column_arrays->far_offset.data(),
+          .interp_k_x = m_column_arrays->interp_k.data(),
+          .hermite_value_near_x = m_column_arrays->hermite_value_near.data(),
+          .hermite_value_far_x = m_column_arrays->hermite_value_far.data(),
+          .hermite_derivative_near_x = m_column_arrays->hermite_derivative_near.data(),
+          .hermite_derivative_far_x = m_column_arrays->hermite_derivative_far.data(),
+          .near_cell_x = m_column_arrays->near_cell.data(),
+          .is_near_half_x = m_column_arrays->is_near_half.data(),
+          .inside_x = m_column_arrays->inside.data(),
+
+          .near_offset_y = sy.near_offset,
+          .far_offset_y = sy.far_offset,
+          .interp_k_y = sy.interp_k,
+          .hermite_y = sy.hermite,
+          .is_near_half_y = sy.is_near_half,
+
+          .cell_diagonal = m_cell_diagonal,
+          .interpolation_algorithm = algorithm,
+          .normalize_offsets = normalize_offsets,
+
+          .out = row,
+          .count = w
+        });
+      }
+
+      // whatever did not fit into whole vectors
+      while (i < w) {
+        const AxisSample& first = m_columns[size_t(i)];
+        int runEnd = i + 1;
+        while (runEnd < w && m_columns[size_t(runEnd)].near_cell == first.near_cell) {
+          ++runEnd;
+        }
+
+        if (!first.inside) {
+          std::fill(row + i, row + runEnd, 0.0f);
+        } else {
+          const CellGradients cell = get_cell_gradients(noise, first.near_cell, sy.near_cell);
+          for (; i < runEnd; ++i) {
+            row[i] = evaluate_in_cell<algorithm, normalize_offsets>(m_cell_diagonal, m_columns[size_t(i)], sy, cell);
+          }
+        }
+        i = runEnd;
+      }
+    }
+
+  private:
+    const PerlinNoise* m_noise;
+    float m_cell_diagonal;
+    bool m_unbounded;
+    std::vector<AxisSample> m_columns;
+    simd::perlin_row_kernel_t m_row_kernel;
+    std::optional<ColumnArrays> m_column_arrays;
+  };
+}
+
+template<InterpolationAlgorithm algorithm, bool normalize_offsets>
+static void fill_block(const PerlinNoise& noise, std::span<float> out, int x0, int y0, int w, int h, size_t stride) {
+  BlockRowFiller<algorithm, normalize_offsets> filler(noise, x0, w, 0.0f);
+  for (int j = 0; j < h; ++j) {
+    filler.fill_row(out.data() + size_t(j) * stride, float(y0 + j));
+  }
+}
+
+// Offsets of the samples from the pixel center, in (-0.5, 0.5). The grid has samples x samples evenly spaced
+// positions. The rotated grid has the same count, but every sample is in its own column and row of the
+// samples^2 x samples^2 subdivision, so edges close to horizontal or vertical get more distinct steps.
+// For 2 x 2 it is the usual rotated grid pattern
+static std::vector<std::array<float, 2>> calc_supersample_offsets(const Supersampling& supersampling) {
+  const int n = supersampling.samples;
+  std::vector<std::array<float, 2>> offsets;
+  offsets.reserve(size_t(n) * size_t(n));
+  for (int b = 0; b < n; ++b) {
+    for (int a = 0; a < n; ++a) {
+      if (supersampling.pattern == Supersampling::Pattern::rotated_grid) {
+        offsets.push_back({
+          (float(a * n + b) + 0.5f) / float(n * n) - 0.5f,
+          (float(b * n + (n - 1 - a)) + 0.5f) / float(n * n) - 0.5f
+        });
+      } else {
+        offsets.push_back({ (float(a) + 0.5f) / float(n) - 0.5f, (float(b) + 0.5f) / float(n) - 0.5f });
+      }
+    }
+  }
+  return offsets;
+}
+
+// Every sample of a row goes into a small buffer and is added to the row sums, the output is written once per row.
+// Columns are filled in stripes, so the per-column setup of all sub-pixel columns stays small
+template<InterpolationAlgorithm algorithm, bool normalize_offsets>
+static void fill_supersampled_block(const PerlinNoise& noise, std::span<float> out, int x0, int y0, int w, int h, size_t stride,
+                                    const Supersampling& supersampling) {
+  const std::vector<std::array<float, 2>> offsets = calc_supersample_offsets(supersampling);
+  // a grid shares its column setup between the rows of samples
+  const bool rotated = supersampling.pattern == Supersampling::Pattern::rotated_grid;
+  const int n = supersampling.samples;
+  const size_t fillersCount = rotated ? offsets.size() : size_t(n);
+  const float samplesCount = float(offsets.size());
+
+  std::vector<float> sums;
+  std::vector<float> samples;
+  std::vector<BlockRowFiller<algorithm, normalize_offsets>> fillers;
+  for (int stripeX = 0; stripeX < w; stripeX += s_supersample_stripe_width) {
+    const int stripeWidth = std::min(s_supersample_stripe_width, w - stripeX);
+    fillers.clear();
+    for (size_t f = 0; f < fillersCount; ++f) {
+      fillers.emplace_back(noise, x0 + stripeX, stripeWidth, offsets[f][0]);
+    }
+    sums.assign(size_t(stripeWidth), 0.0f);
+    samples.resize(size_t(stripeWidth));
+
+    for (int j = 0; j < h; ++j) {
+      std::fill(sums.begin(), sums.end(), 0.0f);
+      for (size_t k = 0; k < offsets.size(); ++k) {
+        fillers[rotated ? k : k % size_t(n)].fill_row(samples.data(), float(y0 + j) + offsets[k][1]);
+        for (int i = 0; i < stripeWidth; ++i) {
+          sums[size_t(i)] += samples[size_t(i)];
+        }
+      }
+      float* row = out.data() + size_t(j) * stride + size_t(stripeX);
+      for (int i = 0; i < stripeWidth; ++i) {
+        row[i] = sums[size_t(i)] / samplesCount;
+      }
+    }
+  }
+}
+
+namespace {
+  // Dot product of a corner gradient with the offset to the corner, and its derivatives by the sample position
+  struct CornerDot {
+    float value;
+    float dx;
+    float dy;
+  };
+}
+
+template<bool normalize_offsets>
+static CornerDot calc_corner_dot(float offset_x, float offset_y, const float* gradient) {
+  if constexpr (normalize_offsets) {
+    // the offset moves by -1 along the axis, its direction turns by (offset * offset_axis - axis) / length
+    const float length = std::sqrt(offset_x * offset_x + offset_y * offset_y);
+    const float unitX = offset_x / length;
+    const float unitY = offset_y / length;
+    const float dot = unitX * gradient[0] + unitY * gradient[1];
+    return {
+      .value = dot,
+      .dx = (dot * unitX - gradient[0]) / length,
+      .dy = (dot * unitY - gradient[1]) / length
+    };
+  } else {
+    return {
+      .value = offset_x * gradient[0] + offset_y * gradient[1],
+      .dx = -gradient[0],
+      .dy = -gradient[1]
+    };
+  }
+}
+
+// Derivatives of the interpolation before it is mapped to [0, 1]. The corner values depend on the sample
+// position and so do the weights, both parts are added up
+static interpolation::BicubicCorners<float> value_corners(float top_left, float top_right, float bot_left, float bot_right) {
+  return {
+    .F_top_left = top_left, .F_top_right = top_right, .F_bot_left = bot_left, .F_bot_right = bot_right,
+    .dFx_top_left = 0.0f, .dFx_top_right = 0.0f, .dFx_bot_left = 0.0f, .dFx_bot_right = 0.0f,
+    .dFy_top_left = 0.0f, .dFy_top_right = 0.0f, .dFy_bot_left = 0.0f, .dFy_bot_right = 0.0f,
+    .dFxy_top_left = 0.0f, .dFxy_top_right = 0.0f, .dFxy_bot_left = 0.0f, .dFxy_bot_right = 0.0f
+  };
+}
+
+template<InterpolationAlgorithm algorithm, bool normalize_offsets>
+static std::array<float, 2> calc_raw_derivatives(const PerlinNoiseParameters& params,
+                                                 const AxisSample& sx, const AxisSample& sy, const CellGradients& cell) {
+  const CornerDot topLeft = calc_corner_dot<normalize_offsets>(sx.near_offset, sy.near_offset, cell.top_left);
+  const CornerDot topRight = calc_corner_dot<normalize_offsets>(sx.far_offset, sy.near_offset, cell.top_right);
+  const CornerDot botRight = calc_corner_dot<normalize_offsets>(sx.far_offset, sy.far_offset, cell.bot_right);
+  const CornerDot botLeft = calc_corner_dot<normalize_offsets>(sx.near_offset, sy.far_offset, cell.bot_left);
+
+  if constexpr (algorithm == InterpolationAlgorithm::bilinear) {
+    return {
+      interpolation::lerp(topRight.value - topLeft.value, botRight.value - botLeft.value, sy.interp_k) / params.grid_step_x
+        + interpolation::bilinear(topLeft.dx, topRight.dx, botLeft.dx, botRight.dx, sx.interp_k, sy.interp_k),
+      interpolation::lerp(botLeft.value - topLeft.value, botRight.value - topRight.value, sx.interp_k) / params.grid_step_y
+        + interpolation::bilinear(topLeft.dy, topRight.dy, botLeft.dy, botRight.dy, sx.interp_k, sy.interp_k)
+    };
+  } else if constexpr (algorithm == InterpolationAlgorithm::bicubic || algorithm == InterpolationAlgorithm::bicubic_zero) {
+    const bool withGradients = algorithm == InterpolationAlgorithm::bicubic;
+    const interpolation::BicubicCorners<float> corners{
+      .F_top_left = topLeft.value, .F_top_right = topRight.value, .F_bot_left = botLeft.value, .F_bot_right = botRight.value,
+      .dFx_top_left = withGradients ? cell.top_left[0] : 0.0f, .dFx_top_right = withGradients ? cell.top_right[0] : 0.0f,
+      .dFx_bot_left = withGradients ? cell.bot_left[0] : 0.0f, .dFx_bot_right = withGradients ? cell.bot_right[0] : 0.0f,
+      .dFy_top_left = withGradients ? cell.top_left[1] : 0.0f, .dFy_top_right = withGradients ? cell.top_right[1] : 0.0f,
+      .dFy_bot_left = withGradients ? cell.bot_left[1] : 0.0f, .dFy_bot_right = withGradients ? cell.bot_right[1] : 0.0f,
+      .dFxy_top_left = 0.0f, .dFxy_top_right = 0.0f, .dFxy_bot_left = 0.0f, .dFxy_bot_right = 0.0f
+    };
+    const auto hermiteDx = interpolation::calc_hermite_weight_derivatives(sx.interp_k);
+    const auto hermiteDy = interpolation::calc_hermite_weight_derivatives(sy.interp_k);
+    return {
+      interpolation::bicubic(hermiteDx, sy.hermite, corners) / params.grid_step_x
+        + interpolation::bicubic(sx.hermite, sy.hermite, value_corners(topLeft.dx, topRight.dx, botLeft.dx, botRight.dx)),
+      interpolation::bicubic(sx.hermite, hermiteDy, corners) / params.grid_step_y
+        + interpolation::bicubic(sx.hermite, sy.hermite, value_corners(topLeft.dy, topRight.dy, botLeft.dy, botRight.dy))
+    };
+  } else if constexpr (algorithm == InterpolationAlgorithm::nearest_neighboor) {
+    const bool isLeft = sx.is_near_half;
+    const bool isTop = sy.is_near_half;
+    const CornerDot& corner = isLeft & isTop ? topLeft
+      : isLeft & !isTop ? botLeft
+      : !isLeft & isTop ? topRight
+      : botRight;
+    return { corner.dx, corner.dy };
+  } else {
+    std::unreachable();
+  }
+}
+
+template<InterpolationAlgorithm algorithm, bool normalize_offsets>
+static PerlinDerivatives evaluate_derivatives_in_cell(const PerlinNoiseParameters& params, float cell_diagonal,
+                                                      const AxisSample& sx, const AxisSample& sy, const CellGradients& cell) {
+  const float value = evaluate_in_cell<algorithm, normalize_offsets>(cell_diagonal, sx, sy, cell);
+  if (value <= 0.0f || value >= 1.0f) {
+    return { .value = value, .dx = 0.0f, .dy = 0.0f };
+  }
+
+  const auto raw = calc_raw_derivatives<algorithm, normalize_offsets>(params, sx, sy, cell);
+  const float scale = normalize_offsets ? 0.5f : 0.5f / cell_diagonal;
+  return { .value = value, .dx = raw[0] * scale, .dy = raw[1] * scale };
+}
+
+template<InterpolationAlgorithm algorithm, bool normalize_offsets>
+float PerlinEvaluator<algorithm, normalize_offsets>::operator()(float x, float y) const {
+  const auto& params = m_noise->m_parameters;
+  const bool unbounded = m_noise->is_unbounded();
+  const AxisSample sx = calc_axis_sample(x, params.offset_x, params.grid_step_x, params.grid_size_x, unbounded, params.period_x);
+  if (!sx.inside) {
+    return 0.0f;
+  }
+
+  const AxisSample sy = calc_axis_sample(y, params.offset_y, params.grid_step_y, params.grid_size_y, unbounded, params.period_y);
+  if (!sy.inside) {
+    return 0.0f;
+  }
+
+  const CellGradients cell = get_cell_gradients(*m_noise, sx.near_cell, sy.near_cell);
+  return evaluate_in_cell<algorithm, normalize_offsets>(calc_cell_diagonal(params), sx, sy, cell);
+}
+
+template<InterpolationAlgorithm algorithm, bool normalize_offsets>
+void PerlinEvaluator<algorithm, normalize_offsets>::fill(std::span<float> out, int x0, int y0, int w, int h, size_t stride) const {
+  if (w <= 0 || h <= 0) {
+    return;
+  }
+  fill_block<algorithm, normalize_offsets>(*m_noise, out, x0, y0, w, h, stride);
+}
+
+template<InterpolationAlgorithm algorithm, bool normalize_offsets>
+void PerlinEvaluator<algorithm, normalize_offsets>::fill_supersampled(std::span<float> out, int x0, int y0, int w, int h, size_t stride,
+                                                                     const Supersampling& supersampling) const {
+  if (w <= 0 || h <= 0) {
+    return;
+  }
+  const Supersampling clamped{
+    .pattern = supersampling.pattern,
+    .samples = std::clamp(supersampling.samples, 1, Supersampling::s_max_samples)
+  };
+  if (clamped.samples == 1) {
+    fill_block<algorithm, normalize_offsets>(*m_noise, out, x0, y0, w, h, stride);
+    return;
+  }
+  fill_supersampled_block<algorithm, normalize_offsets>(*m_noise, out, x0, y0, w, h, stride, clamped);
 }
 
-const float* PerlinNoise::get_grid_node_data(int x, int y) const {
-  return &m_grid_data[size_t(x + y * m_parameters.grid_size_x) * 2];
+template<InterpolationAlgorithm algorithm, bool normalize_offsets>
+void PerlinEvaluator<algorithm, normalize_offsets>::fill_row(std::span<float> out, int x0, int y, int w) const {
+  fill(out, x0, y, w, 1, size_t(w));
+}
+
+template<InterpolationAlgorithm algorithm, bool normalize_offsets>
+PerlinDerivatives PerlinEvaluator<algorithm, normalize_offsets>::derivatives(float x, float y) const {
+  const auto& params = m_noise->m_parameters;
+  const bool unbounded = m_noise->is_unbounded();
+  const AxisSample sx = calc_axis_sample(x, params.offset_x, params.grid_step_x, params.grid_size_x, unbounded, params.period_x);
+  const AxisSample sy = calc_axis_sample(y, params.offset_y, params.grid_step_y, params.grid_size_y, unbounded, params.period_y);
+  if (!sx.inside || !sy.inside) {
+    return {};
+  }
+
+  const CellGradients cell = get_cell_gradients(*m_noise, sx.near_cell, sy.near_cell);
+  return evaluate_derivatives_in_cell<algorithm, normalize_offsets>(params, calc_cell_diagonal(params), sx, sy, cell);
 }
 
+template<InterpolationAlgorithm algorithm, bool normalize_offsets>
+void PerlinEvaluator<algorithm, normalize_offsets>::fill_derivatives(std::span<PerlinDerivatives> out,
+                                                                     int x0, int y0, int w, int h, size_t stride) const {
+  if (w <= 0 || h <= 0) {
+    return;
+  }
+  const auto& params = m_noise->m_parameters;
+  const float cellDiagonal = calc_cell_diagonal(params);
+  const bool unbounded = m_noise->is_unbounded();
+
+  std::vector<AxisSample> columns(static_cast<size_t>(w));
+  for (int i = 0; i < w; ++i) {
+    columns[size_t(i)] = calc_axis_sample(float(x0 + i), params.offset_x, params.grid_step_x, params.grid_size_x, unbounded, params.period_x);
+  }
+
+  for (int j = 0; j < h; ++j) {
+    PerlinDerivatives* row = out.data() + size_t(j) * stride;
+    const AxisSample sy = calc_axis_sample(float(y0 + j), params.offset_y, params.grid_step_y, params.grid_size_y, unbounded, params.period_y);
+    if (!sy.inside) {
+      std::fill_n(row, w, PerlinDerivatives{});
+      continue;
+    }
+
+    // one cell setup per run of columns in the same cell
+    int i = 0;
+    while (i < w) {
+      const AxisSample& first = columns[size_t(i)];
+      int runEnd = i + 1;
+      while (runEnd < w && columns[size_t(runEnd)].near_cell == first.near_cell) {
+        ++runEnd;
+      }
+
+      if (!first.inside) {
+        std::fill(row + i, row + runEnd, PerlinDerivatives{});
+      } else {
+        const CellGradients cell = get_cell_gradients(*m_noise, first.near_cell, sy.near_cell);
+        for (; i < runEnd; ++i) {
+          row[i] = evaluate_derivatives_in_cell<algorithm, normalize_offsets>(params, cellDiagonal, columns[size_t(i)], sy, cell);
+        }
+      }
+      i = runEnd;
+    }
+  }
+}
+
+namespace {
+  // Points of sample_many in the order of their tiles, indices are the original places of the points
+  struct SortedPoints {
+    std::vector<std::array<float, 2>> points;
+    std::vector<uint32_t> indices;
+  };
+}
+
+// Counting sort into square tiles over the bounds of the points, tiles go row by row. There are few enough of them that
+// the sort writes stay in cache, and the gradients of a tile are few enough to stay in cache while it is evaluated.
+// Tiles are taken in point coordinates, a periodic noise just visits the same cells from several of them
+static SortedPoints sort_points_by_tile(std::span<const std::array<float, 2>> points, float step_x, float step_y) {
+  std::array<float, 2> lo = points[0];
+  std::array<float, 2> hi = points[0];
+  for (const auto& point : points) {
+    lo = { std::min(lo[0], point[0]), std::min(lo[1], point[1]) };
+    hi = { std::max(hi[0], point[0]), std::max(hi[1], point[1]) };
+  }
+  const double cellsX = (double(hi[0]) - double(lo[0])) / double(step_x);
+  const double cellsY = (double(hi[1]) - double(lo[1])) / double(step_y);
+  if (!std::isfinite(cellsX) || !std::isfinite(cellsY)) {
+    return {};
+  }
+  double tileCells = 1.0;
+  while ((std::floor(cellsX / tileCells) + 1.0) * (std::floor(cellsY / tileCells) + 1.0) > double(s_max_sort_tiles)) {
+    tileCells *= 2.0;
+  }
+  const int tilesX = int(cellsX / tileCells) + 1;
+  const int tilesY = int(cellsY / tileCells) + 1;
+  const float scaleX = float(1.0 / (tileCells * double(step_x)));
+  const float scaleY = float(1.0 / (tileCells * double(step_y)));
+
+  // NaN coordinates fail the comparisons and go to the first tile
+  auto tileOf = [&](const std::array<float, 2>& point) {
+    const float tx = (point[0] - lo[0]) * scaleX;
+    const float ty = (point[1] - lo[1]) * scaleY;
+    const int tileX = tx > 0.0f ? std::min(int(tx), tilesX - 1) : 0;
+    const int tileY = ty > 0.0f ? std::min(int(ty), tilesY - 1) : 0;
+    return uint16_t(tileY * tilesX + tileX);
+  };
+  static_assert(s_max_sort_tiles <= std::numeric_limits<uint16_t>::max() + 1);
+
+  std::vector<uint16_t> tiles(points.size());
+  std::vector<uint32_t> tileStarts(size_t(tilesX) * size_t(tilesY) + 1, 0);
+  for (size_t i = 0; i < points.size(); ++i) {
+    tiles[i] = tileOf(points[i]);
+    ++tileStarts[tiles[i] + 1u];
+  }
+  for (size_t tile = 0; tile + 1 < tileStarts.size(); ++tile) {
+    tileStarts[tile + 1] += tileStarts[tile];
+  }
+
+  SortedPoints sorted{ .points = std::vector<std::array<float, 2>>(points.size()), .indices = std::vector<uint32_t>(points.size()) };
+  for (size_t i = 0; i < points.size(); ++i) {
+    const uint32_t place = tileStarts[tiles[i]]++;
+    sorted.points[place] = points[i];
+    sorted.indices[place] = uint32_t(i);
+  }
+  return sorted;
+}
+
+template<InterpolationAlgorithm algorithm, bool normalize_offsets>
+void PerlinEvaluator<algorithm, normalize_offsets>::sample_many(std::span<const std::array<float, 2>> points,
+                                                                std::span<float> out, int threads) const {
+  const auto& params = m_noise->m_parameters;
+  const float cellDiagonal = calc_cell_diagonal(params);
+  const bool unbounded = m_noise->is_unbounded();
+  auto calcSamples = [&](const std::array<float, 2>& point) {
+    return std::pair{
+      calc_axis_sample(point[0], params.offset_x, params.grid_step_x, params.grid_size_x, unbounded, params.period_x),
+      calc_axis_sample(point[1], params.offset_y, params.grid_step_y, params.grid_size_y, unbounded, params.period_y)
+    };
+  };
+
+  SortedPoints sorted;
+  std::vector<float> sortedValues;
+  if (points.size() >= s_min_points_to_sort) {
+    sorted = sort_points_by_tile(points, params.grid_step_x, params.grid_step_y);
+    sortedValues.resize(sorted.indices.size());
+  }
+  const bool isSorted = !sorted.indices.empty();
+  const std::span<const std::array<float, 2>> inputs = isSorted ? std::span<const std::array<float, 2>>(sorted.points) : points;
+  const std::span<float> values = isSorted ? std::span<float>(sortedValues) : out;
+
+  // Same steps as operator(), the cell is set up again only when the next point is in a different one.
+  // Sorted values are written in order and scattered afterwards, stores to random places would stall the evaluation
+  auto evaluate = [&](size_t begin, size_t end) {
+    CellGradients cell{};
+    int cellX = 0;
+    int cellY = 0;
+    bool hasCell = false;
+    for (size_t k = begin; k < end; ++k) {
+      const auto [sx, sy] = calcSamples(inputs[k]);
+      if (!sx.inside || !sy.inside) {
+        values[k] = 0.0f;
+        continue;
+      }
+      if (!hasCell || sx.near_cell != cellX || sy.near_cell != cellY) {
+        cell = get_cell_gradients(*m_noise, sx.near_cell, sy.near_cell);
+        cellX = sx.near_cell;
+        cellY = sy.near_cell;
+        hasCell = true;
+      }
+      values[k] = evaluate_in_cell<algorithm, normalize_offsets>(cellDiagonal, sx, sy, cell);
+    }
+    for (size_t k = begin; k < end && isSorted; ++k) {
+      out[sorted.indices[k]] = sortedValues[k];
+    }
+  };
+
+  // every thread takes a contiguous part of the sorted points, so the threads mostly read different cells
+  parallel::for_ranges(points.size(), s_min_points_per_thread, threads, evaluate);
+}
+
+template class PerlinEvaluator<InterpolationAlgorithm::bilinear, false>;
+template class PerlinEvaluator<InterpolationAlgorithm::bilinear, true>;
+template class PerlinEvaluator<InterpolationAlgorithm::bicubic, false>;
+template class PerlinEvaluator<InterpolationAlgorithm::bicubic, true>;
+template class PerlinEvaluator<InterpolationAlgorithm::bicubic_zero, false>;
+template class PerlinEvaluator<InterpolationAlgorithm::bicubic_zero, true>;
+template class PerlinEvaluator<InterpolationAlgorithm::nearest_neighboor, false>;
+template class PerlinEvaluator<InterpolationAlgorithm::nearest_neighboor, true>;
+
+// A periodic noise stores one period of nodes and a copy of the first column and row after it,
+// so the cells of the last column and row find their far nodes like all others
+static PerlinNoiseParameters fit_grid_to_period(PerlinNoiseParameters parameters) {
+  if (parameters.period_x > 0 && parameters.period_y > 0) {
+    parameters.grid_size_x = parameters.period_x + 1;
+    parameters.grid_size_y = parameters.period_y + 1;
+  } else {
+    parameters.period_x = 0;
+    parameters.period_y = 0;
+  }
+  return parameters;
+}
+
+PerlinNoise::PerlinNoise(const PerlinNoiseParameters& parameters, uint64_t seed)
+: m_parameters(fit_grid_to_period(parameters))
+, m_seed(seed) {
+  generate_gradients();
+}
+
+std::array<float, 2> PerlinNoise::calc_grid_gradient(uint64_t seed, size_t node) {
+  return gradients::turn_to_unit_vector(gradients::random_turn(seed, node));
+}
+
+uint8_t PerlinNoise::calc_quantized_gradient(uint64_t seed, size_t node) {
+  return gradients::quantize_turn(gradients::random_turn(seed, node));
+}
+
+void PerlinNoise::generate_gradients() {
+  const bool hashed = m_parameters.gradient_source == PerlinNoiseParameters::GradientSource::hashed;
+  if (hashed) {
+    // a different stream than the nodes use
+    m_hash_seed = static_cast<uint32_t>(gradients::counter_random(~m_seed, 0) >> 32);
+  }
+  const bool periodic = is_periodic();
+  if (hashed && !periodic) {
+    return;
+  }
+
+  // periodic hashed gradients are stored as table indices, the same ones the hash picks
+  const bool quantized = m_parameters.gradient_source != PerlinNoiseParameters::GradientSource::grid;
+  const size_t nodesCount = size_t(m_parameters.grid_size_x) * size_t(m_parameters.grid_size_y);
+  if (quantized) {
+    // padding lets the vectorized kernels read whole 32-bit words
+    m_gradient_indices.resize(nodesCount + 3);
+  } else {
+    m_grid_data.resize(nodesCount * 2);
+  }
+
+  auto generate = [this, hashed, periodic, quantized](size_t begin, size_t end) {
+    const size_t gridSizeX = size_t(m_parameters.grid_size_x);
+    for (size_t node = begin; node < end; ++node) {
+      // the last column and row of a periodic grid repeat the first ones
+      const int x = periodic ? int(node % gridSizeX) % m_parameters.period_x : 0;
+      const int y = periodic ? int(node / gridSizeX) % m_parameters.period_y : 0;
+      const size_t source = periodic ? size_t(x) + size_t(y) * size_t(m_parameters.period_x) : node;
+      if (hashed) {
+        m_gradient_indices[node] = static_cast<uint8_t>(gradients::table_index(gradients::hash_node(m_hash_seed, x, y)));
+      } else if (quantized) {
+        m_gradient_indices[node] = calc_quantized_gradient(m_seed, source);
+      } else {
+        const auto gradient = calc_grid_gradient(m_seed, source);
+        m_grid_data[node * 2] = gradient[0];
+        m_grid_data[node * 2 + 1] = gradient[1];
+      }
+    }
+  };
+
+  // every node is independent, so the result does not depend on the split
+  parallel::for_ranges(nodesCount, s_min_nodes_per_thread, 0, generate);
+}
+
+float PerlinNoise::operator()(float x, float y) const {
+  return visit_evaluator([x, y](const auto& evaluator) {
+    return evaluator(x, y);
+  });
+}
+
+void PerlinNoise::fill(std::span<float> out, int x0, int y0, int w, int h, size_t stride) const {
+  visit_evaluator([&](const auto& evaluator) {
+    evaluator.fill(out, x0, y0, w, h, stride);
+  });
+}
+
+void PerlinNoise::fill_supersampled(std::span<float> out, int x0, int y0, int w, int h, size_t stride,
+                                    const Supersampling& supersampling) const {
+  visit_evaluator([&](const auto& evaluator) {
+    evaluator.fill_supersampled(out, x0, y0, w, h, stride, supersampling);
+  });
+}
+
+void PerlinNoise::fill_row(std::span<float> out, int x0, int y, int w) const {
+  fill(out, x0, y, w, 1, size_t(w));
+}
+
+// Gradients, offsets and values have 15 fractional bits, fade weights 14 so that both weights of a lerp fit
+// into 16 bits. The vectorized kernels multiply-add packed 16-bit pairs, this is the same arithmetic one by one
+static constexpr int32_t s_fixed_one = 1 << 15;
+static constexpr int32_t s_fixed_weight_one = 1 << 14;
+
+namespace {
+  // AxisSample in fixed point. Offsets are in cell diagonals, so every dot product is in [-1, 1]
+  struct FixedAxis {
+    int32_t near_offset;
+    int32_t far_offset;
+    // weight of the far node
+    int32_t fade;
+    int near_cell;
+    bool is_near_half;
+    bool inside;
+    // a bounded grid extends the first cell to coordinates in (-step, 0), where the float path extrapolates
+    // beyond what fits into 16 bits. Such samples are taken from the float path
+    bool extrapolated;
+  };
+
+  // Column data in the layout the vectorized fixed-point row kernels read
+  struct FixedColumnArrays {
+    std::vector<int> near_offset;
+    std::vector<int> far_offset;
+    std::vector<int> fade;
+    std::vector<int> near_cell;
+    std::vector<int> is_near_half;
+    std::vector<int> inside;
+
+    explicit FixedColumnArrays(const std::vector<FixedAxis>& columns) {
+      for (const auto& column : columns) {
+        near_offset.push_back(gradients::pack_fixed_pair(column.near_offset, 0));
+        far_offset.push_back(gradients::pack_fixed_pair(column.far_offset, 0));
+        fade.push_back(gradients::pack_fixed_pair(s_fixed_weight_one - column.fade, column.fade));
+        near_cell.push_back(column.near_cell);
+        is_near_half.push_back(column.is_near_half ? -1 : 0);
+        inside.push_back(column.inside ? -1 : 0);
+      }
+    }
+  };
+}
+
+// Weight of the far node, rounded once from the weight the float path uses
+template<InterpolationAlgorithm algorithm>
+static int32_t calc_fixed_fade(const AxisSample& sample) {
+  const float fade = algorithm == InterpolationAlgorithm::bicubic_zero ? sample.hermite.value_far : sample.interp_k;
+  return std::clamp(gradients::round_to_nearest_even(fade * float(s_fixed_weight_one)), 0, s_fixed_weight_one);
+}
+
+template<InterpolationAlgorithm algorithm>
+static FixedAxis calc_fixed_axis(const AxisSample& sample, float cell_diagonal) {
+  const bool extrapolated = sample.inside && sample.interp_k < 0.0f;
+  return {
+    .near_offset = extrapolated ? 0 : gradients::to_fixed_component(sample.near_offset / cell_diagonal),
+    .far_offset = extrapolated ? 0 : gradients::to_fixed_component(sample.far_offset / cell_diagonal),
+    .fade = extrapolated ? 0 : calc_fixed_fade<algorithm>(sample),
+    .near_cell = sample.near_cell,
+    .is_near_half = sample.is_near_half,
+    .inside = sample.inside,
+    .extrapolated = extrapolated
+  };
+}
+
+static int32_t dot_fixed(const std::array<int32_t, 2>& gradient, int32_t offset_x, int32_t offset_y) {
+  const int32_t dot = (gradient[0] * offset_x + gradient[1] * offset_y + (1 << 14)) >> 15;
+  return std::clamp(dot, -32768, 32767);
+}
+
+static int32_t lerp_fixed(int32_t a, int32_t b, int32_t fade) {
+  return (a * (s_fixed_weight_one - fade) + b * fade + (1 << 13)) >> 14;
+}
+
+// [0, 1) with 16 fractional bits to the whole range of T, rounded
+template<typename T>
+static T quantize_unit(int32_t unit) {
+  constexpr uint32_t max = std::numeric_limits<T>::max();
+  return T((uint32_t(unit) * max + (1u << 15)) >> 16);
+}
+
+template<typename T>
+static T quantize_float(float value) {
+  return T(value * float(std::numeric_limits<T>::max()) + 0.5f);
+}
+
+static std::array<int32_t, 2> get_fixed_gradient(const PerlinNoise& noise, int x, int y) {
+  const float* gradient = noise.gradient(x, y);
+  return { gradients::to_fixed_component(gradient[0]), gradients::to_fixed_component(gradient[1]) };
+}
+
+// (1 + value) / 2 with 16 fractional bits
+template<InterpolationAlgorithm algorithm>
+static int32_t evaluate_fixed_in_cell(const FixedAxis& sx, const FixedAxis& sy, const std::array<std::array<int32_t, 2>, 4>& cell) {
+  const auto& [topLeft, topRight, botRight, botLeft] = cell;
+  const int32_t topLeftDot = dot_fixed(topLeft, sx.near_offset, sy.near_offset);
+  const int32_t topRightDot = dot_fixed(topRight, sx.far_offset, sy.near_offset);
+  const int32_t botRightDot = dot_fixed(botRight, sx.far_offset, sy.far_offset);
+  const int32_t botLeftDot = dot_fixed(botLeft, sx.near_offset, sy.far_offset);
+
+  int32_t result = 0;
+  if constexpr (algorithm == InterpolationAlgorithm::nearest_neighboor) {
+    result = sx.is_near_half & sy.is_near_half ? topLeftDot
+      : sx.is_near_half & !sy.is_near_half ? botLeftDot
+      : !sx.is_near_half & sy.is_near_half ? topRightDot
+      : botRightDot;
+  } else {
+    const int32_t top = lerp_fixed(topLeftDot, topRightDot, sx.fade);
+    const int32_t bot = lerp_fixed(botLeftDot, botRightDot, sx.fade);
+    result = lerp_fixed(top, bot, sy.fade);
+  }
+  return result + s_fixed_one;
+}
+
+template<InterpolationAlgorithm algorithm, typename T>
+static void fill_fixed_block(const PerlinNoise& noise, std::span<T> out, int x0, int y0, int w, int h, size_t stride) {
+  const auto& params = noise.m_parameters;
+  const float cellDiagonal = calc_cell_diagonal(params);
+  const bool unbounded = noise.is_unbounded();
+
+  std::vector<FixedAxis> columns(static_cast<size_t>(w));
+  std::vector<int> extrapolatedColumns;
+  for (int i = 0; i < w; ++i) {
+    const AxisSample sample = calc_axis_sample(float(x0 + i), params.offset_x, params.grid_step_x, params.grid_size_x, unbounded, params.period_x);
+    columns[size_t(i)] = calc_fixed_axis<algorithm>(sample, cellDiagonal);
+    if (columns[size_t(i)].extrapolated) {
+      extrapolatedColumns.push_back(i);
+    }
+  }
+
+  const simd::perlin_fixed_row_kernel_t rowKernel = simd::perlin_fixed_row_kernel();
+  std::optional<FixedColumnArrays> columnArrays;
+  if (rowKernel != nullptr) {
+    columnArrays.emplace(columns);
+  }
+
+  std::vector<int> units(static_cast<size_t>(w));
+  std::vector<float> values;
+  for (int j = 0; j < h; ++j) {
+    T* row = out.data() + size_t(j) * stride;
+    const AxisSample sampleY = calc_axis_sample(float(y0 + j), params.offset_y, params.grid_step_y, params.grid_size_y, unbounded, params.period_y);
+    const FixedAxis sy = calc_fixed_axis<algorithm>(sampleY, cellDiagonal);
+    if (!sy.inside) {
+      std::fill_n(row, w, T(0));
+      continue;
+    }
+    if (sy.extrapolated) {
+      values.resize(size_t(w));
+      noise.fill_row(values, x0, y0 + j, w);
+      std::transform(values.begin(), values.end(), row, quantize_float<T>);
+      continue;
+    }
+
+    int i = 0;
+    if (columnArrays) {
+      i = rowKernel(simd::PerlinFixedRowArgs{
+        .grid = noise.m_grid_data.empty() ? nullptr : noise.m_grid_data.data(),
+        .gradient_indices = noise.m_gradient_indices.empty() ? nullptr : noise.m_gradient_indices.data(),
+        .grid_size_x = params.grid_size_x,
+        .gradient_table = gradients::s_fixed_unit_vectors.data(),
+        .gradient_seed = noise.m_hash_seed,
+        .top = sy.near_cell,
+
+        .near_offset_x = columnArrays->near_offset.data(),
+        .far_offset_x = columnArrays->far_offset.data(),
+        .fade_x = columnArrays->fade.data(),
+        .near_cell_x = columnArrays->near_cell.data(),
+        .is_near_half_x = columnArrays->is_near_half.data(),
+        .inside_x = columnArrays->inside.data(),
+
+        .near_offset_y = gradients::pack_fixed_pair(0, sy.near_offset),
+        .far_offset_y = gradients::pack_fixed_pair(0, sy.far_offset),
+        .fade_y = gradients::pack_fixed_pair(s_fixed_weight_one - sy.fade, sy.fade),
+        .is_near_half_y = sy.is_near_half,
+
+        .interpolation_algorithm = algorithm,
+
+        .out = units.data(),
+        .count = w
+      });
+    }
+
+    // whatever did not fit into whole vectors
+    while (i < w) {
+      const FixedAxis& first = columns[size_t(i)];
+      int runEnd = i + 1;
+      while (runEnd < w && columns[size_t(runEnd)].near_cell == first.near_cell) {
+        ++runEnd;
+      }
+
+      if (!first.inside) {
+        std::fill(units.begin() + i, units.begin() + runEnd, 0);
+      } else {
+        const std::array<std::array<int32_t, 2>, 4> cell = {
+          get_fixed_gradient(noise, first.near_cell, sy.near_cell), get_fixed_gradient(noise, first.near_cell + 1, sy.near_cell),
+          get_fixed_gradient(noise, first.near_cell + 1, sy.near_cell + 1), get_fixed_gradient(noise, first.near_cell, sy.near_cell + 1)
+        };
+        for (; i < runEnd; ++i) {
+          units[size_t(i)] = evaluate_fixed_in_cell<algorithm>(columns[size_t(i)], sy, cell);
+        }
+      }
+      i = runEnd;
+    }
+
+    std::transform(units.begin(), units.end(), row, quantize_unit<T>);
+    for (int column : extrapolatedColumns) {
+      row[column] = quantize_float<T>(noise(float(x0 + column), float(y0 + j)));
+    }
+  }
+}
+
+#ifndef NDEBUG
+// Debug builds hold every fixed-point sample against the rounded float one
+template<typename T>
+static void check_fixed_point_error(const PerlinNoise& noise, std::span<const T> out, int x0, int y0, int w, int h, size_t stride) {
+  constexpr int maxError = sizeof(T) == 1 ? PerlinNoise::s_fixed_point_error_u8 : PerlinNoise::s_fixed_point_error_u16;
+  std::vector<float> values(static_cast<size_t>(w));
+  for (int j = 0; j < h; ++j) {
+    noise.fill_row(values, x0, y0 + j, w);
+    for (int i = 0; i < w; ++i) {
+      const int error = std::abs(int(out[size_t(j) * stride + size_t(i)]) - int(quantize_float<T>(values[size_t(i)])));
+      assert(error <= maxError);
+    }
+  }
+}
+#endif
+
+template<typename T>
+static void fill_quantized(const PerlinNoise& noise, std::span<T> out, int x0, int y0, int w, int h, size_t stride) {
+  if (w <= 0 || h <= 0) {
+    return;
+  }
+
+  if (noise.has_fixed_point_path()) {
+    switch (noise.m_parameters.interpolation_algorithm) {
+      case InterpolationAlgorithm::bilinear:
+        fill_fixed_block<InterpolationAlgorithm::bilinear>(noise, out, x0, y0, w, h, stride);
+        break;
+      case InterpolationAlgorithm::bicubic_zero:
+        fill_fixed_block<InterpolationAlgorithm::bicubic_zero>(noise, out, x0, y0, w, h, stride);
+        break;
+      case InterpolationAlgorithm::nearest_neighboor:
+        fill_fixed_block<InterpolationAlgorithm::nearest_neighboor>(noise, out, x0, y0, w, h, stride);
+        break;
+      case InterpolationAlgorithm::bicubic:
+        break;
+    }
+#ifndef NDEBUG
+    check_fixed_point_error(noise, std::span<const T>(out), x0, y0, w, h, stride);
+#endif
+    return;
+  }
+
+  std::vector<float> values(static_cast<size_t>(w));
+  for (int j = 0; j < h; ++j) {
+    noise.fill_row(values, x0, y0 + j, w);
+    std::transform(values.begin(), values.end(), out.begin() + std::ptrdiff_t(size_t(j) * stride), quantize_float<T>);
+  }
+}
+
+void PerlinNoise::fill_u8(std::span<uint8_t> out, int x0, int y0, int w, int h, size_t stride) const {
+  fill_quantized(*this, out, x0, y0, w, h, stride);
+}
+
+void PerlinNoise::fill_u16(std::span<uint16_t> out, int x0, int y0, int w, int h, size_t stride) const {
+  fill_quantized(*this, out, x0, y0, w, h, stride);
+}
+
+bool PerlinNoise::has_fixed_point_path() const {
+  return !m_parameters.normalize_offsets && m_parameters.interpolation_algorithm != InterpolationAlgorithm::bicubic;
+}
+
+PerlinDerivatives PerlinNoise::derivatives(float x, float y) const {
+  return visit_evaluator([x, y](const auto& evaluator) {
+    return evaluator.derivatives(x, y);
+  });
+}
+
+void PerlinNoise::fill_derivatives(std::span<PerlinDerivatives> out, int x0, int y0, int w, int h, size_t stride) const {
+  visit_evaluator([&](const auto& evaluator) {
+    evaluator.fill_derivatives(out, x0, y0, w, h, stride);
+  });
+}
+
+void PerlinNoise::sample_many(std::span<const point_t> points, std::span<float> out, int threads) const {
+  visit_evaluator([&](const auto& evaluator) {
+    evaluator.sample_many(points, out, threads);
+  });
+}
+
+void PerlinNoise::fill_normal_map(std::span<uint32_t> out, int x0, int y0, int w, int h, size_t stride, float height_scale) const {
+  if (w <= 0 || h <= 0) {
+    return;
+  }
+  std::vector<PerlinDerivatives> samples(static_cast<size_t>(w));
+  for (int j = 0; j < h; ++j) {
+    fill_derivatives(samples, x0, y0 + j, w, 1, size_t(w));
+    uint32_t* row = out.data() + size_t(j) * stride;
+    for (int i = 0; i < w; ++i) {
+      row[i] = normal_map::pack(samples[size_t(i)].dx * height_scale, samples[size_t(i)].dy * height_scale);
+    }
+  }
+}
+
+const float* PerlinNoise::gradient(int x, int y) const {
+  if (is_periodic()) {
+    x = ((x % m_parameters.period_x) + m_parameters.period_x) % m_parameters.period_x;
+    y = ((y % m_parameters.period_y) + m_parameters.period_y) % m_parameters.period_y;
+  }
+  const size_t node = size_t(x + y * m_parameters.grid_size_x);
+  switch (m_parameters.gradient_source) {
+    case PerlinNoiseParameters::GradientSource::grid:
+      return &m_grid_data[node * 2];
+    case PerlinNoiseParameters::GradientSource::quantized:
+      return &gradients::s_unit_vectors[size_t(m_gradient_indices[node]) * 2];
+    case PerlinNoiseParameters::GradientSource::hashed:
+      if (!m_gradient_indices.empty()) {
+        return &gradients::s_unit_vectors[size_t(m_gradient_indices[node]) * 2];
+      }
+      return gradients::hashed_gradient(m_hash_seed, x, y);
+  }
+  std::unreachable();
+}
+
+bool PerlinNoise::is_unbounded() const {
+  return m_parameters.gradient_source == PerlinNoiseParameters::GradientSource::hashed || is_periodic();
+}
+
+bool PerlinNoise::is_periodic() const {
+  return m_parameters.period_x > 0 && m_parameters.period_y > 0;
+}
@@ -1,8 +1,10 @@
 #pragma once
 
+#include <span>
+#include <array>
 #include <vector>
-#include <random>
-#include <numbers>
+#include <utility>
+#include <cstdint>
 
 
 struct PerlinNoiseParameters {
@@ -19,31 +21,147 @@ struct PerlinNoiseParameters {
   enum class InterpolationAlgorithm {
     bilinear, bicubic, bicubic_zero, nearest_neighboor
   } interpolation_algorithm = InterpolationAlgorithm::bilinear;
+
+  enum class GradientSource {
+    grid,      // random gradient stored for every node, zero outside of the grid
+    quantized, // same as grid, but every node stores a byte index into a fixed table of unit vectors.
+               // 8x smaller, it pays off on grids that do not fit into the cache and with scattered samples
+    hashed     // picked from the same table by a seeded hash of the node, nothing is stored and grid size is ignored
+  } gradient_source = GradientSource::grid;
+
+  // Cells after which the noise repeats, it is periodic when both are positive. Node coordinates wrap,
+  // so period_x * grid_step_x by period_y * grid_step_y pixels tile seamlessly, and there are cells everywhere.
+  // Gradients of one period are stored for every source, PerlinNoise::m_parameters has grid sizes of period + 1
+  int period_x = 0;
+  int period_y = 0;
+};
+
+class PerlinNoise;
+
+// Value of the noise with its partial derivatives per unit of x and y
+struct PerlinDerivatives {
+  float value;
+  float dx;
+  float dy;
+};
+
+// Samples per pixel of PerlinNoise::fill_supersampled, samples x samples of them
+struct Supersampling {
+  static constexpr int s_max_samples = 8;
+
+  enum class Pattern {
+    grid,        // evenly spaced in both directions
+    rotated_grid // every sample in its own column and row, better for edges close to horizontal or vertical
+  } pattern = Pattern::grid;
+  // per axis, clamped to [1, s_max_samples]. 1 is a plain fill
+  int samples = 1;
+};
+
+// PerlinNoise evaluation with the parameters that change the per-sample code fixed at compile time.
+// Must match the parameters of the noise it is created for, see PerlinNoise::visit_evaluator
+template<PerlinNoiseParameters::InterpolationAlgorithm algorithm, bool normalize_offsets>
+class PerlinEvaluator {
+public:
+  explicit PerlinEvaluator(const PerlinNoise& noise) : m_noise(&noise) {}
+
+  float operator()(float x, float y) const;
+  void fill(std::span<float> out, int x0, int y0, int w, int h, size_t stride) const;
+  void fill_row(std::span<float> out, int x0, int y, int w) const;
+  void fill_supersampled(std::span<float> out, int x0, int y0, int w, int h, size_t stride, const Supersampling& supersampling) const;
+  PerlinDerivatives derivatives(float x, float y) const;
+  void fill_derivatives(std::span<PerlinDerivatives> out, int x0, int y0, int w, int h, size_t stride) const;
+  void sample_many(std::span<const std::array<float, 2>> points, std::span<float> out, int threads) const;
+
+private:
+  const PerlinNoise* m_noise;
 };
 
 class PerlinNoise {
 public:
-  PerlinNoise(const PerlinNoiseParameters& parameters, auto& random_generator)
-  : m_parameters(parameters)
-  , m_grid_data(size_t(parameters.grid_size_x * parameters.grid_size_y * 2)) {
-    std::uniform_real_distribution<float> angleDistr(0.0f, std::numbers::pi_v<float> * 2.0f);
-    for (size_t i = 0; i < m_grid_data.size(); i += 2) {
-      float angle = angleDistr(random_generator);
-
-      float dx = std::cos(angle);
-      float dy = std::sin(angle);
-      m_grid_data[i] = dx;
-      m_grid_data[i + 1] = dy;
-    }
-  }
+  // Largest difference of the fixed-point output from the rounded float output, for uint8_t and uint16_t
+  static constexpr int s_fixed_point_error_u8 = 1;
+  static constexpr int s_fixed_point_error_u16 = 4;
+
+  // Gradients depend only on the parameters and the seed, they are the same on every platform
+  PerlinNoise(const PerlinNoiseParameters& parameters, uint64_t seed);
+
+  using point_t = std::array<float, 2>;
 
-  
   float operator()(float x, float y) const;
 
-  float* get_grid_node_data(int x, int y);
-  const float* get_grid_node_data(int x, int y) const;
+  // Evaluates w x h samples starting at (x0, y0) into out, rows are stride floats apart.
+  // Gives the same values as operator(), but per-column and per-cell work is done once.
+  void fill(std::span<float> out, int x0, int y0, int w, int h, size_t stride) const;
+  void fill_row(std::span<float> out, int x0, int y, int w) const;
+  // Average of several samples per pixel against aliasing when the grid step is close to the pixel size or smaller.
+  // Samples are spread over the pixel area centered at (x, y). Costs samples^2 row fills, nothing bigger than
+  // a few rows is allocated
+  void fill_supersampled(std::span<float> out, int x0, int y0, int w, int h, size_t stride, const Supersampling& supersampling) const;
+
+  // Same samples as fill mapped to the whole range of the integer type, round(value * max).
+  // With has_fixed_point_path() the samples are computed in 15-bit fixed point, only the per-column and per-row
+  // setup uses floats. They are within s_fixed_point_error_u8/u16 of the rounded float values.
+  // Otherwise the float values are rounded
+  void fill_u8(std::span<uint8_t> out, int x0, int y0, int w, int h, size_t stride) const;
+  void fill_u16(std::span<uint16_t> out, int x0, int y0, int w, int h, size_t stride) const;
+  // Bilinear, bicubic_zero and nearest_neighboor without normalize_offsets
+  bool has_fixed_point_path() const;
+
+  // Value of operator() with its analytic derivatives, computed from the same gradients in the same pass.
+  // Derivatives are 0 where the value is clamped and outside of the grid
+  PerlinDerivatives derivatives(float x, float y) const;
+  void fill_derivatives(std::span<PerlinDerivatives> out, int x0, int y0, int w, int h, size_t stride) const;
+  // Normals of the height field value * height_scale, packed as 8-bit R, G, B, A from the lowest byte up.
+  // Components are mapped from [-1, 1] to [0, 255], y goes down the rows and z out of the texture, alpha is 255
+  void fill_normal_map(std::span<uint32_t> out, int x0, int y0, int w, int h, size_t stride, float height_scale) const;
+
+  // Values of operator() at the points, out[i] is the value at points[i]. Large sets are sorted into tiles of cells first,
+  // so the gradients of a tile stay in cache and a cell is set up once for its consecutive points.
+  // threads <= 0 uses all hardware threads
+  void sample_many(std::span<const point_t> points, std::span<float> out, int threads = 1) const;
+
+  template<PerlinNoiseParameters::InterpolationAlgorithm algorithm, bool normalize_offsets>
+  PerlinEvaluator<algorithm, normalize_offsets> evaluator() const {
+    return PerlinEvaluator<algorithm, normalize_offsets>(*this);
+  }
+
+  // Calls f with the evaluator matching the parameters of this noise.
+  // Lets callers pick the specialization once and keep it for a whole job
+  decltype(auto) visit_evaluator(auto&& f) const {
+    using enum PerlinNoiseParameters::InterpolationAlgorithm;
+    const bool normalize = m_parameters.normalize_offsets;
+    switch (m_parameters.interpolation_algorithm) {
+      case bilinear:
+        return normalize ? f(evaluator<bilinear, true>()) : f(evaluator<bilinear, false>());
+      case bicubic:
+        return normalize ? f(evaluator<bicubic, true>()) : f(evaluator<bicubic, false>());
+      case bicubic_zero:
+        return normalize ? f(evaluator<bicubic_zero, true>()) : f(evaluator<bicubic_zero, false>());
+      case nearest_neighboor:
+        return normalize ? f(evaluator<nearest_neighboor, true>()) : f(evaluator<nearest_neighboor, false>());
+    }
+    std::unreachable();
+  }
+
+  // Gradient of the node (x, y) as two floats, for any gradient source.
+  // Stored gradients must be inside of the grid
+  const float* gradient(int x, int y) const;
+  // Stored gradient of the node with index x + y * grid_size_x, computed without the rest of the grid
+  static std::array<float, 2> calc_grid_gradient(uint64_t seed, size_t node);
+  static uint8_t calc_quantized_gradient(uint64_t seed, size_t node);
+  // Cells everywhere, true for hashed gradients and periodic noise
+  bool is_unbounded() const;
+  bool is_periodic() const;
 
   const PerlinNoiseParameters m_parameters;
   std::vector<float> m_grid_data;
+  // per node, only for quantized gradients
+  std::vector<uint8_t> m_gradient_indices;
+  const uint64_t m_seed;
+  // only for hashed gradients
+  uint32_t m_hash_seed = 0;
+
+private:
+  void generate_gradients();
 };
 
@@ -0,0 +1,185 @@
+#include "sequence.hpp"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <numbers>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+#include <gradient_noise.hpp>
+#include <parallel.hpp>
+
+
+namespace {
+  struct FrameSlot {
+    std::unique_ptr<float[]> values;
+    int bands_left;
+    bool ready = false;
+  };
+}
+
+static uint8_t to_byte(float value) {
+  return static_cast<uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+bool generate_sequence(const SequenceParameters& parameters, const sequence_fill_t& fill, const sequence_writer_t& write) {
+  const int width = parameters.width;
+  const int height = parameters.height;
+  const int frameCount = parameters.frame_count;
+  if (width <= 0 || height <= 0 || frameCount <= 0) {
+    return true;
+  }
+
+  const int threadsCount = int(parallel::max_threads(parameters.threads));
+  const size_t frameSize = size_t(width) * size_t(height);
+  const int budgetFrames = int(std::clamp(parameters.memory_budget / (frameSize * sizeof(float)), size_t(1), size_t(2 * threadsCount)));
+  const int maxInFlight = std::min(frameCount,
+    parameters.max_frames_in_flight > 0 ? parameters.max_frames_in_flight : budgetFrames);
+
+  // bands of rows per frame, so there is a task for every thread even with few frames
+  const int bandsCount = std::clamp((threadsCount + frameCount - 1) / frameCount, 1, height);
+  const int rowsPerBand = (height + bandsCount - 1) / bandsCount;
+  const int tasksCount = frameCount * bandsCount;
+
+  // frame f lives in slot f % maxInFlight, a slot is reused only after its frame is handed to the writer
+  std::vector<FrameSlot> slots(static_cast<size_t>(maxInFlight));
+  for (auto& slot : slots) {
+    slot.bands_left = bandsCount;
+  }
+
+  std::mutex mutex;
+  std::condition_variable changed;
+  int nextTask = 0;
+  int nextToWrite = 0;
+  bool stop = false;
+
+  auto worker = [&] {
+    std::unique_lock lock(mutex);
+    while (true) {
+      changed.wait(lock, [&] {
+        return stop || nextTask == tasksCount || nextTask / bandsCount < nextToWrite + maxInFlight;
+      });
+      if (stop || nextTask == tasksCount) {
+        return;
+      }
+      const int task = nextTask++;
+      const int frame = task / bandsCount;
+      const int firstRow = (task % bandsCount) * rowsPerBand;
+      const int rows = std::min(rowsPerBand, height - firstRow);
+      FrameSlot& slot = slots[size_t(frame % maxInFlight)];
+      if (!slot.values) {
+        // not zeroed, the pages are committed as the bands are filled
+        slot.values = std::make_unique_for_overwrite<float[]>(frameSize);
+      }
+
+      lock.unlock();
+      if (rows > 0) {
+        const size_t offset = size_t(firstRow) * size_t(width);
+        fill(frame, std::span(slot.values.get() + offset, size_t(rows) * size_t(width)), 0, firstRow, width, rows, size_t(width));
+      }
+      lock.lock();
+
+      if (--slot.bands_left == 0) {
+        slot.ready = true;
+        changed.notify_all();
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(size_t(threadsCount));
+  for (int i = 0; i < threadsCount; ++i) {
+    threads.emplace_back(worker);
+  }
+
+  std::vector<uint8_t> pixels(frameSize);
+  bool completed = true;
+  for (int frame = 0; frame < frameCount; ++frame) {
+    FrameSlot& slot = slots[size_t(frame % maxInFlight)];
+    {
+      std::unique_lock lock(mutex);
+      changed.wait(lock, [&] { return slot.ready; });
+    }
+
+    std::transform(slot.values.get(), slot.values.get() + frameSize, pixels.begin(), to_byte);
+
+    // the slot is free once its values are converted, the workers can go on while the frame is written
+    std::unique_lock lock(mutex);
+    slot.ready = false;
+    slot.bands_left = bandsCount;
+    ++nextToWrite;
+    changed.notify_all();
+    lock.unlock();
+
+    if (!write(frame, pixels)) {
+      lock.lock();
+      stop = true;
+      changed.notify_all();
+      lock.unlock();
+      completed = false;
+      break;
+    }
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return completed;
+}
+
+sequence_fill_t make_animated_noise_fill(const AnimatedNoiseParameters& parameters, uint64_t seed) {
+  if (parameters.loop_frames <= 0) {
+    auto noise = std::make_shared<const GradientNoise<3>>(GradientNoiseParameters<3>{
+      .grid_step = {parameters.grid_step_x, parameters.grid_step_y, 1.0f}
+    }, seed);
+    const float timeStep = parameters.time_step;
+    return [noise, timeStep](int frame, std::span<float> out, int x0, int y0, int w, int h, size_t stride) {
+      noise->fill(out, {float(x0), float(y0), float(frame) * timeStep}, w, h, stride);
+    };
+  }
+
+  // circle with the length of the whole loop
+  auto noise = std::make_shared<const GradientNoise<4>>(GradientNoiseParameters<4>{
+    .grid_step = {parameters.grid_step_x, parameters.grid_step_y, 1.0f, 1.0f}
+  }, seed);
+  const int loopFrames = parameters.loop_frames;
+  const float radius = parameters.time_step * float(loopFrames) / (2.0f * std::numbers::pi_v<float>);
+  return [noise, loopFrames, radius](int frame, std::span<float> out, int x0, int y0, int w, int h, size_t stride) {
+    const float angle = 2.0f * std::numbers::pi_v<float> * float(frame % loopFrames) / float(loopFrames);
+    noise->fill(out, {float(x0), float(y0), radius * std::cos(angle), radius * std::sin(angle)}, w, h, stride);
+  };
+}
+
+sequence_writer_t make_pgm_writer(std::string path_prefix, int width, int height) {
+  return [pathPrefix = std::move(path_prefix), width, height](int frame, std::span<const uint8_t> pixels) {
+    std::ostringstream path;
+    path << pathPrefix << std::setw(5) << std::setfill('0') << frame << ".pgm";
+    std::ofstream file(path.str(), std::ios::binary);
+    file << "P5\n" << width << ' ' << height << "\n255\n";
+    file.write(reinterpret_cast<const char*>(pixels.data()), std::streamsize(pixels.size()));
+    return bool(file);
+  };
+}
+
+sequence_writer_t make_y4m_writer(std::ostream& out, int width, int height, int fps) {
+  return [&out, width, height, fps](int frame, std::span<const uint8_t> pixels) {
+    if (frame == 0) {
+      out << "YUV4MPEG2 W" << width << " H" << height << " F" << fps << ":1 Ip A1:1 Cmono\n";
+    }
+    out << "FRAME\n";
+    out.write(reinterpret_cast<const char*>(pixels.data()), std::streamsize(pixels.size()));
+    return bool(out);
+  };
+}
+
+sequence_writer_t make_raw_writer(std::ostream& out) {
+  return [&out](int, std::span<const uint8_t> pixels) {
+    out.write(reinterpret_cast<const char*>(pixels.data()), std::streamsize(pixels.size()));
+    return bool(out);
+  };
+}
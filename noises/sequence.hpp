@@ -0,0 +1,53 @@
+#pragma once
+
+#include <span>
+#include <string>
+#include <ostream>
+#include <cstdint>
+#include <functional>
+
+
+struct SequenceParameters {
+  int width;
+  int height;
+  int frame_count;
+
+  // 0 uses all hardware threads
+  int threads = 0;
+  // frames being generated plus finished frames waiting for the writer, bounds the memory.
+  // 0 fits as many float frames into memory_budget as it can, at least one and at most twice the threads
+  int max_frames_in_flight = 0;
+  size_t memory_budget = size_t(512) << 20;
+};
+
+// Fills w x h values in [0, 1] of the frame starting at (x0, y0), rows are stride floats apart.
+// Called from several threads at once
+using sequence_fill_t = std::function<void(int frame, std::span<float> out, int x0, int y0, int w, int h, size_t stride)>;
+// Gets the frames in order as 8-bit grayscale, width bytes per row. Returning false stops the generation
+using sequence_writer_t = std::function<bool(int frame, std::span<const uint8_t> pixels)>;
+
+// Frames are generated in parallel. When there are fewer frames than threads every frame is split
+// into bands of rows, so all threads have work. Frame buffers are allocated when they are first needed.
+// Returns false if the writer stopped the generation
+bool generate_sequence(const SequenceParameters& parameters, const sequence_fill_t& fill, const sequence_writer_t& write);
+
+struct AnimatedNoiseParameters {
+  float grid_step_x;
+  float grid_step_y;
+
+  // how far the noise moves through time per frame, in grid steps
+  float time_step = 0.05f;
+  // frame loop_frames is the same as frame 0 when positive
+  int loop_frames = 0;
+};
+
+// Frame t is the slice of 3D GradientNoise at time t * time_step. A looping sequence goes around a circle
+// in the two last dimensions of 4D GradientNoise instead. The noise is set up once for all frames
+sequence_fill_t make_animated_noise_fill(const AnimatedNoiseParameters& parameters, uint64_t seed);
+
+// Every frame to its own binary PGM file: path_prefix, frame number padded to 5 digits, ".pgm"
+sequence_writer_t make_pgm_writer(std::string path_prefix, int width, int height);
+// All frames into one grayscale YUV4MPEG2 stream
+sequence_writer_t make_y4m_writer(std::ostream& out, int width, int height, int fps);
+// Only the pixels of all frames one after another
+sequence_writer_t make_raw_writer(std::ostream& out);
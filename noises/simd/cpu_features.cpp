@@ -0,0 +1,81 @@
+#include "cpu_features.hpp"
+
+#if defined(NOISES_X86_KERNELS) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+#ifdef NOISES_X86_KERNELS
+
+#ifdef _MSC_VER
+static simd::Level detect() {
+  int info[4];
+  __cpuid(info, 0);
+  const int maxLeaf = info[0];
+
+  __cpuid(info, 1);
+  const bool sse42 = (info[2] & (1 << 20)) != 0;
+  const bool osxsave = (info[2] & (1 << 27)) != 0;
+  if (!sse42) {
+    return simd::Level::scalar;
+  }
+  if (!osxsave || maxLeaf < 7) {
+    return simd::Level::sse42;
+  }
+
+  const unsigned long long xcr0 = _xgetbv(0);
+  const bool osAvx = (xcr0 & 0x6) == 0x6;
+  const bool osAvx512 = (xcr0 & 0xe6) == 0xe6;
+
+  __cpuidex(info, 7, 0);
+  const bool avx2 = (info[1] & (1 << 5)) != 0;
+  const bool avx512f = (info[1] & (1 << 16)) != 0;
+
+  if (avx512f && osAvx512) {
+    return simd::Level::avx512;
+  }
+  if (avx2 && osAvx) {
+    return simd::Level::avx2;
+  }
+  return simd::Level::sse42;
+}
+#else // gcc & clang, __builtin_cpu_supports also checks that the OS saves the wide registers
+static simd::Level detect() {
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    return simd::Level::avx512;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    return simd::Level::avx2;
+  }
+  if (__builtin_cpu_supports("sse4.2")) {
+    return simd::Level::sse42;
+  }
+  return simd::Level::scalar;
+}
+#endif // _MSC_VER
+
+#else // no x86 kernels in this build
+
+static simd::Level detect() {
+  return simd::Level::scalar;
+}
+
+#endif // NOISES_X86_KERNELS
+
+namespace simd {
+  Level detected_level() {
+    static const Level s_level = detect();
+    return s_level;
+  }
+
+  const char* level_name(Level level) {
+    switch (level) {
+      case Level::scalar: return "scalar";
+      case Level::sse42: return "sse4.2";
+      case Level::avx2: return "avx2";
+      case Level::avx512: return "avx512";
+    }
+    return "unknown";
+  }
+}
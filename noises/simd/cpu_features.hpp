@@ -0,0 +1,13 @@
+#pragma once
+
+
+namespace simd {
+  enum class Level {
+    scalar, sse42, avx2, avx512
+  };
+
+  // Best instruction set that is supported by both the cpu and the build. Detected once
+  Level detected_level();
+
+  const char* level_name(Level level);
+}
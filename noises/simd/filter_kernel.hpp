@@ -0,0 +1,45 @@
+#pragma once
+
+// Generic vectorized row convolution, see perlin_kernel.hpp for the rules of the including translation units
+
+#include <simd/filter_simd.hpp>
+
+
+namespace simd::kernel {
+  // vectors convolved at once, their sums are independent and overlap in the pipeline
+  inline constexpr int s_convolve_unroll = 4;
+
+  template<typename Ops>
+  int convolve_row(const ConvolveRowArgs& args) {
+    using f32 = typename Ops::f32;
+    constexpr int width = Ops::width;
+    constexpr int block = width * s_convolve_unroll;
+    const int count = args.count - args.count % width;
+
+    int x = 0;
+    for (; x + block <= count; x += block) {
+      f32 sums[s_convolve_unroll];
+      for (auto& sum : sums) {
+        sum = Ops::set1(0.0f);
+      }
+      for (int k = 0; k < args.taps; ++k) {
+        const f32 weight = Ops::set1(args.weights[k]);
+        const float* in = args.in + size_t(k) * args.tap_stride + size_t(x);
+        for (int i = 0; i < s_convolve_unroll; ++i) {
+          sums[i] = Ops::add(sums[i], Ops::mul(weight, Ops::load(in + i * width)));
+        }
+      }
+      for (int i = 0; i < s_convolve_unroll; ++i) {
+        Ops::store(args.out + x + i * width, sums[i]);
+      }
+    }
+    for (; x < count; x += width) {
+      f32 sum = Ops::set1(0.0f);
+      for (int k = 0; k < args.taps; ++k) {
+        sum = Ops::add(sum, Ops::mul(Ops::set1(args.weights[k]), Ops::load(args.in + size_t(k) * args.tap_stride + size_t(x))));
+      }
+      Ops::store(args.out + x, sum);
+    }
+    return count;
+  }
+}
@@ -0,0 +1,23 @@
+#include "filter_simd.hpp"
+
+#include <simd/cpu_features.hpp>
+
+
+namespace simd {
+  static convolve_row_kernel_t select_convolve_row_kernel() {
+#ifdef NOISES_X86_KERNELS
+    switch (detected_level()) {
+      case Level::avx512: return convolve_row_avx512;
+      case Level::avx2: return convolve_row_avx2;
+      case Level::sse42: return convolve_row_sse42;
+      case Level::scalar: return nullptr;
+    }
+#endif
+    return nullptr;
+  }
+
+  convolve_row_kernel_t convolve_row_kernel() {
+    static const convolve_row_kernel_t s_kernel = select_convolve_row_kernel();
+    return s_kernel;
+  }
+}
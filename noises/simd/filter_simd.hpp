@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+
+
+namespace simd {
+  // out[x] = sum of weights[k] * in[x + k * tap_stride] over the taps, added up in the order of k from 0.
+  // A row of a field is convolved with tap_stride 1, a column with tap_stride of the row length
+  struct ConvolveRowArgs {
+    const float* in;
+    size_t tap_stride;
+    const float* weights;
+    int taps;
+
+    float* out;
+    int count;
+  };
+
+  // Writes as many values of the row as fit into whole vectors and returns how many were written.
+  // The results are identical to the scalar path
+  using convolve_row_kernel_t = int(*)(const ConvolveRowArgs&);
+
+  // Kernel for the best instruction set of this cpu, nullptr if there is none
+  convolve_row_kernel_t convolve_row_kernel();
+
+  int convolve_row_sse42(const ConvolveRowArgs&);
+  int convolve_row_avx2(const ConvolveRowArgs&);
+  int convolve_row_avx512(const ConvolveRowArgs&);
+}
@@ -0,0 +1,26 @@
+#include <simd/filter_simd.hpp>
+
+#ifdef NOISES_X86_KERNELS
+
+#include <simd/filter_kernel.hpp>
+#include <nmmintrin.h>
+
+
+namespace {
+  struct Sse42Ops {
+    static constexpr int width = 4;
+    using f32 = __m128;
+
+    static f32 load(const float* ptr) { return _mm_loadu_ps(ptr); }
+    static void store(float* ptr, f32 value) { _mm_storeu_ps(ptr, value); }
+    static f32 set1(float value) { return _mm_set1_ps(value); }
+    static f32 add(f32 a, f32 b) { return _mm_add_ps(a, b); }
+    static f32 mul(f32 a, f32 b) { return _mm_mul_ps(a, b); }
+  };
+}
+
+int simd::convolve_row_sse42(const ConvolveRowArgs& args) {
+  return kernel::convolve_row<Sse42Ops>(args);
+}
+
+#endif // NOISES_X86_KERNELS
@@ -0,0 +1,68 @@
+#include <simd/perlin_simd.hpp>
+
+#ifdef NOISES_X86_KERNELS
+
+#include <simd/perlin_kernel.hpp>
+#include <immintrin.h>
+
+
+namespace {
+  struct Avx2Ops {
+    static constexpr int width = 8;
+    using f32 = __m256;
+    using i32 = __m256i;
+    using mask = __m256;
+
+    static f32 load(const float* ptr) { return _mm256_loadu_ps(ptr); }
+    static i32 load(const int* ptr) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr)); }
+    static void store(float* ptr, f32 value) { _mm256_storeu_ps(ptr, value); }
+    static void store(int* ptr, i32 value) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(ptr), value); }
+
+    static f32 set1(float value) { return _mm256_set1_ps(value); }
+    static i32 set1(int value) { return _mm256_set1_epi32(value); }
+
+    static f32 add(f32 a, f32 b) { return _mm256_add_ps(a, b); }
+    static f32 sub(f32 a, f32 b) { return _mm256_sub_ps(a, b); }
+    static f32 mul(f32 a, f32 b) { return _mm256_mul_ps(a, b); }
+    static f32 div(f32 a, f32 b) { return _mm256_div_ps(a, b); }
+    static f32 sqrt(f32 a) { return _mm256_sqrt_ps(a); }
+
+    static i32 add(i32 a, i32 b) { return _mm256_add_epi32(a, b); }
+    static i32 sub(i32 a, i32 b) { return _mm256_sub_epi32(a, b); }
+    static i32 bit_and(i32 a, i32 b) { return _mm256_and_si256(a, b); }
+    static i32 shift_left(i32 a, int bits) { return _mm256_slli_epi32(a, bits); }
+    static i32 shift_right(i32 a, int bits) { return _mm256_srli_epi32(a, bits); }
+    static i32 bit_xor(i32 a, i32 b) { return _mm256_xor_si256(a, b); }
+    static i32 mul_lo(i32 a, i32 b) { return _mm256_mullo_epi32(a, b); }
+    static i32 shift_right_arith(i32 a, int bits) { return _mm256_srai_epi32(a, bits); }
+    static i32 min(i32 a, i32 b) { return _mm256_min_epi32(a, b); }
+    static i32 max(i32 a, i32 b) { return _mm256_max_epi32(a, b); }
+    // rounds to nearest even like std::nearbyint
+    static i32 round_to_int(f32 a) { return _mm256_cvtps_epi32(a); }
+    static i32 madd(i32 a, i32 b) { return _mm256_madd_epi16(a, b); }
+    static i32 bit_or(i32 a, i32 b) { return _mm256_or_si256(a, b); }
+
+    static f32 gather(const float* base, i32 idx) { return _mm256_i32gather_ps(base, idx, 4); }
+    static i32 gather(const int* base, i32 idx) { return _mm256_i32gather_epi32(base, idx, 4); }
+
+    // reads 32-bit words, the array must have 3 bytes of padding
+    static i32 gather_byte(const uint8_t* base, i32 idx) {
+      return _mm256_and_si256(_mm256_i32gather_epi32(reinterpret_cast<const int*>(base), idx, 1), _mm256_set1_epi32(0xff));
+    }
+
+    static mask less(f32 a, f32 b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static mask int_mask(i32 bits) { return _mm256_castsi256_ps(bits); }
+    static f32 select(mask m, f32 if_true, f32 if_false) { return _mm256_blendv_ps(if_false, if_true, m); }
+    static i32 select(i32 bits, i32 if_true, i32 if_false) { return _mm256_blendv_epi8(if_false, if_true, bits); }
+  };
+}
+
+int simd::perlin_row_avx2(const PerlinRowArgs& args) {
+  return kernel::perlin_row<Avx2Ops>(args);
+}
+
+int simd::perlin_fixed_row_avx2(const PerlinFixedRowArgs& args) {
+  return kernel::perlin_fixed_row<Avx2Ops>(args);
+}
+
+#endif // NOISES_X86_KERNELS
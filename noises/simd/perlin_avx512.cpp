@@ -0,0 +1,72 @@
+#include <simd/perlin_simd.hpp>
+
+#ifdef NOISES_X86_KERNELS
+
+#include <simd/perlin_kernel.hpp>
+#include <immintrin.h>
+
+
+namespace {
+  struct Avx512Ops {
+    static constexpr int width = 16;
+    using f32 = __m512;
+    using i32 = __m512i;
+    using mask = __mmask16;
+
+    static f32 load(const float* ptr) { return _mm512_loadu_ps(ptr); }
+    static i32 load(const int* ptr) { return _mm512_loadu_si512(ptr); }
+    static void store(float* ptr, f32 value) { _mm512_storeu_ps(ptr, value); }
+    static void store(int* ptr, i32 value) { _mm512_storeu_si512(ptr, value); }
+
+    static f32 set1(float value) { return _mm512_set1_ps(value); }
+    static i32 set1(int value) { return _mm512_set1_epi32(value); }
+
+    static f32 add(f32 a, f32 b) { return _mm512_add_ps(a, b); }
+    static f32 sub(f32 a, f32 b) { return _mm512_sub_ps(a, b); }
+    static f32 mul(f32 a, f32 b) { return _mm512_mul_ps(a, b); }
+    static f32 div(f32 a, f32 b) { return _mm512_div_ps(a, b); }
+    static f32 sqrt(f32 a) { return _mm512_maskz_sqrt_ps(0xffff, a); }
+
+    static i32 add(i32 a, i32 b) { return _mm512_add_epi32(a, b); }
+    static i32 sub(i32 a, i32 b) { return _mm512_sub_epi32(a, b); }
+    static i32 bit_and(i32 a, i32 b) { return _mm512_and_si512(a, b); }
+    static i32 shift_left(i32 a, int bits) { return _mm512_maskz_slli_epi32(0xffff, a, static_cast<unsigned>(bits)); }
+    static i32 shift_right(i32 a, int bits) { return _mm512_maskz_srli_epi32(0xffff, a, static_cast<unsigned>(bits)); }
+    static i32 bit_xor(i32 a, i32 b) { return _mm512_xor_si512(a, b); }
+    static i32 mul_lo(i32 a, i32 b) { return _mm512_mullo_epi32(a, b); }
+    static i32 shift_right_arith(i32 a, int bits) { return _mm512_maskz_srai_epi32(0xffff, a, static_cast<unsigned>(bits)); }
+    static i32 min(i32 a, i32 b) { return _mm512_maskz_min_epi32(0xffff, a, b); }
+    static i32 max(i32 a, i32 b) { return _mm512_maskz_max_epi32(0xffff, a, b); }
+    // rounds to nearest even like std::nearbyint
+    static i32 round_to_int(f32 a) { return _mm512_maskz_cvtps_epi32(0xffff, a); }
+    // sums of the products of 16-bit pairs like _mm512_madd_epi16, which needs avx512bw
+    static i32 madd(i32 a, i32 b) {
+      const i32 low = _mm512_mullo_epi32(shift_right_arith(shift_left(a, 16), 16), shift_right_arith(shift_left(b, 16), 16));
+      return _mm512_add_epi32(low, _mm512_mullo_epi32(shift_right_arith(a, 16), shift_right_arith(b, 16)));
+    }
+    static i32 bit_or(i32 a, i32 b) { return _mm512_or_si512(a, b); }
+
+    static f32 gather(const float* base, i32 idx) { return _mm512_mask_i32gather_ps(_mm512_setzero_ps(), 0xffff, idx, base, 4); }
+    static i32 gather(const int* base, i32 idx) { return _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), 0xffff, idx, base, 4); }
+
+    // reads 32-bit words, the array must have 3 bytes of padding
+    static i32 gather_byte(const uint8_t* base, i32 idx) {
+      return _mm512_and_si512(_mm512_mask_i32gather_epi32(_mm512_setzero_si512(), 0xffff, idx, base, 1), _mm512_set1_epi32(0xff));
+    }
+
+    static mask less(f32 a, f32 b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+    static mask int_mask(i32 bits) { return _mm512_test_epi32_mask(bits, bits); }
+    static f32 select(mask m, f32 if_true, f32 if_false) { return _mm512_mask_blend_ps(m, if_false, if_true); }
+    static i32 select(i32 bits, i32 if_true, i32 if_false) { return _mm512_mask_blend_epi32(_mm512_test_epi32_mask(bits, bits), if_false, if_true); }
+  };
+}
+
+int simd::perlin_row_avx512(const PerlinRowArgs& args) {
+  return kernel::perlin_row<Avx512Ops>(args);
+}
+
+int simd::perlin_fixed_row_avx512(const PerlinFixedRowArgs& args) {
+  return kernel::perlin_fixed_row<Avx512Ops>(args);
+}
+
+#endif // NOISES_X86_KERNELS
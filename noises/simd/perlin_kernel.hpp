@@ -0,0 +1,372 @@
+#pragma once
+
+// Generic vectorized Perlin row evaluation. Included only by the per-instruction-set translation units,
+// each of them instantiates it with its own Ops type living in an anonymous namespace.
+// Nothing in here may call shared inline functions: they would be compiled with the wide instruction set
+// and the linker is free to pick that copy for the rest of the program.
+
+#include <simd/perlin_simd.hpp>
+#include <interpolation.hpp>
+#include <gradients.hpp>
+
+
+namespace simd::kernel {
+  using InterpolationAlgorithm = PerlinNoiseParameters::InterpolationAlgorithm;
+
+  template<typename Ops>
+  struct Offset {
+    typename Ops::f32 x;
+    typename Ops::f32 y;
+  };
+
+  template<typename Ops>
+  Offset<Ops> normalize(Offset<Ops> offset) {
+    const auto len = Ops::sqrt(Ops::add(Ops::mul(offset.x, offset.x), Ops::mul(offset.y, offset.y)));
+    return { Ops::div(offset.x, len), Ops::div(offset.y, len) };
+  }
+
+  template<typename Ops>
+  typename Ops::f32 dot(Offset<Ops> offset, typename Ops::f32 gx, typename Ops::f32 gy) {
+    return Ops::add(Ops::mul(offset.x, gx), Ops::mul(offset.y, gy));
+  }
+
+  template<typename Ops>
+  typename Ops::f32 lerp(typename Ops::f32 a, typename Ops::f32 b, typename Ops::f32 k) {
+    return Ops::add(a, Ops::mul(k, Ops::sub(b, a)));
+  }
+
+  template<typename Ops>
+  struct HermiteWeights {
+    typename Ops::f32 value_near;
+    typename Ops::f32 value_far;
+    typename Ops::f32 derivative_near;
+    typename Ops::f32 derivative_far;
+  };
+
+  // Same operation order as interpolation::hermite
+  template<typename Ops>
+  typename Ops::f32 hermite(const HermiteWeights<Ops>& weights, typename Ops::f32 value_near, typename Ops::f32 value_far,
+                            typename Ops::f32 derivative_near, typename Ops::f32 derivative_far) {
+    const auto values = Ops::add(Ops::mul(weights.value_near, value_near), Ops::mul(weights.value_far, value_far));
+    const auto withNear = Ops::add(values, Ops::mul(weights.derivative_near, derivative_near));
+    return Ops::add(withNear, Ops::mul(weights.derivative_far, derivative_far));
+  }
+
+  // Offset of the hashed gradient in the table, same as gradients::hash_node and gradients::table_index
+  template<typename Ops>
+  typename Ops::i32 hashed_gradient_offset(typename Ops::i32 key) {
+    using i32 = typename Ops::i32;
+    i32 h = Ops::bit_xor(key, Ops::shift_right(key, 16));
+    h = Ops::mul_lo(h, Ops::set1(static_cast<int>(gradients::s_mix_multiplier0)));
+    h = Ops::bit_xor(h, Ops::shift_right(h, 15));
+    h = Ops::mul_lo(h, Ops::set1(static_cast<int>(gradients::s_mix_multiplier1)));
+    h = Ops::bit_xor(h, Ops::shift_right(h, 16));
+    return Ops::shift_left(Ops::shift_right(h, 24), 1);
+  }
+
+  template<typename Ops>
+  struct CornerGradients {
+    typename Ops::f32 top_left_x, top_left_y;
+    typename Ops::f32 top_right_x, top_right_y;
+    typename Ops::f32 bot_right_x, bot_right_y;
+    typename Ops::f32 bot_left_x, bot_left_y;
+  };
+
+  // Gradients of the cell corners for one row of cells, for any gradient source
+  template<typename Ops>
+  class GradientLookup {
+    using i32 = typename Ops::i32;
+
+  public:
+    // Args is PerlinRowArgs or PerlinFixedRowArgs. The float table is only needed by gather
+    template<typename Args>
+    GradientLookup(const Args& args, const float* float_table)
+    : m_gradient_indices(args.gradient_indices)
+    , m_grid(args.grid)
+    , m_gradient_data(args.grid != nullptr ? args.grid : float_table)
+    , m_hashed(args.grid == nullptr && args.gradient_indices == nullptr)
+    , m_row_base(Ops::set1(args.top * args.grid_size_x))
+    , m_next_row(Ops::set1(args.grid_size_x * 2))
+    , m_grid_size_x(Ops::set1(args.grid_size_x))
+    , m_hash_x(Ops::set1(static_cast<int>(gradients::s_hash_x_multiplier)))
+    , m_top_key(Ops::set1(static_cast<int>(args.gradient_seed ^ (static_cast<uint32_t>(args.top) * gradients::s_hash_y_multiplier))))
+    , m_bot_key(Ops::set1(static_cast<int>(args.gradient_seed ^ ((static_cast<uint32_t>(args.top) + 1) * gradients::s_hash_y_multiplier)))) {
+    }
+
+    CornerGradients<Ops> gather(const int* near_cell_x, i32 inside_bits) const {
+      const CornerIndices idx = calc_indices(near_cell_x, inside_bits);
+      return {
+        Ops::gather(m_gradient_data, idx.top_left), Ops::gather(m_gradient_data + 1, idx.top_left),
+        Ops::gather(m_gradient_data, idx.top_right), Ops::gather(m_gradient_data + 1, idx.top_right),
+        Ops::gather(m_gradient_data, idx.bot_right), Ops::gather(m_gradient_data + 1, idx.bot_right),
+        Ops::gather(m_gradient_data, idx.bot_left), Ops::gather(m_gradient_data + 1, idx.bot_left)
+      };
+    }
+
+    // Gradients as gradients::pack_fixed_pair words, top left, top right, bottom right, bottom left
+    std::array<i32, 4> gather_fixed(const int* near_cell_x, i32 inside_bits, const int* fixed_table) const {
+      const CornerIndices idx = calc_indices(near_cell_x, inside_bits);
+      if (m_grid != nullptr) {
+        return { fixed_grid_gradient(idx.top_left), fixed_grid_gradient(idx.top_right),
+                 fixed_grid_gradient(idx.bot_right), fixed_grid_gradient(idx.bot_left) };
+      }
+      // the float table has two entries per vector, the fixed one a single word
+      return {
+        Ops::gather(fixed_table, Ops::shift_right(idx.top_left, 1)), Ops::gather(fixed_table, Ops::shift_right(idx.top_right, 1)),
+        Ops::gather(fixed_table, Ops::shift_right(idx.bot_right, 1)), Ops::gather(fixed_table, Ops::shift_right(idx.bot_left, 1))
+      };
+    }
+
+  private:
+    // Offsets into the float gradient data
+    struct CornerIndices {
+      i32 top_left;
+      i32 top_right;
+      i32 bot_right;
+      i32 bot_left;
+    };
+
+    CornerIndices calc_indices(const int* near_cell_x, i32 inside_bits) const {
+      const i32 nextNode = Ops::set1(2);
+      const i32 one32 = Ops::set1(1);
+      if (m_hashed) {
+        const i32 leftKey = Ops::mul_lo(Ops::load(near_cell_x), m_hash_x);
+        const i32 rightKey = Ops::add(leftKey, m_hash_x);
+        return {
+          hashed_gradient_offset<Ops>(Ops::bit_xor(m_top_key, leftKey)),
+          hashed_gradient_offset<Ops>(Ops::bit_xor(m_top_key, rightKey)),
+          hashed_gradient_offset<Ops>(Ops::bit_xor(m_bot_key, rightKey)),
+          hashed_gradient_offset<Ops>(Ops::bit_xor(m_bot_key, leftKey))
+        };
+      }
+
+      // columns outside of the grid still gather from a valid node, their result is zeroed by the caller
+      const i32 node = Ops::add(Ops::bit_and(Ops::load(near_cell_x), inside_bits), m_row_base);
+      if (m_gradient_indices != nullptr) {
+        const i32 botNode = Ops::add(node, m_grid_size_x);
+        return {
+          Ops::shift_left(Ops::gather_byte(m_gradient_indices, node), 1),
+          Ops::shift_left(Ops::gather_byte(m_gradient_indices, Ops::add(node, one32)), 1),
+          Ops::shift_left(Ops::gather_byte(m_gradient_indices, Ops::add(botNode, one32)), 1),
+          Ops::shift_left(Ops::gather_byte(m_gradient_indices, botNode), 1)
+        };
+      }
+      const i32 topLeft = Ops::add(node, node);
+      const i32 botLeft = Ops::add(topLeft, m_next_row);
+      return { topLeft, Ops::add(topLeft, nextNode), Ops::add(botLeft, nextNode), botLeft };
+    }
+
+    // Same as gradients::to_fixed_component and gradients::pack_fixed_pair
+    i32 fixed_grid_gradient(i32 idx) const {
+      const auto scale = Ops::set1(32768.0f);
+      const i32 minComponent = Ops::set1(-32767);
+      const i32 maxComponent = Ops::set1(32767);
+      const i32 x = Ops::min(Ops::max(Ops::round_to_int(Ops::mul(Ops::gather(m_grid, idx), scale)), minComponent), maxComponent);
+      const i32 y = Ops::min(Ops::max(Ops::round_to_int(Ops::mul(Ops::gather(m_grid + 1, idx), scale)), minComponent), maxComponent);
+      return Ops::bit_or(Ops::bit_and(x, Ops::set1(0xffff)), Ops::shift_left(y, 16));
+    }
+
+    const uint8_t* m_gradient_indices;
+    const float* m_grid;
+    const float* m_gradient_data;
+    bool m_hashed;
+    i32 m_row_base;
+    i32 m_next_row;
+    i32 m_grid_size_x;
+    i32 m_hash_x;
+    i32 m_top_key;
+    i32 m_bot_key;
+  };
+
+  template<typename Ops>
+  HermiteWeights<Ops> load_hermite_x(const PerlinRowArgs& args, int i) {
+    return {
+      Ops::load(args.hermite_value_near_x + i), Ops::load(args.hermite_value_far_x + i),
+      Ops::load(args.hermite_derivative_near_x + i), Ops::load(args.hermite_derivative_far_x + i)
+    };
+  }
+
+  template<typename Ops, InterpolationAlgorithm algorithm, bool normalize_offsets>
+  int perlin_row(const PerlinRowArgs& args) {
+    using f32 = typename Ops::f32;
+    using i32 = typename Ops::i32;
+
+    const int vectorCount = args.count - args.count % Ops::width;
+
+    const f32 zero = Ops::set1(0.0f);
+    const f32 one = Ops::set1(1.0f);
+    const f32 two = Ops::set1(2.0f);
+    const f32 cellDiagonal = Ops::set1(args.cell_diagonal);
+    const f32 nearOffsetY = Ops::set1(args.near_offset_y);
+    const f32 farOffsetY = Ops::set1(args.far_offset_y);
+    const f32 interpKY = Ops::set1(args.interp_k_y);
+    const HermiteWeights<Ops> hermiteY{
+      Ops::set1(args.hermite_y.value_near), Ops::set1(args.hermite_y.value_far),
+      Ops::set1(args.hermite_y.derivative_near), Ops::set1(args.hermite_y.derivative_far)
+    };
+
+    const GradientLookup<Ops> lookup(args, args.gradient_table);
+
+    for (int i = 0; i < vectorCount; i += Ops::width) {
+      const i32 insideBits = Ops::load(args.inside_x + i);
+      const CornerGradients<Ops> g = lookup.gather(args.near_cell_x + i, insideBits);
+      const f32 topLeftGx = g.top_left_x;
+      const f32 topLeftGy = g.top_left_y;
+      const f32 topRightGx = g.top_right_x;
+      const f32 topRightGy = g.top_right_y;
+      const f32 botRightGx = g.bot_right_x;
+      const f32 botRightGy = g.bot_right_y;
+      const f32 botLeftGx = g.bot_left_x;
+      const f32 botLeftGy = g.bot_left_y;
+
+      const f32 nearOffsetX = Ops::load(args.near_offset_x + i);
+      const f32 farOffsetX = Ops::load(args.far_offset_x + i);
+
+      Offset<Ops> topLeftOffset{ nearOffsetX, nearOffsetY };
+      Offset<Ops> topRightOffset{ farOffsetX, nearOffsetY };
+      Offset<Ops> botRightOffset{ farOffsetX, farOffsetY };
+      Offset<Ops> botLeftOffset{ nearOffsetX, farOffsetY };
+
+      if constexpr (normalize_offsets) {
+        topLeftOffset = normalize(topLeftOffset);
+        topRightOffset = normalize(topRightOffset);
+        botRightOffset = normalize(botRightOffset);
+        botLeftOffset = normalize(botLeftOffset);
+      }
+
+      const f32 topLeftDot = dot(topLeftOffset, topLeftGx, topLeftGy);
+      const f32 topRightDot = dot(topRightOffset, topRightGx, topRightGy);
+      const f32 botRightDot = dot(botRightOffset, botRightGx, botRightGy);
+      const f32 botLeftDot = dot(botLeftOffset, botLeftGx, botLeftGy);
+
+      f32 result;
+      if constexpr (algorithm == InterpolationAlgorithm::bilinear) {
+        const f32 interpKX = Ops::load(args.interp_k_x + i);
+        const f32 topLerp = lerp<Ops>(topLeftDot, topRightDot, interpKX);
+        const f32 botLerp = lerp<Ops>(botLeftDot, botRightDot, interpKX);
+        result = lerp<Ops>(topLerp, botLerp, interpKY);
+      } else if constexpr (algorithm == InterpolationAlgorithm::bicubic) {
+        // interpolation::bicubic with the gradients as derivatives and no cross derivatives
+        const f32 valueLeft = hermite<Ops>(hermiteY, topLeftDot, botLeftDot, topLeftGy, botLeftGy);
+        const f32 valueRight = hermite<Ops>(hermiteY, topRightDot, botRightDot, topRightGy, botRightGy);
+        const f32 derivativeLeft = hermite<Ops>(hermiteY, topLeftGx, botLeftGx, zero, zero);
+        const f32 derivativeRight = hermite<Ops>(hermiteY, topRightGx, botRightGx, zero, zero);
+        result = hermite<Ops>(load_hermite_x<Ops>(args, i), valueLeft, valueRight, derivativeLeft, derivativeRight);
+      } else if constexpr (algorithm == InterpolationAlgorithm::bicubic_zero) {
+        // derivatives along x are zero whatever the row is
+        const f32 valueLeft = hermite<Ops>(hermiteY, topLeftDot, botLeftDot, zero, zero);
+        const f32 valueRight = hermite<Ops>(hermiteY, topRightDot, botRightDot, zero, zero);
+        result = hermite<Ops>(load_hermite_x<Ops>(args, i), valueLeft, valueRight, zero, zero);
+      } else {
+        const auto isLeft = Ops::int_mask(Ops::load(args.is_near_half_x + i));
+        result = args.is_near_half_y
+          ? Ops::select(isLeft, topLeftDot, topRightDot)
+          : Ops::select(isLeft, botLeftDot, botRightDot);
+      }
+
+      f32 normalizedResult = result;
+      if constexpr (!normalize_offsets) {
+        normalizedResult = Ops::div(result, cellDiagonal);
+      }
+      const f32 remapped = Ops::div(Ops::add(one, normalizedResult), two);
+      // same as std::clamp, including passing NaN through
+      const f32 clamped = Ops::select(Ops::less(remapped, zero), zero, Ops::select(Ops::less(one, remapped), one, remapped));
+      Ops::store(args.out + i, Ops::select(Ops::int_mask(insideBits), clamped, zero));
+    }
+
+    return vectorCount;
+  }
+
+  template<typename Ops, InterpolationAlgorithm algorithm>
+  int perlin_row(const PerlinRowArgs& args) {
+    return args.normalize_offsets
+      ? perlin_row<Ops, algorithm, true>(args)
+      : perlin_row<Ops, algorithm, false>(args);
+  }
+
+  template<typename Ops>
+  int perlin_row(const PerlinRowArgs& args) {
+    switch (args.interpolation_algorithm) {
+      case InterpolationAlgorithm::bilinear:
+        return perlin_row<Ops, InterpolationAlgorithm::bilinear>(args);
+      case InterpolationAlgorithm::bicubic:
+        return perlin_row<Ops, InterpolationAlgorithm::bicubic>(args);
+      case InterpolationAlgorithm::bicubic_zero:
+        return perlin_row<Ops, InterpolationAlgorithm::bicubic_zero>(args);
+      case InterpolationAlgorithm::nearest_neighboor:
+        return perlin_row<Ops, InterpolationAlgorithm::nearest_neighboor>(args);
+    }
+    return 0;
+  }
+
+  // Products of 16-bit pairs back to 15 fractional bits, see evaluate_fixed_in_cell in perlin.cpp
+  template<typename Ops>
+  typename Ops::i32 dot_fixed(typename Ops::i32 gradient, typename Ops::i32 offset) {
+    const auto rounded = Ops::shift_right_arith(Ops::add(Ops::madd(gradient, offset), Ops::set1(1 << 14)), 15);
+    return Ops::min(Ops::max(rounded, Ops::set1(-32768)), Ops::set1(32767));
+  }
+
+  template<typename Ops>
+  typename Ops::i32 lerp_fixed(typename Ops::i32 a, typename Ops::i32 b, typename Ops::i32 weights) {
+    const auto values = Ops::bit_or(Ops::bit_and(a, Ops::set1(0xffff)), Ops::shift_left(b, 16));
+    return Ops::shift_right_arith(Ops::add(Ops::madd(values, weights), Ops::set1(1 << 13)), 14);
+  }
+
+  template<typename Ops, InterpolationAlgorithm algorithm>
+  int perlin_fixed_row(const PerlinFixedRowArgs& args) {
+    using i32 = typename Ops::i32;
+
+    const int vectorCount = args.count - args.count % Ops::width;
+
+    const i32 nearOffsetY = Ops::set1(args.near_offset_y);
+    const i32 farOffsetY = Ops::set1(args.far_offset_y);
+    const i32 fadeY = Ops::set1(args.fade_y);
+    const i32 half = Ops::set1(1 << 15);
+    const GradientLookup<Ops> lookup(args, nullptr);
+
+    for (int i = 0; i < vectorCount; i += Ops::width) {
+      const i32 insideBits = Ops::load(args.inside_x + i);
+      const auto [topLeft, topRight, botRight, botLeft] = lookup.gather_fixed(args.near_cell_x + i, insideBits, args.gradient_table);
+
+      const i32 nearOffsetX = Ops::load(args.near_offset_x + i);
+      const i32 farOffsetX = Ops::load(args.far_offset_x + i);
+      const i32 topLeftDot = dot_fixed<Ops>(topLeft, Ops::bit_or(nearOffsetX, nearOffsetY));
+      const i32 topRightDot = dot_fixed<Ops>(topRight, Ops::bit_or(farOffsetX, nearOffsetY));
+      const i32 botRightDot = dot_fixed<Ops>(botRight, Ops::bit_or(farOffsetX, farOffsetY));
+      const i32 botLeftDot = dot_fixed<Ops>(botLeft, Ops::bit_or(nearOffsetX, farOffsetY));
+
+      i32 result;
+      if constexpr (algorithm == InterpolationAlgorithm::nearest_neighboor) {
+        const i32 isLeft = Ops::load(args.is_near_half_x + i);
+        result = args.is_near_half_y
+          ? Ops::select(isLeft, topLeftDot, topRightDot)
+          : Ops::select(isLeft, botLeftDot, botRightDot);
+      } else {
+        // bicubic_zero differs only in the fades
+        const i32 fadeX = Ops::load(args.fade_x + i);
+        const i32 top = lerp_fixed<Ops>(topLeftDot, topRightDot, fadeX);
+        const i32 bot = lerp_fixed<Ops>(botLeftDot, botRightDot, fadeX);
+        result = lerp_fixed<Ops>(top, bot, fadeY);
+      }
+
+      Ops::store(args.out + i, Ops::bit_and(Ops::add(result, half), insideBits));
+    }
+
+    return vectorCount;
+  }
+
+  template<typename Ops>
+  int perlin_fixed_row(const PerlinFixedRowArgs& args) {
+    switch (args.interpolation_algorithm) {
+      case InterpolationAlgorithm::bilinear:
+        return perlin_fixed_row<Ops, InterpolationAlgorithm::bilinear>(args);
+      case InterpolationAlgorithm::bicubic_zero:
+        return perlin_fixed_row<Ops, InterpolationAlgorithm::bicubic_zero>(args);
+      case InterpolationAlgorithm::nearest_neighboor:
+        return perlin_fixed_row<Ops, InterpolationAlgorithm::nearest_neighboor>(args);
+      case InterpolationAlgorithm::bicubic:
+        break;
+    }
+    return 0;
+  }
+}
@@ -0,0 +1,40 @@
+#include "perlin_simd.hpp"
+
+#include <simd/cpu_features.hpp>
+
+
+namespace simd {
+  static perlin_row_kernel_t select_perlin_row_kernel() {
+#ifdef NOISES_X86_KERNELS
+    switch (detected_level()) {
+      case Level::avx512: return perlin_row_avx512;
+      case Level::avx2: return perlin_row_avx2;
+      case Level::sse42: return perlin_row_sse42;
+      case Level::scalar: return nullptr;
+    }
+#endif
+    return nullptr;
+  }
+
+  perlin_row_kernel_t perlin_row_kernel() {
+    static const perlin_row_kernel_t s_kernel = select_perlin_row_kernel();
+    return s_kernel;
+  }
+
+  static perlin_fixed_row_kernel_t select_perlin_fixed_row_kernel() {
+#ifdef NOISES_X86_KERNELS
+    switch (detected_level()) {
+      case Level::avx512: return perlin_fixed_row_avx512;
+      case Level::avx2: return perlin_fixed_row_avx2;
+      case Level::sse42: return perlin_fixed_row_sse42;
+      case Level::scalar: return nullptr;
+    }
+#endif
+    return nullptr;
+  }
+
+  perlin_fixed_row_kernel_t perlin_fixed_row_kernel() {
+    static const perlin_fixed_row_kernel_t s_kernel = select_perlin_fixed_row_kernel();
+    return s_kernel;
+  }
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <perlin.hpp>
+#include <interpolation.hpp>
+
+
+namespace simd {
+  // One row of PerlinNoise::fill. Per-column data is passed as arrays, per-row data as scalars.
+  // Columns outside of the grid have inside_x == 0, all other masks are 0 or -1.
+  // With hashed gradients near_cell_x may be negative and every column is inside.
+  struct PerlinRowArgs {
+    // stored gradients, nullptr unless the source is grid
+    const float* grid;
+    // quantized gradients, byte index into gradient_table per node. nullptr unless the source is quantized
+    const uint8_t* gradient_indices;
+    int grid_size_x;
+    // hashed gradients use gradient_seed, see gradients::hash_node
+    const float* gradient_table;
+    uint32_t gradient_seed;
+    int top;
+
+    const float* near_offset_x;
+    const float* far_offset_x;
+    const float* interp_k_x;
+    const float* hermite_value_near_x;
+    const float* hermite_value_far_x;
+    const float* hermite_derivative_near_x;
+    const float* hermite_derivative_far_x;
+    const int* near_cell_x;
+    const int* is_near_half_x;
+    const int* inside_x;
+
+    float near_offset_y;
+    float far_offset_y;
+    float interp_k_y;
+    interpolation::HermiteWeights hermite_y;
+    bool is_near_half_y;
+
+    float cell_diagonal;
+    PerlinNoiseParameters::InterpolationAlgorithm interpolation_algorithm;
+    bool normalize_offsets;
+
+    float* out;
+    int count;
+  };
+
+  // Evaluates as many samples of the row as fit into whole vectors and returns how many were written.
+  // The results are identical to the scalar path.
+  using perlin_row_kernel_t = int(*)(const PerlinRowArgs&);
+
+  // One row of the fixed-point path of PerlinNoise::fill_u8 and fill_u16, see PerlinRowArgs.
+  // Only bilinear, bicubic_zero and nearest_neighboor, without normalized offsets.
+  // Gradients and offsets (in cell diagonals) have 15 fractional bits, fade weights 14. They are 16-bit
+  // values packed in pairs, so a dot product or a lerp is a single multiply-add of the pairs
+  struct PerlinFixedRowArgs {
+    const float* grid;
+    const uint8_t* gradient_indices;
+    int grid_size_x;
+    // gradients::s_fixed_unit_vectors
+    const int* gradient_table;
+    uint32_t gradient_seed;
+    int top;
+
+    // offsets in the low 16 bits, the high ones are 0
+    const int* near_offset_x;
+    const int* far_offset_x;
+    // near and far weights, packed
+    const int* fade_x;
+    const int* near_cell_x;
+    const int* is_near_half_x;
+    const int* inside_x;
+
+    // offsets in the high 16 bits, the low ones are 0
+    int near_offset_y;
+    int far_offset_y;
+    int fade_y;
+    bool is_near_half_y;
+
+    PerlinNoiseParameters::InterpolationAlgorithm interpolation_algorithm;
+
+    // (1 + value) / 2 with 16 fractional bits, in [0, 1 << 16). 0 outside of the grid
+    int* out;
+    int count;
+  };
+
+  // Same as perlin_row_kernel_t, the results are identical to the scalar fixed-point path
+  using perlin_fixed_row_kernel_t = int(*)(const PerlinFixedRowArgs&);
+
+  // Kernels for the best instruction set of this cpu, nullptr if there is none
+  perlin_row_kernel_t perlin_row_kernel();
+  perlin_fixed_row_kernel_t perlin_fixed_row_kernel();
+
+  int perlin_row_sse42(const PerlinRowArgs&);
+  int perlin_row_avx2(const PerlinRowArgs&);
+  int perlin_row_avx512(const PerlinRowArgs&);
+  int perlin_fixed_row_sse42(const PerlinFixedRowArgs&);
+  int perlin_fixed_row_avx2(const PerlinFixedRowArgs&);
+  int perlin_fixed_row_avx512(const PerlinFixedRowArgs&);
+}
@@ -0,0 +1,79 @@
+#include <simd/perlin_simd.hpp>
+
+#ifdef NOISES_X86_KERNELS
+
+#include <simd/perlin_kernel.hpp>
+#include <nmmintrin.h>
+
+
+namespace {
+  struct Sse42Ops {
+    static constexpr int width = 4;
+    using f32 = __m128;
+    using i32 = __m128i;
+    using mask = __m128;
+
+    static f32 load(const float* ptr) { return _mm_loadu_ps(ptr); }
+    static i32 load(const int* ptr) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr)); }
+    static void store(float* ptr, f32 value) { _mm_storeu_ps(ptr, value); }
+    static void store(int* ptr, i32 value) { _mm_storeu_si128(reinterpret_cast<__m128i*>(ptr), value); }
+
+    static f32 set1(float value) { return _mm_set1_ps(value); }
+    static i32 set1(int value) { return _mm_set1_epi32(value); }
+
+    static f32 add(f32 a, f32 b) { return _mm_add_ps(a, b); }
+    static f32 sub(f32 a, f32 b) { return _mm_sub_ps(a, b); }
+    static f32 mul(f32 a, f32 b) { return _mm_mul_ps(a, b); }
+    static f32 div(f32 a, f32 b) { return _mm_div_ps(a, b); }
+    static f32 sqrt(f32 a) { return _mm_sqrt_ps(a); }
+
+    static i32 add(i32 a, i32 b) { return _mm_add_epi32(a, b); }
+    static i32 sub(i32 a, i32 b) { return _mm_sub_epi32(a, b); }
+    static i32 bit_and(i32 a, i32 b) { return _mm_and_si128(a, b); }
+    static i32 shift_left(i32 a, int bits) { return _mm_slli_epi32(a, bits); }
+    static i32 shift_right(i32 a, int bits) { return _mm_srli_epi32(a, bits); }
+    static i32 bit_xor(i32 a, i32 b) { return _mm_xor_si128(a, b); }
+    static i32 mul_lo(i32 a, i32 b) { return _mm_mullo_epi32(a, b); }
+    static i32 shift_right_arith(i32 a, int bits) { return _mm_srai_epi32(a, bits); }
+    static i32 min(i32 a, i32 b) { return _mm_min_epi32(a, b); }
+    static i32 max(i32 a, i32 b) { return _mm_max_epi32(a, b); }
+    // rounds to nearest even like std::nearbyint
+    static i32 round_to_int(f32 a) { return _mm_cvtps_epi32(a); }
+    static i32 madd(i32 a, i32 b) { return _mm_madd_epi16(a, b); }
+    static i32 bit_or(i32 a, i32 b) { return _mm_or_si128(a, b); }
+
+    // no gather instruction before avx2
+    static f32 gather(const float* base, i32 idx) {
+      alignas(16) int lanes[4];
+      _mm_store_si128(reinterpret_cast<__m128i*>(lanes), idx);
+      return _mm_setr_ps(base[lanes[0]], base[lanes[1]], base[lanes[2]], base[lanes[3]]);
+    }
+
+    static i32 gather(const int* base, i32 idx) {
+      alignas(16) int lanes[4];
+      _mm_store_si128(reinterpret_cast<__m128i*>(lanes), idx);
+      return _mm_setr_epi32(base[lanes[0]], base[lanes[1]], base[lanes[2]], base[lanes[3]]);
+    }
+
+    static i32 gather_byte(const uint8_t* base, i32 idx) {
+      alignas(16) int lanes[4];
+      _mm_store_si128(reinterpret_cast<__m128i*>(lanes), idx);
+      return _mm_setr_epi32(base[lanes[0]], base[lanes[1]], base[lanes[2]], base[lanes[3]]);
+    }
+
+    static mask less(f32 a, f32 b) { return _mm_cmplt_ps(a, b); }
+    static mask int_mask(i32 bits) { return _mm_castsi128_ps(bits); }
+    static f32 select(mask m, f32 if_true, f32 if_false) { return _mm_blendv_ps(if_false, if_true, m); }
+    static i32 select(i32 bits, i32 if_true, i32 if_false) { return _mm_blendv_epi8(if_false, if_true, bits); }
+  };
+}
+
+int simd::perlin_row_sse42(const PerlinRowArgs& args) {
+  return kernel::perlin_row<Sse42Ops>(args);
+}
+
+int simd::perlin_fixed_row_sse42(const PerlinFixedRowArgs& args) {
+  return kernel::perlin_fixed_row<Sse42Ops>(args);
+}
+
+#endif // NOISES_X86_KERNELS
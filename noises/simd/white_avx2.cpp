@@ -0,0 +1,42 @@
+#include <simd/white_simd.hpp>
+
+#ifdef NOISES_X86_KERNELS
+
+#include <simd/white_kernel.hpp>
+#include <immintrin.h>
+
+
+namespace {
+  struct Avx2Ops {
+    static constexpr int width = 4;
+    using u64 = __m256i;
+
+    static u64 set1(uint64_t value) { return _mm256_set1_epi64x(static_cast<long long>(value)); }
+    static u64 lane_multiples(uint64_t value) {
+      return _mm256_setr_epi64x(0, static_cast<long long>(value), static_cast<long long>(2 * value), static_cast<long long>(3 * value));
+    }
+
+    static u64 add(u64 a, u64 b) { return _mm256_add_epi64(a, b); }
+    static u64 bit_and(u64 a, u64 b) { return _mm256_and_si256(a, b); }
+    static u64 bit_or(u64 a, u64 b) { return _mm256_or_si256(a, b); }
+    static u64 bit_xor(u64 a, u64 b) { return _mm256_xor_si256(a, b); }
+    static u64 shift_right(u64 a, int bits) { return _mm256_srli_epi64(a, bits); }
+    // low 64 bits of the product from 32-bit multiplies, there is no 64-bit one
+    static u64 mul(u64 a, u64 b) {
+      const u64 cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), b), _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)));
+      return _mm256_add_epi64(_mm256_mul_epu32(a, b), _mm256_slli_epi64(cross, 32));
+    }
+    // value where a >= b, 0 elsewhere. Signed comparison, both must be below 2^63
+    static u64 keep_unless_less(u64 a, u64 b, u64 value) { return _mm256_andnot_si256(_mm256_cmpgt_epi64(b, a), value); }
+    static void store_low_halves(uint32_t* ptr, u64 value) {
+      const __m256i packed = _mm256_permutevar8x32_epi32(value, _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(ptr), _mm256_castsi256_si128(packed));
+    }
+  };
+}
+
+int simd::white_row_avx2(const WhiteRowArgs& args) {
+  return kernel::white_row<Avx2Ops>(args);
+}
+
+#endif // NOISES_X86_KERNELS
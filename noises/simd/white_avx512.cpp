@@ -0,0 +1,42 @@
+#include <simd/white_simd.hpp>
+
+#ifdef NOISES_X86_KERNELS
+
+#include <simd/white_kernel.hpp>
+#include <immintrin.h>
+
+
+namespace {
+  struct Avx512Ops {
+    static constexpr int width = 8;
+    using u64 = __m512i;
+
+    static u64 set1(uint64_t value) { return _mm512_set1_epi64(static_cast<long long>(value)); }
+    static u64 lane_multiples(uint64_t value) {
+      const auto lane = [value](uint64_t i) { return static_cast<long long>(i * value); };
+      return _mm512_setr_epi64(0, lane(1), lane(2), lane(3), lane(4), lane(5), lane(6), lane(7));
+    }
+
+    static u64 add(u64 a, u64 b) { return _mm512_add_epi64(a, b); }
+    static u64 bit_and(u64 a, u64 b) { return _mm512_and_si512(a, b); }
+    static u64 bit_or(u64 a, u64 b) { return _mm512_or_si512(a, b); }
+    static u64 bit_xor(u64 a, u64 b) { return _mm512_xor_si512(a, b); }
+    static u64 shift_right(u64 a, int bits) { return _mm512_maskz_srli_epi64(0xff, a, static_cast<unsigned>(bits)); }
+    static u64 shift_left(u64 a, int bits) { return _mm512_maskz_slli_epi64(0xff, a, static_cast<unsigned>(bits)); }
+    static u64 mul_32(u64 a, u64 b) { return _mm512_maskz_mul_epu32(0xff, a, b); }
+    // low 64 bits of the product from 32-bit multiplies, the 64-bit one needs avx512dq
+    static u64 mul(u64 a, u64 b) {
+      const u64 cross = add(mul_32(shift_right(a, 32), b), mul_32(a, shift_right(b, 32)));
+      return add(mul_32(a, b), shift_left(cross, 32));
+    }
+    // value where a >= b, 0 elsewhere
+    static u64 keep_unless_less(u64 a, u64 b, u64 value) { return _mm512_maskz_mov_epi64(_mm512_cmpge_epu64_mask(a, b), value); }
+    static void store_low_halves(uint32_t* ptr, u64 value) { _mm512_mask_cvtepi64_storeu_epi32(ptr, 0xff, value); }
+  };
+}
+
+int simd::white_row_avx512(const WhiteRowArgs& args) {
+  return kernel::white_row<Avx512Ops>(args);
+}
+
+#endif // NOISES_X86_KERNELS
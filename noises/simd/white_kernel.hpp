@@ -0,0 +1,45 @@
+#pragma once
+
+// Generic vectorized white noise row, see perlin_kernel.hpp for the rules of the including translation units.
+// Ops works on 64-bit lanes here
+
+#include <simd/white_simd.hpp>
+#include <gradients.hpp>
+
+
+namespace simd::kernel {
+  inline constexpr int s_white_channel_bits = 21;
+
+  template<typename Ops>
+  int white_row(const WhiteRowArgs& args) {
+    using u64 = typename Ops::u64;
+    constexpr int width = Ops::width;
+    const int count = args.count - args.count % width;
+
+    // SplitMix64 state of a counter is seed + (counter + 1) * increment, so neighbour pixels are one increment apart
+    u64 state = Ops::add(
+      Ops::set1(args.seed + (args.first_counter + 1) * gradients::s_splitmix_increment),
+      Ops::lane_multiples(gradients::s_splitmix_increment));
+    const u64 step = Ops::set1(gradients::s_splitmix_increment * uint64_t(width));
+    const u64 multiplier0 = Ops::set1(gradients::s_splitmix_multiplier0);
+    const u64 multiplier1 = Ops::set1(gradients::s_splitmix_multiplier1);
+    const u64 channelMask = Ops::set1((uint64_t(1) << s_white_channel_bits) - 1);
+    const u64 threshold = Ops::set1(uint64_t(args.threshold));
+    const u64 alpha = Ops::set1(uint64_t(0xff000000u));
+
+    for (int i = 0; i < count; i += width) {
+      u64 z = Ops::mul(Ops::bit_xor(state, Ops::shift_right(state, 30)), multiplier0);
+      z = Ops::mul(Ops::bit_xor(z, Ops::shift_right(z, 27)), multiplier1);
+      z = Ops::bit_xor(z, Ops::shift_right(z, 31));
+
+      u64 pixel = alpha;
+      for (int channel = 0; channel < 3; ++channel) {
+        const u64 bits = Ops::bit_and(Ops::shift_right(z, channel * s_white_channel_bits), channelMask);
+        pixel = Ops::bit_or(pixel, Ops::keep_unless_less(bits, threshold, Ops::set1(uint64_t(0xff) << (8 * channel))));
+      }
+      Ops::store_low_halves(args.out + i, pixel);
+      state = Ops::add(state, step);
+    }
+    return count;
+  }
+}
@@ -0,0 +1,23 @@
+#include "white_simd.hpp"
+
+#include <simd/cpu_features.hpp>
+
+
+namespace simd {
+  static white_row_kernel_t select_white_row_kernel() {
+#ifdef NOISES_X86_KERNELS
+    switch (detected_level()) {
+      case Level::avx512: return white_row_avx512;
+      case Level::avx2: return white_row_avx2;
+      case Level::sse42: return white_row_sse42;
+      case Level::scalar: return nullptr;
+    }
+#endif
+    return nullptr;
+  }
+
+  white_row_kernel_t white_row_kernel() {
+    static const white_row_kernel_t s_kernel = select_white_row_kernel();
+    return s_kernel;
+  }
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+
+
+namespace simd {
+  // One row of WhiteNoise::fill_rgba. Pixel i gets the value counter_random(seed, first_counter + i),
+  // its bits 0-20, 21-41 and 42-62 are compared with threshold for red, green and blue
+  struct WhiteRowArgs {
+    uint64_t seed;
+    uint64_t first_counter;
+    uint32_t threshold;
+
+    uint32_t* out;
+    int count;
+  };
+
+  // Writes as many pixels of the row as fit into whole vectors and returns how many were written.
+  // The results are identical to the scalar path
+  using white_row_kernel_t = int(*)(const WhiteRowArgs&);
+
+  // Kernel for the best instruction set of this cpu, nullptr if there is none
+  white_row_kernel_t white_row_kernel();
+
+  int white_row_sse42(const WhiteRowArgs&);
+  int white_row_avx2(const WhiteRowArgs&);
+  int white_row_avx512(const WhiteRowArgs&);
+}
@@ -0,0 +1,39 @@
+#include <simd/white_simd.hpp>
+
+#ifdef NOISES_X86_KERNELS
+
+#include <simd/white_kernel.hpp>
+#include <nmmintrin.h>
+
+
+namespace {
+  struct Sse42Ops {
+    static constexpr int width = 2;
+    using u64 = __m128i;
+
+    static u64 set1(uint64_t value) { return _mm_set1_epi64x(static_cast<long long>(value)); }
+    static u64 lane_multiples(uint64_t value) { return _mm_set_epi64x(static_cast<long long>(value), 0); }
+
+    static u64 add(u64 a, u64 b) { return _mm_add_epi64(a, b); }
+    static u64 bit_and(u64 a, u64 b) { return _mm_and_si128(a, b); }
+    static u64 bit_or(u64 a, u64 b) { return _mm_or_si128(a, b); }
+    static u64 bit_xor(u64 a, u64 b) { return _mm_xor_si128(a, b); }
+    static u64 shift_right(u64 a, int bits) { return _mm_srli_epi64(a, bits); }
+    // low 64 bits of the product from 32-bit multiplies, there is no 64-bit one
+    static u64 mul(u64 a, u64 b) {
+      const u64 cross = _mm_add_epi64(_mm_mul_epu32(_mm_srli_epi64(a, 32), b), _mm_mul_epu32(a, _mm_srli_epi64(b, 32)));
+      return _mm_add_epi64(_mm_mul_epu32(a, b), _mm_slli_epi64(cross, 32));
+    }
+    // value where a >= b, 0 elsewhere. Signed comparison, both must be below 2^63
+    static u64 keep_unless_less(u64 a, u64 b, u64 value) { return _mm_andnot_si128(_mm_cmpgt_epi64(b, a), value); }
+    static void store_low_halves(uint32_t* ptr, u64 value) {
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(ptr), _mm_shuffle_epi32(value, _MM_SHUFFLE(2, 0, 2, 0)));
+    }
+  };
+}
+
+int simd::white_row_sse42(const WhiteRowArgs& args) {
+  return kernel::white_row<Sse42Ops>(args);
+}
+
+#endif // NOISES_X86_KERNELS
@@ -0,0 +1,89 @@
+#include "simplex.hpp"
+
+#include <cmath>
+#include <algorithm>
+#include <vector>
+#include <gradients.hpp>
+
+
+// skews the square grid so every square becomes two equilateral triangles, and back
+static constexpr float s_skew = 0.366025403784f;   // (sqrt(3) - 1) / 2
+static constexpr float s_unskew = 0.211324865405f; // (3 - sqrt(3)) / 6
+// squared distance at which a corner stops contributing
+static constexpr float s_radius_squared = 0.5f;
+// largest possible sum of the corners with unit gradients is 1 / 99.204
+static constexpr float s_scale = 99.204f;
+
+// position in grid steps
+static float calc_lattice_coord(float coord, float offset, float step) {
+  return (coord - offset) / step;
+}
+
+static float calc_corner(uint32_t seed, int x, int y, float dx, float dy) {
+  float t = s_radius_squared - dx * dx - dy * dy;
+  if (t <= 0.0f) {
+    return 0.0f;
+  }
+  const float* gradient = gradients::hashed_gradient(seed, x, y);
+  t *= t;
+  return t * t * (dx * gradient[0] + dy * gradient[1]);
+}
+
+float SimplexNoise::calc_raw(uint32_t seed, float u, float v) {
+  const float skew = (u + v) * s_skew;
+  const int i = int(std::floor(u + skew));
+  const int j = int(std::floor(v + skew));
+
+  const float unskew = float(i + j) * s_unskew;
+  const float x0 = u - (float(i) - unskew);
+  const float y0 = v - (float(j) - unskew);
+
+  // lower or upper triangle of the skewed square
+  const int stepI = x0 > y0 ? 1 : 0;
+  const int stepJ = 1 - stepI;
+  const float x1 = x0 - float(stepI) + s_unskew;
+  const float y1 = y0 - float(stepJ) + s_unskew;
+  const float x2 = x0 - 1.0f + 2.0f * s_unskew;
+  const float y2 = y0 - 1.0f + 2.0f * s_unskew;
+
+  const float sum = calc_corner(seed, i, j, x0, y0)
+    + calc_corner(seed, i + stepI, j + stepJ, x1, y1)
+    + calc_corner(seed, i + 1, j + 1, x2, y2);
+  return sum * s_scale;
+}
+
+static float evaluate(uint32_t seed, float u, float v) {
+  return std::clamp((1.0f + SimplexNoise::calc_raw(seed, u, v)) / 2.0f, 0.0f, 1.0f);
+}
+
+SimplexNoise::SimplexNoise(const SimplexNoiseParameters& parameters, uint64_t seed)
+: m_parameters(parameters)
+, m_seed(seed)
+// same stream as hashed PerlinNoise gradients
+, m_hash_seed(static_cast<uint32_t>(gradients::counter_random(~seed, 0) >> 32)) {
+}
+
+float SimplexNoise::operator()(float x, float y) const {
+  return evaluate(m_hash_seed,
+    calc_lattice_coord(x, m_parameters.offset_x, m_parameters.grid_step_x),
+    calc_lattice_coord(y, m_parameters.offset_y, m_parameters.grid_step_y));
+}
+
+void SimplexNoise::fill(std::span<float> out, int x0, int y0, int w, int h, size_t stride) const {
+  std::vector<float> columns(static_cast<size_t>(w));
+  for (int i = 0; i < w; ++i) {
+    columns[size_t(i)] = calc_lattice_coord(float(x0 + i), m_parameters.offset_x, m_parameters.grid_step_x);
+  }
+
+  for (int j = 0; j < h; ++j) {
+    float* row = out.data() + size_t(j) * stride;
+    const float v = calc_lattice_coord(float(y0 + j), m_parameters.offset_y, m_parameters.grid_step_y);
+    for (int i = 0; i < w; ++i) {
+      row[i] = evaluate(m_hash_seed, columns[size_t(i)], v);
+    }
+  }
+}
+
+void SimplexNoise::fill_row(std::span<float> out, int x0, int y, int w) const {
+  fill(out, x0, y, w, 1, size_t(w));
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <span>
+#include <cstdint>
+
+
+struct SimplexNoiseParameters {
+  float grid_step_x;
+  float grid_step_y;
+
+  float offset_x = 0.0f;
+  float offset_y = 0.0f;
+};
+
+// 2D simplex noise: every sample sums 3 corners of a triangle instead of the 4 cell corners of PerlinNoise.
+// Gradients are picked by a seeded hash of the node (see gradients::hash_node), so nothing is stored
+// and the noise has no bounds
+class SimplexNoise {
+public:
+  // Gradients depend only on the seed, they are the same on every platform
+  SimplexNoise(const SimplexNoiseParameters& parameters, uint64_t seed);
+
+  float operator()(float x, float y) const;
+
+  // Evaluates w x h samples starting at (x0, y0) into out, rows are stride floats apart.
+  // Gives the same values as operator(), but per-column and per-row work is done once.
+  void fill(std::span<float> out, int x0, int y0, int w, int h, size_t stride) const;
+  void fill_row(std::span<float> out, int x0, int y, int w) const;
+
+  // Unclamped sum of the corners scaled to [-1, 1], u and v are in grid steps
+  static float calc_raw(uint32_t hash_seed, float u, float v);
+
+  const SimplexNoiseParameters m_parameters;
+  const uint64_t m_seed;
+  const uint32_t m_hash_seed;
+};
@@ -0,0 +1,112 @@
+#include "spectral.hpp"
+
+#include <cmath>
+#include <algorithm>
+#include <parallel.hpp>
+#include <gradients.hpp>
+
+
+static constexpr size_t s_min_rows_per_thread = 16;
+
+// Frequency index of the row, rows past the middle are the negative frequencies
+static int signed_frequency(size_t k, size_t size) {
+  return k <= size / 2 ? int(k) : int(k) - int(size);
+}
+
+SpectralNoise::SpectralNoise(const SpectralNoiseParameters& parameters, uint64_t seed)
+: m_parameters(parameters)
+, m_seed(seed)
+, m_width(int(fft::next_power_of_two(size_t(std::max(parameters.size_x, 2)))))
+, m_height(int(fft::next_power_of_two(size_t(std::max(parameters.size_y, 1)))))
+, m_row_stride(2 * fft::half_spectrum_width(size_t(m_width))) {
+  const size_t w = size_t(m_width);
+  const size_t h = size_t(m_height);
+  const size_t columns = fft::half_spectrum_width(w);
+  m_data.resize(columns * h);
+
+  // in cycles per pixel
+  const float maxFrequency = m_parameters.min_wavelength > 0.0f ? 1.0f / m_parameters.min_wavelength : 0.5f;
+  const float minFrequency = m_parameters.max_wavelength > 0.0f ? 1.0f / m_parameters.max_wavelength : 0.0f;
+  const float amplitudeExponent = -0.5f * m_parameters.exponent;
+
+  auto phase = [this](int kx, int ky) {
+    const uint64_t node = (uint64_t(uint32_t(ky)) << 32) | uint64_t(uint32_t(kx));
+    const auto direction = gradients::turn_to_unit_vector(gradients::random_turn(m_seed, node));
+    return fft::complex_t(direction[0], direction[1]);
+  };
+
+  auto generate = [&](size_t begin, size_t end) {
+    for (size_t row = begin; row < end; ++row) {
+      const int ky = signed_frequency(row, h);
+      const float fy = float(ky) / float(h);
+      for (size_t column = 0; column < columns; ++column) {
+        const int kx = int(column);
+        const float fx = float(kx) / float(w);
+        const float frequency = std::sqrt(fx * fx + fy * fy);
+        if (frequency == 0.0f || frequency < minFrequency || frequency > maxFrequency) {
+          m_data[row * columns + column] = 0.0f;
+          continue;
+        }
+        const float amplitude = std::pow(frequency, amplitudeExponent);
+
+        // the first and the last column hold both the positive and negative frequencies along y,
+        // they must be conjugate for the field to be real
+        fft::complex_t value;
+        const bool selfConjugateColumn = column == 0 || column == columns - 1;
+        if (selfConjugateColumn && ky < 0) {
+          value = std::conj(phase(kx, -ky));
+        } else if (selfConjugateColumn && (ky == 0 || ky == int(h / 2))) {
+          value = phase(kx, ky).real();
+        } else {
+          value = phase(kx, ky);
+        }
+        m_data[row * columns + column] = amplitude * value;
+      }
+    }
+  };
+
+  // every frequency is independent, so the result does not depend on the split
+  parallel::for_ranges(h, s_min_rows_per_thread, m_parameters.threads, generate);
+
+  fft::inverse_real_2d(m_data, w, h, m_parameters.threads);
+
+  const float* field = fft::real_field(m_data.data());
+  float minValue = field[0];
+  float maxValue = field[0];
+  for (size_t y = 0; y < h; ++y) {
+    const float* row = field + y * m_row_stride;
+    for (size_t x = 0; x < w; ++x) {
+      minValue = std::min(minValue, row[x]);
+      maxValue = std::max(maxValue, row[x]);
+    }
+  }
+  m_min = minValue;
+  m_scale = maxValue > minValue ? 1.0f / (maxValue - minValue) : 0.0f;
+}
+
+float SpectralNoise::value(int x, int y) const {
+  return (fft::real_field(m_data.data())[size_t(y) * m_row_stride + size_t(x)] - m_min) * m_scale;
+}
+
+float SpectralNoise::operator()(float x, float y) const {
+  // sizes are powers of two, the mask wraps negative coordinates too
+  const int px = int(std::floor(x)) & (m_width - 1);
+  const int py = int(std::floor(y)) & (m_height - 1);
+  return value(px, py);
+}
+
+void SpectralNoise::fill(std::span<float> out, int x0, int y0, int w, int h, size_t stride) const {
+  for (int j = 0; j < h; ++j) {
+    float* row = out.data() + size_t(j) * stride;
+    const int y = (y0 + j) & (m_height - 1);
+    int x = x0 & (m_width - 1);
+    for (int i = 0; i < w; ++i) {
+      row[i] = value(x, y);
+      x = (x + 1) & (m_width - 1);
+    }
+  }
+}
+
+void SpectralNoise::fill_row(std::span<float> out, int x0, int y, int w) const {
+  fill(out, x0, y, w, 1, size_t(w));
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include <cstdint>
+#include <fft.hpp>
+
+
+struct SpectralNoiseParameters {
+  // size of the generated field, rounded up to powers of two. The field repeats outside of it
+  int size_x;
+  int size_y;
+
+  // power falls off as 1 / f^exponent: 0 is white, 1 pink, 2 brown, negative values give blue and violet noise
+  float exponent = 1.0f;
+
+  // wavelengths in pixels the spectrum is limited to, max_wavelength 0 means the field size
+  float min_wavelength = 2.0f;
+  float max_wavelength = 0.0f;
+
+  // threads of the FFT, 0 uses all hardware threads
+  int threads = 0;
+};
+
+// Colored noise made in the frequency domain: a spectrum with the power-law amplitude and random phases
+// is transformed back with the inverse FFT. The whole field is generated in the constructor and stored,
+// the noise is periodic with the field size. Phases depend only on the seed and the frequency
+class SpectralNoise {
+public:
+  SpectralNoise(const SpectralNoiseParameters& parameters, uint64_t seed);
+
+  // Field value mapped to [0, 1] by the smallest and largest value of the field.
+  // Only defined at whole pixels, the pixel containing (x, y) is returned
+  float operator()(float x, float y) const;
+
+  // Evaluates w x h samples starting at (x0, y0) into out, rows are stride floats apart
+  void fill(std::span<float> out, int x0, int y0, int w, int h, size_t stride) const;
+  void fill_row(std::span<float> out, int x0, int y, int w) const;
+
+  int width() const {
+    return m_width;
+  }
+
+  int height() const {
+    return m_height;
+  }
+
+  const SpectralNoiseParameters m_parameters;
+  const uint64_t m_seed;
+
+private:
+  float value(int x, int y) const;
+
+  int m_width;
+  int m_height;
+  // the spectrum transformed in place, see fft::inverse_real_2d for the layout of the field
+  std::vector<fft::complex_t> m_data;
+  size_t m_row_stride;
+  float m_min = 0.0f;
+  float m_scale = 0.0f;
+};
@@ -0,0 +1,74 @@
+#include "warp.hpp"
+
+#include <algorithm>
+#include <gradients.hpp>
+#include <gradient_noise.hpp>
+
+
+static DomainWarpParameters clamp_levels(DomainWarpParameters parameters) {
+  parameters.levels = std::clamp(parameters.levels, 0, DomainWarp::s_max_levels);
+  return parameters;
+}
+
+static constexpr auto s_interpolation = GradientNoiseInterpolation::quintic;
+
+static gradient_noise::LatticeAxis calc_axis(float coord, float step) {
+  return gradient_noise::calc_lattice_axis<s_interpolation>(coord / step);
+}
+
+// Moves the position by both fields of the level, evaluated on the same lattice axes
+static void apply_level(const DomainWarp& warp, int level, gradient_noise::LatticeAxis ax, gradient_noise::LatticeAxis ay,
+                        float& x, float& y) {
+  const auto& seeds = warp.m_hash_seeds[size_t(level)];
+  const float strength = warp.m_parameters.strength;
+  const float dx = gradient_noise::evaluate<2>(seeds[0], {ax, ay});
+  const float dy = gradient_noise::evaluate<2>(seeds[1], {ax, ay});
+  x += strength * dx;
+  y += strength * dy;
+}
+
+static void apply_levels_from(const DomainWarp& warp, int first_level, float& x, float& y) {
+  const auto& params = warp.m_parameters;
+  for (int level = first_level; level < params.levels; ++level) {
+    apply_level(warp, level, calc_axis(x, params.grid_step_x), calc_axis(y, params.grid_step_y), x, y);
+  }
+}
+
+DomainWarp::DomainWarp(const DomainWarpParameters& parameters, uint64_t seed)
+: m_parameters(clamp_levels(parameters))
+, m_seed(seed) {
+  for (size_t level = 0; level < m_hash_seeds.size(); ++level) {
+    for (size_t axis = 0; axis < 2; ++axis) {
+      m_hash_seeds[level][axis] = static_cast<uint32_t>(gradients::counter_random(seed, level * 2 + axis) >> 32);
+    }
+  }
+}
+
+std::array<float, 2> DomainWarp::warp(float x, float y) const {
+  float warpedX = x;
+  float warpedY = y;
+  apply_levels_from(*this, 0, warpedX, warpedY);
+  return { warpedX, warpedY };
+}
+
+void DomainWarp::warp_row(std::span<float> out_x, std::span<float> out_y, int x0, int y, int w) const {
+  const float rowY = float(y);
+  if (m_parameters.levels == 0) {
+    for (int i = 0; i < w; ++i) {
+      out_x[size_t(i)] = float(x0 + i);
+      out_y[size_t(i)] = rowY;
+    }
+    return;
+  }
+
+  // the first level is evaluated on the sample grid itself
+  const auto rowAxis = calc_axis(rowY, m_parameters.grid_step_y);
+  for (int i = 0; i < w; ++i) {
+    float x = float(x0 + i);
+    float warpedY = rowY;
+    apply_level(*this, 0, calc_axis(x, m_parameters.grid_step_x), rowAxis, x, warpedY);
+    apply_levels_from(*this, 1, x, warpedY);
+    out_x[size_t(i)] = x;
+    out_y[size_t(i)] = warpedY;
+  }
+}
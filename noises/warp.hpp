@@ -0,0 +1,53 @@
+#pragma once
+
+#include <span>
+#include <array>
+#include <vector>
+#include <cstdint>
+
+
+struct DomainWarpParameters {
+  // of the warp fields
+  float grid_step_x;
+  float grid_step_y;
+
+  // displacement for the largest warp field value
+  float strength = 40.0f;
+  // every level warps the position produced by the previous one
+  int levels = 1;
+};
+
+// Moves sample positions by fields of unbounded gradient noise: p + strength * (noise_x(p), noise_y(p)).
+// Both fields of a level are evaluated at the same point, so they share the lattice setup
+class DomainWarp {
+public:
+  static constexpr int s_max_levels = 4;
+
+  // Level count is clamped to [0, s_max_levels]
+  DomainWarp(const DomainWarpParameters& parameters, uint64_t seed);
+
+  std::array<float, 2> warp(float x, float y) const;
+  // Warped positions of the samples (x0 + i, y) for i in [0, w).
+  // Gives the same positions as warp(), but the first level lattice setup of y is done once for the row
+  void warp_row(std::span<float> out_x, std::span<float> out_y, int x0, int y, int w) const;
+
+  // field(warp(x, y)) for w x h samples starting at (x0, y0) into out, rows are stride floats apart.
+  // Field is anything with float operator()(float x, float y) const, e.g. PerlinEvaluator
+  template<typename Field>
+  void fill(const Field& field, std::span<float> out, int x0, int y0, int w, int h, size_t stride) const {
+    std::vector<float> xs(static_cast<size_t>(w));
+    std::vector<float> ys(static_cast<size_t>(w));
+    for (int j = 0; j < h; ++j) {
+      float* row = out.data() + size_t(j) * stride;
+      warp_row(xs, ys, x0, y0 + j, w);
+      for (int i = 0; i < w; ++i) {
+        row[i] = field(xs[size_t(i)], ys[size_t(i)]);
+      }
+    }
+  }
+
+  const DomainWarpParameters m_parameters;
+  const uint64_t m_seed;
+  // per level, for the x and the y field
+  std::array<std::array<uint32_t, 2>, s_max_levels> m_hash_seeds{};
+};
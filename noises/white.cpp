@@ -0,0 +1,65 @@
+#include "white.hpp"
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <parallel.hpp>
+#include <gradients.hpp>
+#include <simd/white_simd.hpp>
+#include <simd/white_kernel.hpp>
+
+
+static constexpr size_t s_min_rows_per_thread = 16;
+
+// Value of the stream for the pixel. Counters of neighbour pixels of a row are consecutive
+static uint64_t pixel_counter(int x, int y) {
+  return (uint64_t(uint32_t(y)) << 32) + uint64_t(int64_t(x));
+}
+
+// Same as simd::kernel::white_row
+static uint32_t bits_to_rgba(uint64_t bits, uint32_t threshold) {
+  constexpr int channelBits = simd::kernel::s_white_channel_bits;
+  uint32_t pixel = 0xff000000u;
+  for (int channel = 0; channel < 3; ++channel) {
+    const uint32_t value = uint32_t(bits >> (channel * channelBits)) & ((1u << channelBits) - 1);
+    pixel |= value < threshold ? 0u : 0xffu << (8 * channel);
+  }
+  return pixel;
+}
+
+WhiteNoise::WhiteNoise(const WhiteNoiseParameters& parameters, uint64_t seed)
+: m_parameters(parameters)
+, m_seed(seed)
+, m_threshold(uint32_t(std::lround(std::clamp(parameters.black_probability, 0.0f, 1.0f) * float(1u << simd::kernel::s_white_channel_bits)))) {
+}
+
+uint32_t WhiteNoise::operator()(int x, int y) const {
+  return bits_to_rgba(gradients::counter_random(m_seed, pixel_counter(x, y)), m_threshold);
+}
+
+void WhiteNoise::fill_rgba_row(uint32_t* out, int x0, int y, int w) const {
+  int done = 0;
+  if (const auto kernel = simd::white_row_kernel()) {
+    done = kernel(simd::WhiteRowArgs{
+      .seed = m_seed,
+      .first_counter = pixel_counter(x0, y),
+      .threshold = m_threshold,
+      .out = out,
+      .count = w
+    });
+  }
+  for (int i = done; i < w; ++i) {
+    out[i] = (*this)(x0 + i, y);
+  }
+}
+
+void WhiteNoise::fill_rgba(std::span<uint32_t> out, int x0, int y0, int w, int h, size_t stride, int threads) const {
+  if (h <= 0) {
+    return;
+  }
+  parallel::for_ranges(size_t(h), s_min_rows_per_thread, threads, [&](size_t begin, size_t end) {
+    for (size_t j = begin; j < end; ++j) {
+      fill_rgba_row(out.data() + j * stride, x0, y0 + int(j), w);
+    }
+  });
+}
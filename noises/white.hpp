@@ -0,0 +1,34 @@
+#pragma once
+
+#include <span>
+#include <cstdint>
+
+
+struct WhiteNoiseParameters {
+  // chance of a color channel to be 0 instead of 255, every channel is drawn on its own
+  float black_probability = 0.5f;
+};
+
+// Random colors, every pixel is one value of the counter-based SplitMix64 stream (see gradients::counter_random)
+// numbered by its position. Nothing is stored, the noise depends only on the seed and is the same on every
+// platform and for every split between threads
+class WhiteNoise {
+public:
+  WhiteNoise(const WhiteNoiseParameters& parameters, uint64_t seed);
+
+  // Color packed as 8-bit R, G, B, A from the lowest byte up, alpha is 255
+  uint32_t operator()(int x, int y) const;
+
+  // Evaluates w x h pixels starting at (x0, y0) into out, rows are stride pixels apart.
+  // Rows are split between threads, 0 uses all hardware threads
+  void fill_rgba(std::span<uint32_t> out, int x0, int y0, int w, int h, size_t stride, int threads = 1) const;
+
+  const WhiteNoiseParameters m_parameters;
+  const uint64_t m_seed;
+
+private:
+  void fill_rgba_row(uint32_t* out, int x0, int y, int w) const;
+
+  // a channel is black when its 21 random bits are below it
+  uint32_t m_threshold;
+};
@@ -0,0 +1,179 @@
+#include "worley.hpp"
+
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <gradients.hpp>
+
+
+using Metric = WorleyNoiseParameters::Metric;
+using Feature = WorleyNoiseParameters::Feature;
+
+// largest value of each feature with full jitter, per metric. Measured over 64M samples
+static constexpr float s_max_values[3][3] = {
+  // f1   f2     f2 - f1
+  { 1.25f, 1.5f, 1.4f }, // euclidean
+  { 1.75f, 1.9f, 1.7f }, // manhattan
+  { 1.0f, 1.45f, 1.35f } // chebyshev
+};
+
+// points of the 3 cells above each other
+using CandidateColumn = std::array<float, 6>;
+
+template<Metric metric>
+static float calc_distance(float dx, float dy) {
+  if constexpr (metric == Metric::euclidean) {
+    // squared, the root is taken only of the result
+    return dx * dx + dy * dy;
+  } else if constexpr (metric == Metric::manhattan) {
+    return std::abs(dx) + std::abs(dy);
+  } else {
+    return std::max(std::abs(dx), std::abs(dy));
+  }
+}
+
+template<Metric metric, Feature feature>
+static float evaluate(float u, float v, const CandidateColumn* columns) {
+  float closest = std::numeric_limits<float>::max();
+  float second = std::numeric_limits<float>::max();
+  for (int column = 0; column < 3; ++column) {
+    for (int i = 0; i < 3; ++i) {
+      const float distance = calc_distance<metric>(columns[column][size_t(i) * 2] - u, columns[column][size_t(i) * 2 + 1] - v);
+      if (distance < closest) {
+        second = closest;
+        closest = distance;
+      } else if (distance < second) {
+        second = distance;
+      }
+    }
+  }
+  if constexpr (metric == Metric::euclidean) {
+    closest = std::sqrt(closest);
+    second = std::sqrt(second);
+  }
+
+  float value = 0.0f;
+  if constexpr (feature == Feature::f1) {
+    value = closest;
+  } else if constexpr (feature == Feature::f2) {
+    value = second;
+  } else {
+    value = second - closest;
+  }
+  return std::clamp(value / s_max_values[int(metric)][int(feature)], 0.0f, 1.0f);
+}
+
+static CandidateColumn calc_candidate_column(const WorleyNoise& noise, int cell_x, int cell_y) {
+  CandidateColumn column;
+  for (int i = 0; i < 3; ++i) {
+    const auto point = noise.feature_point(cell_x, cell_y + i - 1);
+    column[size_t(i) * 2] = point[0];
+    column[size_t(i) * 2 + 1] = point[1];
+  }
+  return column;
+}
+
+// position in cell units
+static float calc_cell_coord(float coord, float offset, float step) {
+  return (coord - offset) / step;
+}
+
+template<Metric metric, Feature feature>
+static float evaluate_point(const WorleyNoise& noise, float x, float y) {
+  const auto& params = noise.m_parameters;
+  const float u = calc_cell_coord(x, params.offset_x, params.grid_step_x);
+  const float v = calc_cell_coord(y, params.offset_y, params.grid_step_y);
+  const int cellX = int(std::floor(u));
+  const int cellY = int(std::floor(v));
+  const CandidateColumn columns[3] = {
+    calc_candidate_column(noise, cellX - 1, cellY),
+    calc_candidate_column(noise, cellX, cellY),
+    calc_candidate_column(noise, cellX + 1, cellY)
+  };
+  return evaluate<metric, feature>(u, v, columns);
+}
+
+template<Metric metric, Feature feature>
+static void fill_block(const WorleyNoise& noise, std::span<float> out, int x0, int y0, int w, int h, size_t stride) {
+  if (w <= 0) {
+    return;
+  }
+  const auto& params = noise.m_parameters;
+
+  std::vector<float> us(static_cast<size_t>(w));
+  std::vector<int> cellXs(static_cast<size_t>(w));
+  for (int i = 0; i < w; ++i) {
+    us[size_t(i)] = calc_cell_coord(float(x0 + i), params.offset_x, params.grid_step_x);
+    cellXs[size_t(i)] = int(std::floor(us[size_t(i)]));
+  }
+  const auto [minCell, maxCell] = std::minmax_element(cellXs.begin(), cellXs.end());
+  const int firstColumn = *minCell - 1;
+
+  // every sample of the row shares these, a sample uses the 3 around its cell
+  std::vector<CandidateColumn> columns(size_t(*maxCell - firstColumn + 2));
+  for (int j = 0; j < h; ++j) {
+    float* row = out.data() + size_t(j) * stride;
+    const float v = calc_cell_coord(float(y0 + j), params.offset_y, params.grid_step_y);
+    const int cellY = int(std::floor(v));
+    for (size_t c = 0; c < columns.size(); ++c) {
+      columns[c] = calc_candidate_column(noise, firstColumn + int(c), cellY);
+    }
+
+    for (int i = 0; i < w; ++i) {
+      row[i] = evaluate<metric, feature>(us[size_t(i)], v, &columns[size_t(cellXs[size_t(i)] - 1 - firstColumn)]);
+    }
+  }
+}
+
+// Calls f with std::integral_constant of the metric and the feature of the noise
+static decltype(auto) visit_worley(const WorleyNoiseParameters& params, auto&& f) {
+  auto withFeature = [&](auto metric) -> decltype(auto) {
+    switch (params.feature) {
+      case Feature::f1: return f(metric, std::integral_constant<Feature, Feature::f1>{});
+      case Feature::f2: return f(metric, std::integral_constant<Feature, Feature::f2>{});
+      case Feature::f2_minus_f1: return f(metric, std::integral_constant<Feature, Feature::f2_minus_f1>{});
+    }
+    std::unreachable();
+  };
+  switch (params.metric) {
+    case Metric::euclidean: return withFeature(std::integral_constant<Metric, Metric::euclidean>{});
+    case Metric::manhattan: return withFeature(std::integral_constant<Metric, Metric::manhattan>{});
+    case Metric::chebyshev: return withFeature(std::integral_constant<Metric, Metric::chebyshev>{});
+  }
+  std::unreachable();
+}
+
+WorleyNoise::WorleyNoise(const WorleyNoiseParameters& parameters, uint64_t seed)
+: m_parameters(parameters)
+, m_seed(seed)
+// same stream as hashed PerlinNoise gradients
+, m_hash_seed(static_cast<uint32_t>(gradients::counter_random(~seed, 0) >> 32)) {
+}
+
+std::array<float, 2> WorleyNoise::feature_point(int cell_x, int cell_y) const {
+  const uint32_t hash = gradients::hash_node(m_hash_seed, cell_x, cell_y);
+  const float randomX = float(hash & 0xffffu) * 0x1p-16f;
+  const float randomY = float(hash >> 16) * 0x1p-16f;
+  return {
+    float(cell_x) + 0.5f + (randomX - 0.5f) * m_parameters.jitter,
+    float(cell_y) + 0.5f + (randomY - 0.5f) * m_parameters.jitter
+  };
+}
+
+float WorleyNoise::operator()(float x, float y) const {
+  return visit_worley(m_parameters, [&](auto metric, auto feature) {
+    return evaluate_point<metric(), feature()>(*this, x, y);
+  });
+}
+
+void WorleyNoise::fill(std::span<float> out, int x0, int y0, int w, int h, size_t stride) const {
+  visit_worley(m_parameters, [&](auto metric, auto feature) {
+    fill_block<metric(), feature()>(*this, out, x0, y0, w, h, stride);
+  });
+}
+
+void WorleyNoise::fill_row(std::span<float> out, int x0, int y, int w) const {
+  fill(out, x0, y, w, 1, size_t(w));
+}
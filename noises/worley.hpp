@@ -0,0 +1,50 @@
+#pragma once
+
+#include <span>
+#include <array>
+#include <cstdint>
+
+
+struct WorleyNoiseParameters {
+  // every cell of the grid has one feature point
+  float grid_step_x;
+  float grid_step_y;
+
+  float offset_x = 0.0f;
+  float offset_y = 0.0f;
+
+  // how far a feature point may be from the middle of its cell, 0 gives a regular grid
+  float jitter = 1.0f;
+
+  enum class Metric {
+    euclidean, manhattan, chebyshev
+  } metric = Metric::euclidean;
+
+  enum class Feature {
+    f1,         // distance to the closest feature point
+    f2,         // distance to the second closest one
+    f2_minus_f1 // cell borders
+  } feature = Feature::f1;
+};
+
+// Cellular noise. Feature points are jittered by a seeded hash of their cell, so nothing is stored
+// and the noise has no bounds. A sample only looks at the points of the 3x3 cells around it
+class WorleyNoise {
+public:
+  WorleyNoise(const WorleyNoiseParameters& parameters, uint64_t seed);
+
+  // Distance in cell units mapped to [0, 1]
+  float operator()(float x, float y) const;
+
+  // Evaluates w x h samples starting at (x0, y0) into out, rows are stride floats apart.
+  // Gives the same values as operator(), but the feature points of a row are computed once for all its samples
+  void fill(std::span<float> out, int x0, int y0, int w, int h, size_t stride) const;
+  void fill_row(std::span<float> out, int x0, int y, int w) const;
+
+  // Position of the feature point of the cell, in cell units
+  std::array<float, 2> feature_point(int cell_x, int cell_y) const;
+
+  const WorleyNoiseParameters m_parameters;
+  const uint64_t m_seed;
+  const uint32_t m_hash_seed;
+};
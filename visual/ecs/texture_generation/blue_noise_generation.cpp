@@ -0,0 +1,63 @@
+#include "blue_noise_generation.hpp"
+#include "threaded_generation.hpp"
+
+#include <array>
+#include <ctime>
+#include <memory>
+#include <optional>
+#include <random>
+#include <span>
+#include <blue_noise.hpp>
+#include <render/noise_texture.hpp>
+#include <render/drawable_bitmap.hpp>
+
+using real_clock_t = std::chrono::steady_clock;
+// empty until the generation thread made the noise
+using blue_noise_holder_t = std::unique_ptr<std::optional<BlueNoise>>;
+
+
+void generate_blue_noise_texture(flecs::world& ecs, const Menu::EventGenerateBlueNoiseTexture& event) {
+  auto textureEntity = ecs.entity()
+    .emplace<NoiseTexture>(event.size[0], event.size[1])
+    .emplace<DrawableBitmap>(
+      Bitmap(event.size[0], event.size[1]),
+      vec2{0.0f, 0.0f}
+     );
+
+  auto seed = [&]{
+    if (event.random_seed <= 0) {
+      std::random_device dev{};
+      return dev();
+    } else {
+      return static_cast<unsigned int>(event.random_seed);
+    }
+  }();
+
+  auto startTime = std::clock();
+  auto realStartTime = real_clock_t::now();
+
+  auto noise = std::make_unique<std::optional<BlueNoise>>();
+  const BlueNoiseParameters parameters{
+    .size_x = event.size[0],
+    .size_y = event.size[1],
+    .sigma = event.sigma,
+    .initial_density = event.initial_density
+  };
+
+  start_threaded_generation(ecs, ThreadedGenerationParams{
+    .texture = textureEntity,
+    .texture_width = event.size[0],
+    .fill_u8 = [noisePtr = noise.get()](std::span<uint8_t> out, int x0, int y0, int w, int h, size_t stride) {
+      (*noisePtr)->fill_u8(out, x0, y0, w, h, stride);
+    },
+    // the whole mask is ranked, the fills only copy it
+    .prepare = [noisePtr = noise.get(), parameters, seed](const std::function<bool(float)>& progress) {
+      noisePtr->emplace(parameters, seed, progress);
+    },
+    .color0 = std::to_array(event.color0),
+    .color1 = std::to_array(event.color1),
+    .time_spent = std::clock() - startTime,
+    .real_time_spent = real_clock_t::now() - realStartTime
+  });
+  textureEntity.set<blue_noise_holder_t>(std::move(noise));
+}
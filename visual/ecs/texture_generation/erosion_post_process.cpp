@@ -0,0 +1,19 @@
+#include "erosion_post_process.hpp"
+
+#include <algorithm>
+#include <erosion.hpp>
+
+
+threaded_post_process_t make_erosion_post_process(const ErosionSettings& settings, uint64_t seed) {
+  if (!settings.enabled) {
+    return {};
+  }
+  return [parameters = settings.parameters, seed](std::span<float> field, int w, int h, const std::function<bool(float)>& progress) {
+    if (erode(parameters, seed, field, w, h, progress)) {
+      // deposits may go a little past the range of the colors
+      for (float& value : field) {
+        value = std::clamp(value, 0.0f, 1.0f);
+      }
+    }
+  };
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "threaded_generation.hpp"
+
+#include <cstdint>
+#include <gui/menu.hpp>
+
+
+// Erosion takes seconds where the filters take milliseconds, the share of the progress it gets when chained with them
+static constexpr float s_erosion_progress_share = 0.9f;
+
+// Erodes the generated field as a heightmap, empty when the erosion is disabled
+threaded_post_process_t make_erosion_post_process(const ErosionSettings& settings, uint64_t seed);
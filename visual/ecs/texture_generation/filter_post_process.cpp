@@ -0,0 +1,22 @@
+#include "filter_post_process.hpp"
+
+#include <algorithm>
+#include <filters.hpp>
+
+
+threaded_post_process_t make_filter_post_process(const FilterSettings& settings) {
+  if (!settings.enabled) {
+    return {};
+  }
+  return [parameters = settings.parameters](std::span<float> field, int w, int h, const std::function<bool(float)>& progress) {
+    if (!progress(0.0f)) {
+      return;
+    }
+    apply_filters(parameters, field, w, h);
+    // sharpening overshoots the range of the colors
+    for (float& value : field) {
+      value = std::clamp(value, 0.0f, 1.0f);
+    }
+    progress(1.0f);
+  };
+}
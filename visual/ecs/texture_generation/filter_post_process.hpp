@@ -0,0 +1,9 @@
+#pragma once
+
+#include "threaded_generation.hpp"
+
+#include <gui/menu.hpp>
+
+
+// Filters the generated field, empty when the filters are disabled
+threaded_post_process_t make_filter_post_process(const FilterSettings& settings);
@@ -0,0 +1,66 @@
+#include "fractal_generation.hpp"
+#include "threaded_generation.hpp"
+#include "erosion_post_process.hpp"
+#include "filter_post_process.hpp"
+
+#include <array>
+#include <ctime>
+#include <memory>
+#include <random>
+#include <span>
+#include <fractal.hpp>
+#include <render/noise_texture.hpp>
+#include <render/drawable_bitmap.hpp>
+
+using real_clock_t = std::chrono::steady_clock;
+using fractal_noise_holder_t = std::unique_ptr<FractalNoise>;
+
+
+void generate_fractal_noise_texture(flecs::world& ecs, const Menu::EventGenerateFractalNoiseTexture& event) {
+  auto textureEntity = ecs.entity()
+    .emplace<NoiseTexture>(event.size[0], event.size[1])
+    .emplace<DrawableBitmap>(
+      Bitmap(event.size[0], event.size[1]),
+      vec2{0.0f, 0.0f}
+     );
+
+  auto seed = [&]{
+    if (event.random_seed <= 0) {
+      std::random_device dev{};
+      return dev();
+    } else {
+      return static_cast<unsigned int>(event.random_seed);
+    }
+  }();
+
+  auto startTime = std::clock();
+  auto realStartTime = real_clock_t::now();
+
+  auto noise = std::make_unique<FractalNoise>(FractalNoiseParameters{
+    .grid_step_x = event.grid_step[0],
+    .grid_step_y = event.grid_step[1],
+
+    .offset_x = event.offset[0],
+    .offset_y = event.offset[1],
+
+    .octaves = event.octaves,
+    .lacunarity = event.lacunarity,
+    .gain = event.gain,
+    .basis = event.basis,
+    .variant = event.variant
+  }, seed);
+
+  start_threaded_generation(ecs, ThreadedGenerationParams{
+    .texture = textureEntity,
+    .texture_width = event.size[0],
+    .fill = [noisePtr = noise.get()](std::span<float> out, int x0, int y0, int w, int h, size_t stride) {
+      noisePtr->fill(out, x0, y0, w, h, stride);
+    },
+    .post_process = chain_post_processes(make_erosion_post_process(event.erosion, seed), make_filter_post_process(event.filters), s_erosion_progress_share),
+    .color0 = std::to_array(event.color0),
+    .color1 = std::to_array(event.color1),
+    .time_spent = std::clock() - startTime,
+    .real_time_spent = real_clock_t::now() - realStartTime
+  });
+  textureEntity.set<fractal_noise_holder_t>(std::move(noise));
+}
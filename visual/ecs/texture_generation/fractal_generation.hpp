@@ -0,0 +1,7 @@
+#pragma once
+
+#include <flecs_incl.hpp>
+#include <gui/menu.hpp>
+
+
+void generate_fractal_noise_texture(flecs::world&, const Menu::EventGenerateFractalNoiseTexture& event);
@@ -5,6 +5,8 @@
 #include <render/noise_texture.hpp>
 #include <render/drawable_bitmap.hpp>
 #include <utility>
+#include <vector>
+#include <span>
 #include <chrono>
 #include <log.hpp>
 
@@ -65,6 +67,11 @@ void init_interpolated_generation_systems(flecs::world& ecs) {
     .event<Menu::EventHideInterpTruePixels>()
     .event<Menu::EventGenerateWhiteNoiseTexture>()
     .event<Menu::EventGeneratePerlinNoiseTexture>()
+    .event<Menu::EventGenerateSimplexNoiseTexture>()
+    .event<Menu::EventGenerateFractalNoiseTexture>()
+    .event<Menu::EventGenerateWorleyNoiseTexture>()
+    .event<Menu::EventGenerateSpectralNoiseTexture>()
+    .event<Menu::EventGenerateBlueNoiseTexture>()
     .each([](flecs::iter& it, size_t, Menu::EventReceiver){
       auto world = it.world();
       clear_true_pixels(world);
@@ -149,7 +156,7 @@ static ALLEGRO_COLOR nearest_neighboor(int x, int y, int width, int height, cons
   return al_map_rgb_f(neighboor[0], neighboor[1], neighboor[2]);
 }
 
-static interpolation::BicubicCoefficients<vec3> calc_bicubic_coefficients(int left_column, int top_row, int sector_width, int sector_height, const Menu::EventGenerateInterpolatedTexture& event) {
+static interpolation::BicubicCorners<vec3> calc_bicubic_corners(int left_column, int top_row, int sector_width, int sector_height, const Menu::EventGenerateInterpolatedTexture& event) {
   auto idx = [](int x, int y) { return x + y * 4; };
   auto F = [&event, &idx, &left_column, &top_row](int x, int y) -> vec3 {
     const float* ptr = &(event.colors[idx(left_column + x, top_row + y) * 3]);
@@ -169,38 +176,67 @@ static interpolation::BicubicCoefficients<vec3> calc_bicubic_coefficients(int le
       : zeroDerivative;
   };
 
-  return interpolation::calc_bicubic_coefficients(F(0, 0), F(1, 0), F(0, 1), F(1, 1),
-                                                  dFx(0, 0), dFx(1, 0), dFx(0, 1), dFx(1, 1),
-                                                  dFy(0, 0), dFy(1, 0), dFy(0, 1), dFy(1, 1),
-                                                  dFxy(0, 0), dFxy(1, 0), dFxy(0, 1), dFxy(1, 1));
+  return {
+    F(0, 0), F(1, 0), F(0, 1), F(1, 1),
+    dFx(0, 0), dFx(1, 0), dFx(0, 1), dFx(1, 1),
+    dFy(0, 0), dFy(1, 0), dFy(0, 1), dFy(1, 1),
+    dFxy(0, 0), dFxy(1, 0), dFxy(0, 1), dFxy(1, 1)
+  };
 }
 
-static interpolation::BicubicCoefficients<vec3> s_bicubic_coefs[9];
-
-static ALLEGRO_COLOR bicubic_wiki(int x, int y, int width, int height, const Menu::EventGenerateInterpolatedTexture&) {
-  auto [sectorWidth, sectorHeight, sectorLeftColumn, sectorTopRow, dx, dy] = calc_sector_coords(x, y, width, height);
-
-  if (sectorTopRow >= 3) {
-    sectorTopRow = 2;
-    dy = height - 1;
-  }
+// Sector and Hermite weights of a pixel along one axis
+struct BicubicAxisSample {
+  int sector;
+  interpolation::HermiteWeights weights;
+};
 
-  if (sectorLeftColumn >= 3) {
-    sectorLeftColumn = 2;
-    dx = width - 1;
+static BicubicAxisSample calc_bicubic_axis_sample(int pos, int size) {
+  const int sectorSize = size / 3;
+  int sector = pos / sectorSize;
+  int offset = pos - sector * sectorSize;
+  if (sector >= 3) {
+    sector = 2;
+    offset = size - 1;
   }
+  return { sector, interpolation::calc_hermite_weights(float(offset) / float(sectorSize)) };
+}
 
-  const auto& coefs = s_bicubic_coefs[sectorLeftColumn + sectorTopRow * 3];
+// Weights depend on a single coordinate, so they are computed once per column and per row
+static void fill_bicubic(NoiseTexture& texture, const Menu::EventGenerateInterpolatedTexture& event) {
+  const int width = texture.width();
+  const int height = texture.height();
 
-  const float w = float(sectorWidth);
-  const float h = float(sectorHeight);
+  interpolation::BicubicCorners<vec3> corners[9];
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      corners[i + j * 3] = calc_bicubic_corners(i, j, width / 3, height / 3, event);
+    }
+  }
 
-  const float ndx = float(dx) / w;
-  const float ndy = float(dy) / h;
+  std::vector<interpolation::HermiteWeights> columnWeights;
+  int sectorEnds[3] = {};
+  for (int x = 0; x < width; ++x) {
+    const BicubicAxisSample column = calc_bicubic_axis_sample(x, width);
+    columnWeights.push_back(column.weights);
+    sectorEnds[column.sector] = x + 1;
+  }
 
-  vec3 wikiRes = interpolation::bicubic(ndx, ndy, coefs);
+  std::vector<vec3> colors(static_cast<size_t>(width));
+  for (int y = 0; y < height; ++y) {
+    const BicubicAxisSample row = calc_bicubic_axis_sample(y, height);
+    int sectorBegin = 0;
+    for (int sector = 0; sector < 3; ++sector) {
+      const size_t count = size_t(sectorEnds[sector] - sectorBegin);
+      interpolation::bicubic_row(std::span(columnWeights).subspan(size_t(sectorBegin), count), row.weights,
+                                 corners[sector + row.sector * 3], std::span(colors).subspan(size_t(sectorBegin), count));
+      sectorBegin = sectorEnds[sector];
+    }
 
-  return al_map_rgb_f(wikiRes.x, wikiRes.y, wikiRes.z);
+    for (int x = 0; x < width; ++x) {
+      const vec3& color = colors[size_t(x)];
+      texture.set(x, y, al_map_rgb_f(color.x, color.y, color.z));
+    }
+  }
 }
 
 void generate_interpolated_texture(flecs::world& ecs, const Menu::EventGenerateInterpolatedTexture& event) {
@@ -218,12 +254,7 @@ void generate_interpolated_texture(flecs::world& ecs, const Menu::EventGenerateI
   } else if (event.algorithm == Menu::EventGenerateInterpolatedTexture::Algorithm::nearest_neighboor) {
     interpolator = nearest_neighboor;
   } else if (event.algorithm == Menu::EventGenerateInterpolatedTexture::Algorithm::bicubic) {
-    for (int i = 0; i < 3; ++i) {
-      for (int j = 0; j < 3; ++j) {
-        s_bicubic_coefs[i + j * 3] = calc_bicubic_coefficients(i, j, width / 3, height / 3, event);
-      }
-    }
-    interpolator = bicubic_wiki;
+    interpolator = nullptr; // whole rows at once, see fill_bicubic
   } else {
     std::unreachable();
   }
@@ -231,9 +262,13 @@ void generate_interpolated_texture(flecs::world& ecs, const Menu::EventGenerateI
   texture.mark_modified();
   {
   auto bitmapOverride = texture.scoped_write_to_memory_bitmap();
-  for (int x = 0; x < width; ++x) {
-    for (int y = 0; y < height; ++y) {
-      texture.set(x, y, interpolator(x, y, width, height, event));
+  if (interpolator == nullptr) {
+    fill_bicubic(texture, event);
+  } else {
+    for (int x = 0; x < width; ++x) {
+      for (int y = 0; y < height; ++y) {
+        texture.set(x, y, interpolator(x, y, width, height, event));
+      }
     }
   }
   } // end of bitmap override scope
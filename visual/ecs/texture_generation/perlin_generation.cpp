@@ -1,16 +1,23 @@
 #include "perlin_generation.hpp"
+#include "threaded_generation.hpp"
+#include "erosion_post_process.hpp"
+#include "filter_post_process.hpp"
 
 #include <algorithm>
 #include <array>
-#include <atomic>
 #include <cmath>
 #include <ctime>
 #include <limits>
 #include <memory>
-#include <thread>
+#include <optional>
+#include <random>
+#include <span>
 #include <utility>
 #include <perlin.hpp>
-#include <interpolation.hpp>
+#include <warp.hpp>
+#include <white.hpp>
+#include <expression.hpp>
+#include <simd/cpu_features.hpp>
 #include <render/noise_texture.hpp>
 #include <render/drawable_bitmap.hpp>
 #include <ecs/util.hpp>
@@ -18,10 +25,8 @@
 #include <ecs/display_module.hpp>
 #include <log.hpp>
 
-using namespace std::chrono_literals;
 using real_clock_t = std::chrono::steady_clock;
 using perlin_noise_holder_t = std::unique_ptr<PerlinNoise>;
-static constexpr int s_num_threads = 4;
 
 
 struct PerlinGradientsScaler {
@@ -51,36 +56,58 @@ static flecs::query<const PerlinGradientArrow> s_perlin_gradient_arrow_query;
 static flecs::query<const PerlinGradientsScaler> s_perlin_gradient_scaler_query;
 static flecs::query<const DisplayHolder> s_perlin_display_query;
 
-struct ConstSharedContinuationData {
-  std::array<float, 3> color0;
-  std::array<float, 3> color1;
-};
+// PerlinNoise::fill specialized for the noise parameters, chosen once per generation
+static threaded_fill_t select_perlin_fill(const PerlinNoise& noise, std::optional<DomainWarp> warp, const Supersampling& supersampling,
+                                          float dither, uint64_t seed) {
+  return noise.visit_evaluator([&warp, &supersampling, dither, seed](const auto& evaluator) -> threaded_fill_t {
+    if (warp) {
+      return [evaluator, warp = *warp](std::span<float> out, int x0, int y0, int w, int h, size_t stride) {
+        warp.fill(evaluator, out, x0, y0, w, h, stride);
+      };
+    }
+    if (supersampling.samples > 1) {
+      return [evaluator, supersampling](std::span<float> out, int x0, int y0, int w, int h, size_t stride) {
+        evaluator.fill_supersampled(out, x0, y0, w, h, stride, supersampling);
+      };
+    }
+    if (dither > 0.0f) {
+      // the noise and the dither are summed block by block in one pass over the output
+      return [evaluator, white = WhiteNoise(WhiteNoiseParameters{}, seed), dither](std::span<float> out, int x0, int y0, int w, int h, size_t stride) {
+        using namespace noise_expression;
+        clamp(source(evaluator) + (source(white) - 0.5f) * dither).fill(out, x0, y0, w, h, stride);
+      };
+    }
+    return [evaluator](std::span<float> out, int x0, int y0, int w, int h, size_t stride) {
+      evaluator.fill(out, x0, y0, w, h, stride);
+    };
+  });
+}
 
-struct PerlinNoisePerThreadInfo {
-  flecs::entity m_texture;
-  int m_next_x;
-  int m_until_x;
-  const PerlinNoise* m_noise;
-  std::atomic<size_t>* m_threads_finished;
-  std::atomic<bool>* m_need_abort;
-  const ConstSharedContinuationData* m_const_shared_data_ptr;
-};
+// Palette indices straight from PerlinNoise::fill_u8, which uses the fixed-point path when it can.
+// The warp, supersampling, dither, erosion and filters need float samples
+static threaded_fill_u8_t select_perlin_fill_u8(const PerlinNoise& noise, const std::optional<DomainWarp>& warp, const Menu::EventGeneratePerlinNoiseTexture& event) {
+  if (warp || event.supersampling.samples > 1 || event.dither > 0.0f || event.erosion.enabled || event.filters.enabled) {
+    return {};
+  }
+  return [noise = &noise](std::span<uint8_t> out, int x0, int y0, int w, int h, size_t stride) {
+    noise->fill_u8(out, x0, y0, w, h, stride);
+  };
+}
 
-struct PerlinNoiseGenerationContinuation {
-  std::unique_ptr<ConstSharedContinuationData> m_const_shared_data;
-  std::clock_t m_time_spent;
-  real_clock_t::duration m_real_time_spent;
-  PerlinNoise* m_noise;
-  std::unique_ptr<std::atomic<size_t>> m_threads_finished;
-  std::unique_ptr<std::atomic<bool>> m_need_abort;
-  std::vector<std::thread> m_additional_threads;
-  PerlinNoisePerThreadInfo m_main_thread_info;
-  int m_columns_per_thread;
-  int m_texture_width;
-};
+// Exact normals from the derivatives of the noise. Anything that changes the field after the noise
+// makes them come from the finished field instead, see ThreadedGenerationParams::normal_map_height
+static bool uses_analytic_normals(const Menu::EventGeneratePerlinNoiseTexture& event) {
+  return event.warp_levels <= 0 && event.supersampling.samples <= 1 && event.dither <= 0.0f
+    && !event.erosion.enabled && !event.filters.enabled;
+}
 
-static int calc_perlin_thread_finish(int thread_idx, int columns_per_thread, int width) {
-  return thread_idx == s_num_threads - 1 ? width : (thread_idx + 1) * columns_per_thread;
+static threaded_fill_rgba_t select_perlin_fill_rgba(const PerlinNoise& noise, const Menu::EventGeneratePerlinNoiseTexture& event) {
+  if (!event.normal_map || !uses_analytic_normals(event)) {
+    return {};
+  }
+  return [noise = &noise, height = event.normal_map_height](std::span<uint32_t> out, int x0, int y0, int w, int h, size_t stride) {
+    noise->fill_normal_map(out, x0, y0, w, h, stride, height);
+  };
 }
 
 void generate_perlin_noise_texture(flecs::world& ecs, const Menu::EventGeneratePerlinNoiseTexture& event) {
@@ -99,165 +126,55 @@ void generate_perlin_noise_texture(flecs::world& ecs, const Menu::EventGenerateP
       return static_cast<unsigned int>(event.random_seed);
     }
   }();
-  std::default_random_engine eng(seed);
 
   auto startTime = std::clock();
   auto realStartTime = real_clock_t::now();
 
+  // a tileable texture is exactly one period
+  const int periodX = event.tileable ? event.period[0] : 0;
+  const int periodY = event.tileable ? event.period[1] : 0;
   auto noise = std::make_unique<PerlinNoise>(PerlinNoiseParameters{
     .grid_size_x = event.grid_size[0],
     .grid_size_y = event.grid_size[1],
 
-    .grid_step_x = event.grid_step[0],
-    .grid_step_y = event.grid_step[1],
+    .grid_step_x = event.tileable ? float(event.size[0]) / float(periodX) : event.grid_step[0],
+    .grid_step_y = event.tileable ? float(event.size[1]) / float(periodY) : event.grid_step[1],
 
     .offset_x = event.offset[0],
     .offset_y = event.offset[1],
 
     .normalize_offsets = event.normalize_offsets,
-    .interpolation_algorithm = event.interpolation_algorithm
-  }, eng);
-
-  PerlinNoiseGenerationContinuation continuation{
-    .m_const_shared_data = std::unique_ptr<ConstSharedContinuationData>(new ConstSharedContinuationData{
-      .color0 = std::to_array(event.color0),
-      .color1 = std::to_array(event.color1),
-    }),
-    .m_time_spent = 0,
-    .m_real_time_spent = {},
-    .m_noise = noise.get(),
-    .m_threads_finished = std::make_unique<std::atomic<size_t>>(0),
-    .m_need_abort = std::make_unique<std::atomic<bool>>(false),
-    .m_additional_threads = {},
-    .m_main_thread_info = {
-      .m_texture = textureEntity,
-      .m_next_x = 0,
-      .m_until_x = 0,
-      .m_noise = noise.get(),
-      .m_threads_finished = nullptr,
-      .m_need_abort = nullptr,
-      .m_const_shared_data_ptr = nullptr
-    },
-    .m_columns_per_thread = event.size[0] / s_num_threads,
-    .m_texture_width = event.size[0],
-  };
-  continuation.m_main_thread_info.m_threads_finished = continuation.m_threads_finished.get();
-  continuation.m_main_thread_info.m_need_abort = continuation.m_need_abort.get();
-  continuation.m_main_thread_info.m_const_shared_data_ptr = continuation.m_const_shared_data.get();
-
-  continuation.m_time_spent = std::clock() - startTime;
-  continuation.m_real_time_spent = real_clock_t::now() - realStartTime;
-
-  continuation.m_main_thread_info.m_until_x = calc_perlin_thread_finish(0, continuation.m_columns_per_thread, continuation.m_texture_width);
-  info("main thread will work from {} to {}", continuation.m_main_thread_info.m_next_x, continuation.m_main_thread_info.m_until_x);
-  
-  ecs.entity().emplace<PerlinNoiseGenerationContinuation>(std::move(continuation));
-  textureEntity.set<perlin_noise_holder_t>(std::move(noise));
-}
-
-
-static void do_perlin_generation(PerlinNoisePerThreadInfo& info, auto continueCallback) {
-  NoiseTexture* ptr = info.m_texture.try_get_mut<NoiseTexture>();
-  if (ptr == nullptr) {
-    return;
-  }
-  NoiseTexture& texture = *ptr;
-  std::shared_lock lock(*texture.m_memory_bitmap_mutex);
-  auto height = texture.height();
-
-  const auto& color0 = info.m_const_shared_data_ptr->color0;
-  const auto& color1 = info.m_const_shared_data_ptr->color1;
-
-  auto bitmapOverride = texture.scoped_write_to_memory_bitmap();
-  for (int& x = info.m_next_x; x < info.m_until_x; ++x) {
-    for (int y = 0; y < height; ++y) {
-      float value = (*info.m_noise)(float(x), float(y));
-
-      float r = interpolation::lerp(color0[0], color1[0], value);
-      float g = interpolation::lerp(color0[1], color1[1], value);
-      float b = interpolation::lerp(color0[2], color1[2], value);
-
-      texture.set(x, y, al_map_rgb_f(r, g, b));
-    }
-
-    if (!continueCallback()) {
-      return;
-    }
-  }
-}
-
-static void additional_thread_perlin_func(PerlinNoisePerThreadInfo thread_info) {
-  while (thread_info.m_next_x < thread_info.m_until_x) {
-    const auto& texture = thread_info.m_texture.get<NoiseTexture>();
-    texture.m_prepearing_for_draw->wait(true);
-
-    bool needAbort = false;
-    do_perlin_generation(thread_info, [&] {
-      needAbort = thread_info.m_need_abort->load();
-      return !needAbort && !(texture.m_prepearing_for_draw->load());
-    });
-    if (needAbort) {
-      info("thread aborted ({}/{})", thread_info.m_next_x, thread_info.m_until_x);
-      return;
-    }
-    info("thread pausing ({}/{})", thread_info.m_next_x, thread_info.m_until_x);
-  }
-  info("thread finished work (until {})", thread_info.m_until_x);
-  thread_info.m_threads_finished->fetch_add(1);
-}
-
-static void init_perlin_noise_generation_threads(PerlinNoiseGenerationContinuation& continuation) {
-  continuation.m_additional_threads.reserve(s_num_threads - 1);
-  info("initializing threads. {} {}", continuation.m_columns_per_thread, continuation.m_texture_width);
-  for (int i = 1; i < s_num_threads; ++i) { // first thread is the main thread
-    PerlinNoisePerThreadInfo newThreadInfo {
-      .m_texture = continuation.m_main_thread_info.m_texture,
-      .m_next_x = i * continuation.m_columns_per_thread,
-      .m_until_x = calc_perlin_thread_finish(i, continuation.m_columns_per_thread, continuation.m_texture_width),
-      .m_noise = continuation.m_noise,
-      .m_threads_finished = continuation.m_threads_finished.get(),
-      .m_need_abort = continuation.m_need_abort.get(),
-      .m_const_shared_data_ptr = continuation.m_const_shared_data.get()
-    };
-    info("creating thread {}. Will work from {} to {}", i, newThreadInfo.m_next_x, newThreadInfo.m_until_x);
-    continuation.m_additional_threads.emplace_back(additional_thread_perlin_func, newThreadInfo);
-  }
-}
-
-static bool continue_perlin_noise_generation(PerlinNoiseGenerationContinuation& continuation, std::chrono::milliseconds time_budget) {
-  auto startTime = std::clock(); // processor time
-  auto startRealTime = real_clock_t::now();
-
-  NoiseTexture& texture = continuation.m_main_thread_info.m_texture.get_mut<NoiseTexture>();
-  texture.mark_modified();
-  
-  if (continuation.m_main_thread_info.m_next_x == continuation.m_main_thread_info.m_until_x) {
-    // main thread finished
-    std::this_thread::sleep_for(time_budget);
-  } else {
-    do_perlin_generation(continuation.m_main_thread_info, [&]{ 
-      auto curRealTimeSpent = real_clock_t::now() - startRealTime;
-      return curRealTimeSpent < time_budget;
-    });
+    .interpolation_algorithm = event.interpolation_algorithm,
+    .gradient_source = event.gradient_source,
+    .period_x = periodX,
+    .period_y = periodY
+  }, seed);
+  info("perlin generation uses {} kernels", simd::level_name(simd::detected_level()));
+
+  std::optional<DomainWarp> warp;
+  if (event.warp_levels > 0) {
+    warp.emplace(DomainWarpParameters{
+      .grid_step_x = event.warp_grid_step[0],
+      .grid_step_y = event.warp_grid_step[1],
+      .strength = event.warp_strength,
+      .levels = event.warp_levels
+    }, seed);
   }
 
-  info("pausing generation. Spent {}ms. {} threads finished, main finished - {}",
-    std::chrono::duration_cast<std::chrono::milliseconds>(real_clock_t::now() - startRealTime).count(),
-    continuation.m_threads_finished->load(),
-    continuation.m_main_thread_info.m_next_x == continuation.m_main_thread_info.m_until_x);
-
-  continuation.m_time_spent += std::clock() - startTime;
-  continuation.m_real_time_spent += real_clock_t::now() - startRealTime;
-  
-  auto allThreadsFinished = continuation.m_threads_finished->load() == continuation.m_additional_threads.size()
-                            && continuation.m_main_thread_info.m_next_x == continuation.m_main_thread_info.m_until_x;
-  if (allThreadsFinished) {
-    for (auto& t : continuation.m_additional_threads) {
-      t.join();
-    }
-  }
-
-  return allThreadsFinished;
+  start_threaded_generation(ecs, ThreadedGenerationParams{
+    .texture = textureEntity,
+    .texture_width = event.size[0],
+    .fill = select_perlin_fill(*noise, warp, event.supersampling, event.dither, seed),
+    .fill_u8 = select_perlin_fill_u8(*noise, warp, event),
+    .fill_rgba = select_perlin_fill_rgba(*noise, event),
+    .post_process = chain_post_processes(make_erosion_post_process(event.erosion, seed), make_filter_post_process(event.filters), s_erosion_progress_share),
+    .normal_map_height = event.normal_map && !uses_analytic_normals(event) ? std::optional(event.normal_map_height) : std::nullopt,
+    .color0 = std::to_array(event.color0),
+    .color1 = std::to_array(event.color1),
+    .time_spent = std::clock() - startTime,
+    .real_time_spent = real_clock_t::now() - realStartTime
+  });
+  textureEntity.set<perlin_noise_holder_t>(std::move(noise));
 }
 
 static void clear_gradient_visualization(flecs::world& ecs) {
@@ -302,29 +219,6 @@ static Bitmap create_gradient_arrow_sprite(int texSide, float lineLength, float
 }
 
 void init_perlin_systems_generation_systems(flecs::world& ecs) {
-  ecs.system<PerlinNoiseGenerationContinuation>("Perlin noise generation")
-    .kind(flecs::OnUpdate)
-    .each([](const flecs::iter& it, size_t entity_index, PerlinNoiseGenerationContinuation& continuation) {
-      auto ecs = it.world();
-
-      if (continuation.m_additional_threads.empty())
-        init_perlin_noise_generation_threads(continuation);
-
-      bool didFinish = continue_perlin_noise_generation(continuation, 25ms);
-      if (didFinish) {
-        ecs.each([&ecs, &continuation](flecs::entity entity, Menu::EventReceiver){
-          ecs.event<Menu::EventGenerationFinished>()
-            .ctx(Menu::EventGenerationFinished{
-              .secondsTaken = double(continuation.m_time_spent) / double(CLOCKS_PER_SEC),
-              .realDuration = continuation.m_real_time_spent,
-            })
-            .entity(entity)
-            .emit();
-        });
-        it.entity(entity_index).destruct();
-      }
-    });
-
   s_perlin_gradient_sprite_query = ecs.query<PerlinGradientSprite>();
   s_perlin_gradient_arrow_query = ecs.query<const PerlinGradientArrow>();
   s_perlin_gradient_scaler_query = ecs.query<const PerlinGradientsScaler>();
@@ -344,7 +238,10 @@ void init_perlin_systems_generation_systems(flecs::world& ecs) {
         const float width = 3.0f;
 
         auto& params = noise->m_parameters;
-	if (params.grid_size_y * params.grid_size_x <= 0) {
+        // unbounded noise has no grid, show the nodes the texture covers
+        const int nodesX = noise->is_unbounded() ? int(float(bitmap.bitmap.width()) / params.grid_step_x) + 2 : params.grid_size_x;
+        const int nodesY = noise->is_unbounded() ? int(float(bitmap.bitmap.height()) / params.grid_step_y) + 2 : params.grid_size_y;
+	if (nodesY * nodesX <= 0) {
           return;
 	}
         maxAllowedZoom = std::min(
@@ -360,13 +257,13 @@ void init_perlin_systems_generation_systems(flecs::world& ecs) {
           .y = bitmap.bitmap.height()
         });
         vec2 offset = bitmap.center - textureSize / 2.0f;
-        for (int i = 0; i < params.grid_size_y; ++i) {
-          for (int j = 0; j < params.grid_size_x; ++j) {
+        for (int i = 0; i < nodesY; ++i) {
+          for (int j = 0; j < nodesX; ++j) {
             const vec2 texturePosition = vec2{
               .x = float(j) * params.grid_step_x,
               .y = float(i) * params.grid_step_y,
             } + offset;
-            const float* gridNodeData = noise->get_grid_node_data(j, i);
+            const float* gridNodeData = noise->gradient(j, i);
             vec2 textureDirection = {gridNodeData[0], gridNodeData[1]};
             const float directionLength = textureDirection.length();
             if (directionLength <= std::numeric_limits<float>::epsilon()) {
@@ -389,6 +286,11 @@ void init_perlin_systems_generation_systems(flecs::world& ecs) {
     .event<Menu::EventHidePerlinGradients>()
     .event<Menu::EventGenerateWhiteNoiseTexture>()
     .event<Menu::EventGenerateInterpolatedTexture>()
+    .event<Menu::EventGenerateSimplexNoiseTexture>()
+    .event<Menu::EventGenerateFractalNoiseTexture>()
+    .event<Menu::EventGenerateWorleyNoiseTexture>()
+    .event<Menu::EventGenerateSpectralNoiseTexture>()
+    .event<Menu::EventGenerateBlueNoiseTexture>()
     .each([](flecs::iter& it, size_t, Menu::EventReceiver){
       auto world = it.world();
       clear_gradient_visualization(world);
@@ -451,15 +353,3 @@ void init_perlin_systems_generation_systems(flecs::world& ecs) {
       });
     });
 }
-
-void clear_perlin_noise_continuation(flecs::world& ecs) {
-  ecs.each([](flecs::entity entity, PerlinNoiseGenerationContinuation& continuation){
-    continuation.m_need_abort->store(true);
-    for (auto& thread : continuation.m_additional_threads) {
-      if (thread.joinable()) {
-        thread.join();
-      }
-    }
-    entity.destruct();
-  });
-}
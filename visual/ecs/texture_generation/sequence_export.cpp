@@ -0,0 +1,96 @@
+#include "sequence_export.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <span>
+#include <string>
+#include <thread>
+#include <utility>
+#include <sequence.hpp>
+#include <log.hpp>
+
+using real_clock_t = std::chrono::steady_clock;
+// float frames being generated at once take at most this much, one 10000 x 10000 frame is 400MB
+static constexpr size_t s_frames_memory_budget = size_t(1) << 30;
+static constexpr int s_max_frames_in_flight = 8;
+
+
+struct SequenceExport {
+  std::jthread thread; // stop is requested when the world is destroyed
+  std::shared_ptr<std::atomic<bool>> finished;
+};
+
+static void run_export(const Menu::EventExportNoiseSequence& event, unsigned int seed, std::stop_token stop) {
+  auto startTime = real_clock_t::now();
+  const int width = event.size[0];
+  const int height = event.size[1];
+  const size_t frameBytes = size_t(width) * size_t(height) * sizeof(float);
+  const int maxFramesInFlight = int(std::clamp(s_frames_memory_budget / std::max(frameBytes, size_t(1)), size_t(1), size_t(s_max_frames_in_flight)));
+
+  auto fill = make_animated_noise_fill(AnimatedNoiseParameters{
+    .grid_step_x = event.grid_step[0],
+    .grid_step_y = event.grid_step[1],
+    .time_step = event.time_step,
+    .loop_frames = event.loop ? event.frame_count : 0
+  }, seed);
+
+  std::ofstream stream;
+  sequence_writer_t writer;
+  const std::string pgmExtension = ".pgm";
+  if (event.path.ends_with(pgmExtension)) {
+    // name.pgm -> name_00000.pgm, name_00001.pgm, ...
+    writer = make_pgm_writer(event.path.substr(0, event.path.size() - pgmExtension.size()) + "_", width, height);
+  } else {
+    stream.open(event.path, std::ios::binary);
+    writer = make_y4m_writer(stream, width, height, event.fps);
+  }
+
+  bool completed = generate_sequence(SequenceParameters{
+    .width = width,
+    .height = height,
+    .frame_count = event.frame_count,
+    .max_frames_in_flight = maxFramesInFlight
+  }, fill, [&](int frame, std::span<const uint8_t> pixels) {
+    return !stop.stop_requested() && writer(frame, pixels);
+  });
+
+  auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(real_clock_t::now() - startTime);
+  if (completed) {
+    info("exported {} frames to \"{}\" in {}ms", event.frame_count, event.path, duration.count());
+  } else {
+    error("sequence export to \"{}\" stopped after {}ms", event.path, duration.count());
+  }
+}
+
+void export_noise_sequence(flecs::world& ecs, const Menu::EventExportNoiseSequence& event) {
+  auto seed = [&]{
+    if (event.random_seed <= 0) {
+      std::random_device dev{};
+      return dev();
+    } else {
+      return static_cast<unsigned int>(event.random_seed);
+    }
+  }();
+
+  auto finished = std::make_shared<std::atomic<bool>>(false);
+  std::jthread thread([event, seed, finished](std::stop_token stop) {
+    run_export(event, seed, stop);
+    finished->store(true);
+  });
+  ecs.entity().emplace<SequenceExport>(std::move(thread), std::move(finished));
+}
+
+void init_sequence_export_systems(flecs::world& ecs) {
+  ecs.system<SequenceExport>("Sequence export")
+    .kind(flecs::OnUpdate)
+    .each([](flecs::entity entity, SequenceExport& sequenceExport) {
+      if (sequenceExport.finished->load()) {
+        sequenceExport.thread.join();
+        entity.destruct();
+      }
+    });
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <flecs_incl.hpp>
+#include <gui/menu.hpp>
+
+
+// Runs in a background thread, the texture on screen is not touched
+void export_noise_sequence(flecs::world&, const Menu::EventExportNoiseSequence& event);
+void init_sequence_export_systems(flecs::world&);
@@ -0,0 +1,66 @@
+#include "spectral_generation.hpp"
+#include "threaded_generation.hpp"
+#include "filter_post_process.hpp"
+
+#include <array>
+#include <ctime>
+#include <memory>
+#include <optional>
+#include <random>
+#include <span>
+#include <spectral.hpp>
+#include <render/noise_texture.hpp>
+#include <render/drawable_bitmap.hpp>
+
+using real_clock_t = std::chrono::steady_clock;
+// empty until the generation thread made the noise
+using spectral_noise_holder_t = std::unique_ptr<std::optional<SpectralNoise>>;
+
+
+void generate_spectral_noise_texture(flecs::world& ecs, const Menu::EventGenerateSpectralNoiseTexture& event) {
+  auto textureEntity = ecs.entity()
+    .emplace<NoiseTexture>(event.size[0], event.size[1])
+    .emplace<DrawableBitmap>(
+      Bitmap(event.size[0], event.size[1]),
+      vec2{0.0f, 0.0f}
+     );
+
+  auto seed = [&]{
+    if (event.random_seed <= 0) {
+      std::random_device dev{};
+      return dev();
+    } else {
+      return static_cast<unsigned int>(event.random_seed);
+    }
+  }();
+
+  auto startTime = std::clock();
+  auto realStartTime = real_clock_t::now();
+
+  auto noise = std::make_unique<std::optional<SpectralNoise>>();
+  const SpectralNoiseParameters parameters{
+    .size_x = event.size[0],
+    .size_y = event.size[1],
+    .exponent = event.exponent,
+    .min_wavelength = event.min_wavelength,
+    .max_wavelength = event.max_wavelength
+  };
+
+  start_threaded_generation(ecs, ThreadedGenerationParams{
+    .texture = textureEntity,
+    .texture_width = event.size[0],
+    .fill = [noisePtr = noise.get()](std::span<float> out, int x0, int y0, int w, int h, size_t stride) {
+      (*noisePtr)->fill(out, x0, y0, w, h, stride);
+    },
+    // the whole field is made by the inverse FFT, the fills only copy it
+    .prepare = [noisePtr = noise.get(), parameters, seed](const std::function<bool(float)>&) {
+      noisePtr->emplace(parameters, seed);
+    },
+    .post_process = make_filter_post_process(event.filters),
+    .color0 = std::to_array(event.color0),
+    .color1 = std::to_array(event.color1),
+    .time_spent = std::clock() - startTime,
+    .real_time_spent = real_clock_t::now() - realStartTime
+  });
+  textureEntity.set<spectral_noise_holder_t>(std::move(noise));
+}
@@ -0,0 +1,418 @@
+#include "threaded_generation.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <utility>
+#include <interpolation.hpp>
+#include <normal_map.hpp>
+#include <render/noise_texture.hpp>
+#include <gui/menu.hpp>
+#include <log.hpp>
+
+using namespace std::chrono_literals;
+using real_clock_t = std::chrono::steady_clock;
+static constexpr int s_num_threads = 4;
+static constexpr int s_columns_per_batch = 8; // columns filled by one fill call
+static constexpr int s_rgba_columns_per_batch = 64; // fill_rgba rows are copied whole into the bitmap
+static constexpr float s_prepare_progress_share = 0.5f; // when there is a post process too
+
+
+struct ConstSharedContinuationData {
+  threaded_fill_t fill;
+  threaded_fill_u8_t fill_u8;
+  threaded_fill_rgba_t fill_rgba;
+  std::array<float, 3> color0;
+  std::array<float, 3> color1;
+  std::array<ALLEGRO_COLOR, 256> palette;
+};
+
+static std::array<ALLEGRO_COLOR, 256> make_palette(const std::array<float, 3>& color0, const std::array<float, 3>& color1) {
+  std::array<ALLEGRO_COLOR, 256> palette;
+  for (size_t i = 0; i < palette.size(); ++i) {
+    const float value = float(i) / 255.0f;
+    palette[i] = al_map_rgb_f(
+      interpolation::lerp(color0[0], color1[0], value),
+      interpolation::lerp(color0[1], color1[1], value),
+      interpolation::lerp(color0[2], color1[2], value));
+  }
+  return palette;
+}
+
+struct GenerationPerThreadInfo {
+  flecs::entity m_texture;
+  int m_next_x;
+  int m_until_x;
+  std::atomic<size_t>* m_threads_finished;
+  std::atomic<bool>* m_need_abort;
+  const ConstSharedContinuationData* m_const_shared_data_ptr;
+};
+
+struct GenerationContinuation {
+  std::unique_ptr<ConstSharedContinuationData> m_const_shared_data;
+  std::clock_t m_time_spent;
+  real_clock_t::duration m_real_time_spent;
+  std::unique_ptr<std::atomic<size_t>> m_threads_finished;
+  std::unique_ptr<std::atomic<bool>> m_need_abort;
+  std::vector<std::thread> m_additional_threads;
+  GenerationPerThreadInfo m_main_thread_info;
+  int m_columns_per_thread;
+  int m_texture_width;
+
+  // filled and post processed field the fill copies from, only with a post process or a normal map
+  std::unique_ptr<std::vector<float>> m_field;
+  // prepares and post processes
+  std::thread m_post_process_thread;
+  std::unique_ptr<std::atomic<float>> m_post_process_progress;
+  std::unique_ptr<std::atomic<bool>> m_post_process_finished;
+  std::clock_t m_post_process_start_time = 0;
+  real_clock_t::time_point m_post_process_real_start_time;
+};
+
+static int calc_thread_finish(int thread_idx, int columns_per_thread, int width) {
+  return thread_idx == s_num_threads - 1 ? width : (thread_idx + 1) * columns_per_thread;
+}
+
+// Runs the prepare and then fills the whole field in bands of rows and post processes it on a separate thread.
+// The drawing threads start when it is finished, then they only copy the field or take its normals
+static void start_post_process(GenerationContinuation& continuation, threaded_prepare_t&& prepare, threaded_post_process_t&& post_process,
+                               std::optional<float> normal_map_height) {
+  const int width = continuation.m_texture_width;
+  const int height = continuation.m_main_thread_info.m_texture.get_mut<NoiseTexture>().height();
+  continuation.m_post_process_progress = std::make_unique<std::atomic<float>>(0.0f);
+  continuation.m_post_process_finished = std::make_unique<std::atomic<bool>>(false);
+  continuation.m_post_process_start_time = std::clock();
+  continuation.m_post_process_real_start_time = real_clock_t::now();
+
+  threaded_fill_t fill;
+  if (post_process || normal_map_height) {
+    continuation.m_field = std::make_unique<std::vector<float>>(size_t(width) * size_t(height));
+    auto& sharedData = *continuation.m_const_shared_data;
+    fill = std::move(sharedData.fill);
+    if (normal_map_height) {
+      sharedData.fill = {};
+      sharedData.fill_rgba = [field = continuation.m_field.get(), width, height, scale = *normal_map_height](
+          std::span<uint32_t> out, int x0, int y0, int w, int h, size_t stride) {
+        fill_normal_map_from_field(*field, width, height, scale, out, x0, y0, w, h, stride);
+      };
+    } else {
+      sharedData.fill = [field = continuation.m_field.get(), width](std::span<float> out, int x0, int y0, int w, int h, size_t stride) {
+        for (int j = 0; j < h; ++j) {
+          std::copy_n(field->data() + size_t(y0 + j) * size_t(width) + size_t(x0), w, out.data() + size_t(j) * stride);
+        }
+      };
+    }
+  }
+
+  continuation.m_post_process_thread = std::thread([
+    prepare = std::move(prepare),
+    fill = std::move(fill),
+    postProcess = std::move(post_process),
+    field = continuation.m_field.get(),
+    width,
+    height,
+    progress = continuation.m_post_process_progress.get(),
+    finished = continuation.m_post_process_finished.get(),
+    needAbort = continuation.m_need_abort.get()
+  ] {
+    const float prepareShare = prepare && postProcess ? s_prepare_progress_share : (prepare ? 1.0f : 0.0f);
+    if (prepare) {
+      prepare([progress, needAbort, prepareShare](float done) {
+        progress->store(done * prepareShare);
+        return !needAbort->load();
+      });
+    }
+    if (!fill || needAbort->load()) {
+      finished->store(true);
+      return;
+    }
+
+    auto fillRows = [&](int begin, int end) {
+      const size_t offset = size_t(begin) * size_t(width);
+      fill(std::span(*field).subspan(offset, size_t(end - begin) * size_t(width)), 0, begin, width, end - begin, size_t(width));
+    };
+    const int threadsCount = std::clamp(height, 1, s_num_threads);
+    const int rowsPerThread = (height + threadsCount - 1) / threadsCount;
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threadsCount; ++i) {
+      workers.emplace_back(fillRows, std::min(height, i * rowsPerThread), std::min(height, (i + 1) * rowsPerThread));
+    }
+    fillRows(0, std::min(height, rowsPerThread));
+    for (auto& worker : workers) {
+      worker.join();
+    }
+
+    if (postProcess) {
+      postProcess(*field, width, height, [progress, needAbort, prepareShare](float done) {
+        progress->store(prepareShare + done * (1.0f - prepareShare));
+        return !needAbort->load();
+      });
+    }
+    finished->store(true);
+  });
+}
+
+static void finish_post_process(GenerationContinuation& continuation) {
+  continuation.m_post_process_thread.join();
+  continuation.m_time_spent += std::clock() - continuation.m_post_process_start_time;
+  continuation.m_real_time_spent += real_clock_t::now() - continuation.m_post_process_real_start_time;
+  info("post process finished");
+}
+
+threaded_post_process_t chain_post_processes(threaded_post_process_t first, threaded_post_process_t second, float first_share) {
+  if (!first || !second) {
+    return first ? std::move(first) : std::move(second);
+  }
+  return [first = std::move(first), second = std::move(second), first_share](std::span<float> field, int w, int h, const std::function<bool(float)>& progress) {
+    bool aborted = false;
+    first(field, w, h, [&](float done) {
+      aborted = !progress(done * first_share);
+      return !aborted;
+    });
+    if (!aborted) {
+      second(field, w, h, [&](float done) {
+        return progress(first_share + done * (1.0f - first_share));
+      });
+    }
+  };
+}
+
+void start_threaded_generation(flecs::world& ecs, ThreadedGenerationParams&& params) {
+  GenerationContinuation continuation{
+    .m_const_shared_data = std::unique_ptr<ConstSharedContinuationData>(new ConstSharedContinuationData{
+      .fill = std::move(params.fill),
+      .fill_u8 = std::move(params.fill_u8),
+      .fill_rgba = std::move(params.fill_rgba),
+      .color0 = params.color0,
+      .color1 = params.color1,
+      .palette = make_palette(params.color0, params.color1),
+    }),
+    .m_time_spent = params.time_spent,
+    .m_real_time_spent = params.real_time_spent,
+    .m_threads_finished = std::make_unique<std::atomic<size_t>>(0),
+    .m_need_abort = std::make_unique<std::atomic<bool>>(false),
+    .m_additional_threads = {},
+    .m_main_thread_info = {
+      .m_texture = params.texture,
+      .m_next_x = 0,
+      .m_until_x = 0,
+      .m_threads_finished = nullptr,
+      .m_need_abort = nullptr,
+      .m_const_shared_data_ptr = nullptr
+    },
+    .m_columns_per_thread = params.texture_width / s_num_threads,
+    .m_texture_width = params.texture_width,
+  };
+  continuation.m_main_thread_info.m_threads_finished = continuation.m_threads_finished.get();
+  continuation.m_main_thread_info.m_need_abort = continuation.m_need_abort.get();
+  continuation.m_main_thread_info.m_const_shared_data_ptr = continuation.m_const_shared_data.get();
+
+  continuation.m_main_thread_info.m_until_x = calc_thread_finish(0, continuation.m_columns_per_thread, continuation.m_texture_width);
+  info("main thread will work from {} to {}", continuation.m_main_thread_info.m_next_x, continuation.m_main_thread_info.m_until_x);
+
+  const auto& sharedData = *continuation.m_const_shared_data;
+  if (!sharedData.fill || sharedData.fill_u8 || sharedData.fill_rgba) {
+    params.post_process = {};
+    params.normal_map_height.reset();
+  }
+  if (params.prepare || params.post_process || params.normal_map_height) {
+    start_post_process(continuation, std::move(params.prepare), std::move(params.post_process), params.normal_map_height);
+  }
+
+  ecs.entity().emplace<GenerationContinuation>(std::move(continuation));
+}
+
+static void do_generation(GenerationPerThreadInfo& info, auto continueCallback) {
+  NoiseTexture* ptr = info.m_texture.try_get_mut<NoiseTexture>();
+  if (ptr == nullptr) {
+    return;
+  }
+  NoiseTexture& texture = *ptr;
+  std::shared_lock lock(*texture.m_memory_bitmap_mutex);
+  auto height = texture.height();
+
+  const auto& fill = info.m_const_shared_data_ptr->fill;
+  const auto& fillU8 = info.m_const_shared_data_ptr->fill_u8;
+  const auto& fillRgba = info.m_const_shared_data_ptr->fill_rgba;
+  const auto& color0 = info.m_const_shared_data_ptr->color0;
+  const auto& color1 = info.m_const_shared_data_ptr->color1;
+  const auto& palette = info.m_const_shared_data_ptr->palette;
+
+  std::vector<float> values;
+  std::vector<uint8_t> bytes;
+  std::vector<uint32_t> pixels;
+  const int columnsPerBatch = fillRgba ? s_rgba_columns_per_batch : s_columns_per_batch;
+  if (fillRgba) {
+    pixels.resize(size_t(columnsPerBatch) * size_t(height));
+  } else if (fillU8) {
+    bytes.resize(size_t(columnsPerBatch) * size_t(height));
+  } else {
+    values.resize(size_t(columnsPerBatch) * size_t(height));
+  }
+
+  auto bitmapOverride = texture.scoped_write_to_memory_bitmap();
+  for (int& x = info.m_next_x; x < info.m_until_x;) {
+    const int batchWidth = std::min(columnsPerBatch, info.m_until_x - x);
+    if (fillRgba) {
+      fillRgba(pixels, x, 0, batchWidth, height, size_t(batchWidth));
+      texture.set_rgba(x, 0, batchWidth, height, pixels, size_t(batchWidth));
+    } else if (fillU8) {
+      fillU8(bytes, x, 0, batchWidth, height, size_t(batchWidth));
+      for (int y = 0; y < height; ++y) {
+        const uint8_t* row = &bytes[size_t(y) * size_t(batchWidth)];
+        for (int i = 0; i < batchWidth; ++i) {
+          texture.set(x + i, y, palette[row[i]]);
+        }
+      }
+    } else {
+      fill(values, x, 0, batchWidth, height, size_t(batchWidth));
+
+      for (int y = 0; y < height; ++y) {
+        const float* row = &values[size_t(y) * size_t(batchWidth)];
+        for (int i = 0; i < batchWidth; ++i) {
+          float value = row[i];
+
+          float r = interpolation::lerp(color0[0], color1[0], value);
+          float g = interpolation::lerp(color0[1], color1[1], value);
+          float b = interpolation::lerp(color0[2], color1[2], value);
+
+          texture.set(x + i, y, al_map_rgb_f(r, g, b));
+        }
+      }
+    }
+    x += batchWidth;
+
+    if (!continueCallback()) {
+      return;
+    }
+  }
+}
+
+static void additional_thread_func(GenerationPerThreadInfo thread_info) {
+  while (thread_info.m_next_x < thread_info.m_until_x) {
+    const auto& texture = thread_info.m_texture.get<NoiseTexture>();
+    texture.m_prepearing_for_draw->wait(true);
+
+    bool needAbort = false;
+    do_generation(thread_info, [&] {
+      needAbort = thread_info.m_need_abort->load();
+      return !needAbort && !(texture.m_prepearing_for_draw->load());
+    });
+    if (needAbort) {
+      info("thread aborted ({}/{})", thread_info.m_next_x, thread_info.m_until_x);
+      return;
+    }
+    info("thread pausing ({}/{})", thread_info.m_next_x, thread_info.m_until_x);
+  }
+  info("thread finished work (until {})", thread_info.m_until_x);
+  thread_info.m_threads_finished->fetch_add(1);
+}
+
+static void init_generation_threads(GenerationContinuation& continuation) {
+  continuation.m_additional_threads.reserve(s_num_threads - 1);
+  info("initializing threads. {} {}", continuation.m_columns_per_thread, continuation.m_texture_width);
+  for (int i = 1; i < s_num_threads; ++i) { // first thread is the main thread
+    GenerationPerThreadInfo newThreadInfo {
+      .m_texture = continuation.m_main_thread_info.m_texture,
+      .m_next_x = i * continuation.m_columns_per_thread,
+      .m_until_x = calc_thread_finish(i, continuation.m_columns_per_thread, continuation.m_texture_width),
+      .m_threads_finished = continuation.m_threads_finished.get(),
+      .m_need_abort = continuation.m_need_abort.get(),
+      .m_const_shared_data_ptr = continuation.m_const_shared_data.get()
+    };
+    info("creating thread {}. Will work from {} to {}", i, newThreadInfo.m_next_x, newThreadInfo.m_until_x);
+    continuation.m_additional_threads.emplace_back(additional_thread_func, newThreadInfo);
+  }
+}
+
+static bool continue_generation(GenerationContinuation& continuation, std::chrono::milliseconds time_budget) {
+  auto startTime = std::clock(); // processor time
+  auto startRealTime = real_clock_t::now();
+
+  NoiseTexture& texture = continuation.m_main_thread_info.m_texture.get_mut<NoiseTexture>();
+  texture.mark_modified();
+
+  if (continuation.m_main_thread_info.m_next_x == continuation.m_main_thread_info.m_until_x) {
+    // main thread finished
+    std::this_thread::sleep_for(time_budget);
+  } else {
+    do_generation(continuation.m_main_thread_info, [&]{
+      auto curRealTimeSpent = real_clock_t::now() - startRealTime;
+      return curRealTimeSpent < time_budget;
+    });
+  }
+
+  info("pausing generation. Spent {}ms. {} threads finished, main finished - {}",
+    std::chrono::duration_cast<std::chrono::milliseconds>(real_clock_t::now() - startRealTime).count(),
+    continuation.m_threads_finished->load(),
+    continuation.m_main_thread_info.m_next_x == continuation.m_main_thread_info.m_until_x);
+
+  continuation.m_time_spent += std::clock() - startTime;
+  continuation.m_real_time_spent += real_clock_t::now() - startRealTime;
+
+  auto allThreadsFinished = continuation.m_threads_finished->load() == continuation.m_additional_threads.size()
+                            && continuation.m_main_thread_info.m_next_x == continuation.m_main_thread_info.m_until_x;
+  if (allThreadsFinished) {
+    for (auto& t : continuation.m_additional_threads) {
+      t.join();
+    }
+  }
+
+  return allThreadsFinished;
+}
+
+void init_threaded_generation_systems(flecs::world& ecs) {
+  ecs.system<GenerationContinuation>("Threaded noise generation")
+    .kind(flecs::OnUpdate)
+    .each([](const flecs::iter& it, size_t entity_index, GenerationContinuation& continuation) {
+      auto ecs = it.world();
+
+      if (continuation.m_post_process_thread.joinable()) {
+        if (!continuation.m_post_process_finished->load()) {
+          const float done = continuation.m_post_process_progress->load();
+          ecs.each([&ecs, done](flecs::entity entity, Menu::EventReceiver){
+            ecs.event<Menu::EventGenerationProgress>()
+              .ctx(Menu::EventGenerationProgress{ .done = done })
+              .entity(entity)
+              .emit();
+          });
+          return;
+        }
+        finish_post_process(continuation);
+      }
+
+      if (continuation.m_additional_threads.empty())
+        init_generation_threads(continuation);
+
+      bool didFinish = continue_generation(continuation, 25ms);
+      if (didFinish) {
+        ecs.each([&ecs, &continuation](flecs::entity entity, Menu::EventReceiver){
+          ecs.event<Menu::EventGenerationFinished>()
+            .ctx(Menu::EventGenerationFinished{
+              .secondsTaken = double(continuation.m_time_spent) / double(CLOCKS_PER_SEC),
+              .realDuration = continuation.m_real_time_spent,
+            })
+            .entity(entity)
+            .emit();
+        });
+        it.entity(entity_index).destruct();
+      }
+    });
+}
+
+void clear_threaded_generation(flecs::world& ecs) {
+  ecs.each([](flecs::entity entity, GenerationContinuation& continuation){
+    continuation.m_need_abort->store(true);
+    if (continuation.m_post_process_thread.joinable()) {
+      continuation.m_post_process_thread.join();
+    }
+    for (auto& thread : continuation.m_additional_threads) {
+      if (thread.joinable()) {
+        thread.join();
+      }
+    }
+    entity.destruct();
+  });
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <flecs_incl.hpp>
+#include <array>
+#include <span>
+#include <cstdint>
+#include <chrono>
+#include <ctime>
+#include <optional>
+#include <functional>
+
+
+// Fills w x h values in [0, 1] starting at (x0, y0) into out, rows are stride floats apart.
+// Called from several threads at once
+using threaded_fill_t = std::function<void(std::span<float> out, int x0, int y0, int w, int h, size_t stride)>;
+// Same with values in [0, 255], rows are stride bytes apart
+using threaded_fill_u8_t = std::function<void(std::span<uint8_t> out, int x0, int y0, int w, int h, size_t stride)>;
+// Same with colors packed as 8-bit R, G, B, A from the lowest byte up
+using threaded_fill_rgba_t = std::function<void(std::span<uint32_t> out, int x0, int y0, int w, int h, size_t stride)>;
+// Changes the whole field of w x h values stored row by row before it is drawn. progress gets the share
+// of the work done and returns false when the generation is aborted
+using threaded_post_process_t = std::function<void(std::span<float> field, int w, int h, const std::function<bool(float done)>& progress)>;
+
+// Makes what the fills read, e.g. a noise that is generated whole. progress is the same as for post processes
+using threaded_prepare_t = std::function<void(const std::function<bool(float done)>& progress)>;
+
+// Runs first and then second on the field, either may be empty. second is skipped when first is aborted.
+// The progress of first goes to [0, first_share] and the progress of second to [first_share, 1]
+threaded_post_process_t chain_post_processes(threaded_post_process_t first, threaded_post_process_t second, float first_share);
+
+struct ThreadedGenerationParams {
+  flecs::entity texture; // has NoiseTexture
+  int texture_width;
+  threaded_fill_t fill;
+  // used instead of fill when set, the colors are looked up in a palette of 256 entries
+  threaded_fill_u8_t fill_u8;
+  // used instead of the others when set, the colors are ignored
+  threaded_fill_rgba_t fill_rgba;
+  // runs on a separate thread before anything is filled, Menu::EventGenerationProgress is sent every frame meanwhile
+  threaded_prepare_t prepare;
+  // only when fill is used: the whole field is filled and post processed on a separate thread first,
+  // Menu::EventGenerationProgress is sent every frame meanwhile
+  threaded_post_process_t post_process;
+  // only when fill is used: the finished field is drawn as normals of the height field value * normal_map_height
+  // instead of colors, it is filled whole first like for a post process
+  std::optional<float> normal_map_height;
+  std::array<float, 3> color0;
+  std::array<float, 3> color1;
+
+  // spent before the generation started, e.g. on constructing the noise
+  std::clock_t time_spent = 0;
+  std::chrono::steady_clock::duration real_time_spent{};
+};
+
+// Texture columns are split between threads, values are mapped to colors between color0 and color1.
+// The main thread part runs for a few milliseconds each frame, Menu::EventGenerationFinished is sent at the end
+void start_threaded_generation(flecs::world&, ThreadedGenerationParams&& params);
+void init_threaded_generation_systems(flecs::world&);
+// Aborts the running generation and waits for its threads
+void clear_threaded_generation(flecs::world&);
@@ -1,54 +1,46 @@
 #include "white_noise_generation.hpp"
+#include "threaded_generation.hpp"
 
+#include <ctime>
+#include <random>
+#include <span>
+#include <white.hpp>
 #include <render/noise_texture.hpp>
 #include <render/drawable_bitmap.hpp>
-#include <chrono>
 
-using namespace std::chrono_literals;
 using real_clock_t = std::chrono::steady_clock;
 
 
 void generate_white_noise_texture(flecs::world& ecs, const Menu::EventGenerateWhiteNoiseTexture& event) {
-  NoiseTexture texture(event.size[0], event.size[1]);
-
-  std::random_device dev{};
-  std::default_random_engine eng(dev());
-
-  std::bernoulli_distribution distr(event.black_prob);
-
-  auto startTime = std::clock();
-
-  auto width = texture.width();
-  auto height = texture.height();
-  texture.mark_modified();
-
-  {
-  auto bitmapOverride = texture.scoped_write_to_memory_bitmap();
-  for (int x = 0; x < width; ++x) {
-    for (int y = 0; y < height; ++y) {
-      uint8_t r = distr(eng) ? 0 : 255;
-      uint8_t g = distr(eng) ? 0 : 255;
-      uint8_t b = distr(eng) ? 0 : 255;
-      texture.set(x, y, al_map_rgb(r, g, b));
-    }
-  }
-  } // end of bitmap override scope
-
-  auto timeTaken = std::clock() - startTime;
-  ecs.each([&ecs, &timeTaken](flecs::entity entity, Menu::EventReceiver){
-    ecs.event<Menu::EventGenerationFinished>()
-      .ctx(Menu::EventGenerationFinished{
-        .secondsTaken = double(timeTaken) / double(CLOCKS_PER_SEC),
-        .realDuration = 0us
-      })
-      .entity(entity)
-      .emit();
-  });
-  ecs.entity()
-    .emplace<NoiseTexture>(std::move(texture))
+  auto textureEntity = ecs.entity()
+    .emplace<NoiseTexture>(event.size[0], event.size[1])
     .emplace<DrawableBitmap>(
       Bitmap(event.size[0], event.size[1]),
       vec2{0.0f, 0.0f}
      );
-}
 
+  auto seed = [&]{
+    if (event.random_seed <= 0) {
+      std::random_device dev{};
+      return dev();
+    } else {
+      return static_cast<unsigned int>(event.random_seed);
+    }
+  }();
+
+  auto startTime = std::clock();
+  auto realStartTime = real_clock_t::now();
+
+  // nothing is stored, the noise is copied into the fill
+  const WhiteNoise noise(WhiteNoiseParameters{ .black_probability = event.black_prob }, seed);
+
+  start_threaded_generation(ecs, ThreadedGenerationParams{
+    .texture = textureEntity,
+    .texture_width = event.size[0],
+    .fill_rgba = [noise](std::span<uint32_t> out, int x0, int y0, int w, int h, size_t stride) {
+      noise.fill_rgba(out, x0, y0, w, h, stride);
+    },
+    .time_spent = std::clock() - startTime,
+    .real_time_spent = real_clock_t::now() - realStartTime
+  });
+}
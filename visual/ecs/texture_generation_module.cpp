@@ -8,12 +8,19 @@
 #include <ecs/texture_generation/interpolation_generation.hpp>
 #include <ecs/texture_generation/white_noise_generation.hpp>
 #include <ecs/texture_generation/perlin_generation.hpp>
+#include <ecs/texture_generation/simplex_generation.hpp>
+#include <ecs/texture_generation/fractal_generation.hpp>
+#include <ecs/texture_generation/worley_generation.hpp>
+#include <ecs/texture_generation/spectral_generation.hpp>
+#include <ecs/texture_generation/blue_noise_generation.hpp>
+#include <ecs/texture_generation/threaded_generation.hpp>
+#include <ecs/texture_generation/sequence_export.hpp>
 
 
 static flecs::entity s_menu_event_receiver;
 
 static void clear_previous_texture(flecs::world& ecs) {
-  clear_perlin_noise_continuation(ecs);
+  clear_threaded_generation(ecs);
   ecs.each([](flecs::entity entity, const NoiseTexture&){
     entity.destruct();
   });
@@ -32,6 +39,8 @@ TextureGenerationModule::TextureGenerationModule(flecs::world& ecs) {
       generate_white_noise_texture(ecs, event);
     });
 
+  init_threaded_generation_systems(ecs);
+
   init_perlin_systems_generation_systems(ecs);
   m_menu_event_receiver
     .observe([&ecs](const Menu::EventGeneratePerlinNoiseTexture& event){
@@ -39,6 +48,42 @@ TextureGenerationModule::TextureGenerationModule(flecs::world& ecs) {
       generate_perlin_noise_texture(ecs, event);
     });
 
+  m_menu_event_receiver
+    .observe([&ecs](const Menu::EventGenerateSimplexNoiseTexture& event){
+      clear_previous_texture(ecs);
+      generate_simplex_noise_texture(ecs, event);
+    });
+
+  m_menu_event_receiver
+    .observe([&ecs](const Menu::EventGenerateFractalNoiseTexture& event){
+      clear_previous_texture(ecs);
+      generate_fractal_noise_texture(ecs, event);
+    });
+
+  m_menu_event_receiver
+    .observe([&ecs](const Menu::EventGenerateWorleyNoiseTexture& event){
+      clear_previous_texture(ecs);
+      generate_worley_noise_texture(ecs, event);
+    });
+
+  m_menu_event_receiver
+    .observe([&ecs](const Menu::EventGenerateSpectralNoiseTexture& event){
+      clear_previous_texture(ecs);
+      generate_spectral_noise_texture(ecs, event);
+    });
+
+  m_menu_event_receiver
+    .observe([&ecs](const Menu::EventGenerateBlueNoiseTexture& event){
+      clear_previous_texture(ecs);
+      generate_blue_noise_texture(ecs, event);
+    });
+
+  init_sequence_export_systems(ecs);
+  m_menu_event_receiver
+    .observe([&ecs](const Menu::EventExportNoiseSequence& event) {
+      export_noise_sequence(ecs, event);
+    });
+
   init_interpolated_generation_systems(ecs);
   m_menu_event_receiver
     .observe([&ecs](const Menu::EventGenerateInterpolatedTexture& event) {
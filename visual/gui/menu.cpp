@@ -6,6 +6,7 @@
 #include <render/noise_texture.hpp>
 #include <render/drawable_bitmap.hpp>
 #include <format>
+#include <utility>
 #include <log.hpp>
 #ifndef __EMSCRIPTEN__
 #include <ImGuiFileDialog.h>
@@ -28,6 +29,12 @@ Menu::Menu(flecs::world& ecs, flecs::entity menu_eid) {
     .observe([this](const Menu::EventGenerationFinished& event){
       m_last_generation_time_seconds = event.secondsTaken;
       m_last_generation_real_time = event.realDuration;
+      m_post_process_progress = -1.0f;
+    });
+
+  m_event_receiver
+    .observe([this](const Menu::EventGenerationProgress& event){
+      m_post_process_progress = event.done;
     });
 }
 
@@ -56,16 +63,88 @@ static void camera_info(CameraState& state) {
 static void white_noise_menu(Menu::EventGenerateWhiteNoiseTexture& white_noise_params) {
   ImGui::SliderInt2("Texture size", white_noise_params.size, 1, 10000, "%d", ImGuiSliderFlags_AlwaysClamp);
   ImGui::SliderFloat("Black probability", &white_noise_params.black_prob, 0.0f, 1.0f);
+  ImGui::SliderInt("Random seed", &white_noise_params.random_seed, 0, 10000);
+}
+
+static void erosion_menu(ErosionSettings& erosion) {
+  ImGui::Checkbox("Erosion", &erosion.enabled);
+  if (!erosion.enabled) {
+    return;
+  }
+  auto& parameters = erosion.parameters;
+  ImGui::SliderFloat("Droplets per pixel", &parameters.droplets_per_pixel, 0.0f, 10.0f);
+  ImGui::SliderInt("Droplet lifetime", &parameters.droplet_lifetime, 1, 100, "%d", ImGuiSliderFlags_AlwaysClamp);
+  ImGui::SliderFloat("Inertia", &parameters.inertia, 0.0f, 1.0f);
+  ImGui::SliderFloat("Sediment capacity", &parameters.sediment_capacity, 0.0f, 16.0f);
+  ImGui::SliderFloat("Erode speed", &parameters.erode_speed, 0.0f, 1.0f);
+  ImGui::SliderFloat("Deposit speed", &parameters.deposit_speed, 0.0f, 1.0f);
+  ImGui::SliderFloat("Evaporate speed", &parameters.evaporate_speed, 0.0f, 0.5f);
+  ImGui::SliderInt("Erosion radius", &parameters.erosion_radius, 1, 8, "%d", ImGuiSliderFlags_AlwaysClamp);
+  ImGui::SliderInt("Thermal iterations", &parameters.thermal_iterations, 0, 500, "%d", ImGuiSliderFlags_AlwaysClamp);
+  ImGui::SliderFloat("Talus", &parameters.talus, 0.0f, 0.1f, "%.4f");
+  ImGui::SliderFloat("Thermal rate", &parameters.thermal_rate, 0.0f, 1.0f);
+}
+
+static void filters_menu(FilterSettings& filters) {
+  ImGui::Checkbox("Filters", &filters.enabled);
+  if (!filters.enabled) {
+    return;
+  }
+  auto& parameters = filters.parameters;
+  const char* kernels[] = {"none", "gaussian", "box", "unsharp mask"};
+  int kernel = int(parameters.kernel);
+  ImGui::ListBox("Kernel", &kernel, kernels, sizeof(kernels) / sizeof(const char*), 4);
+  parameters.kernel = FilterParameters::Kernel(kernel);
+  if (parameters.kernel != FilterParameters::Kernel::none) {
+    ImGui::SliderFloat("Kernel radius", &parameters.radius, 0.5f, 32.0f);
+  }
+  if (parameters.kernel == FilterParameters::Kernel::unsharp) {
+    ImGui::SliderFloat("Amount", &parameters.amount, 0.0f, 5.0f);
+  }
+  ImGui::SliderFloat("Input black", &parameters.in_black, 0.0f, 1.0f);
+  ImGui::SliderFloat("Input white", &parameters.in_white, 0.0f, 1.0f);
+  ImGui::SliderFloat("Gamma", &parameters.gamma, 0.1f, 5.0f);
+  ImGui::SliderFloat("Output black", &parameters.out_black, 0.0f, 1.0f);
+  ImGui::SliderFloat("Output white", &parameters.out_white, 0.0f, 1.0f);
 }
 
 static void perlin_noise_menu(flecs::world& ecs, Menu::EventGeneratePerlinNoiseTexture& perlin_noise_params, flecs::entity menu_event_receiver) {
   ImGui::SliderInt2("Texture size", perlin_noise_params.size, 1, 10000, "%d", ImGuiSliderFlags_AlwaysClamp);
-  ImGui::SliderInt2("Vector grid size", perlin_noise_params.grid_size, 1, 10000);
-  ImGui::SliderFloat2("Grid step", perlin_noise_params.grid_step, 0.1f, 10000.0f);
+  ImGui::Checkbox("Tileable", &perlin_noise_params.tileable);
+  if (perlin_noise_params.tileable) {
+    ImGui::SliderInt2("Period (cells)", perlin_noise_params.period, 1, 1000, "%d", ImGuiSliderFlags_AlwaysClamp);
+  } else {
+    ImGui::SliderInt2("Vector grid size", perlin_noise_params.grid_size, 1, 10000);
+    ImGui::SliderFloat2("Grid step", perlin_noise_params.grid_step, 0.1f, 10000.0f);
+  }
   ImGui::Checkbox("Normalize offset vectors", &perlin_noise_params.normalize_offsets);
   const char* algorithms[] = {"bilinear", "bicubic (derivative from grid)", "bicubic (zero derivative)", "nearest neighboor"};
   int algo = int(perlin_noise_params.interpolation_algorithm);
   ImGui::ListBox("Interpolation", &algo, algorithms, sizeof(algorithms) / sizeof(const char*), 3);
+  const char* gradientSources[] = {"stored grid", "quantized grid (8 bit)", "hashed (unbounded)"};
+  int gradientSource = int(perlin_noise_params.gradient_source);
+  ImGui::ListBox("Gradients", &gradientSource, gradientSources, sizeof(gradientSources) / sizeof(const char*), 3);
+  ImGui::SliderInt("Domain warp levels", &perlin_noise_params.warp_levels, 0, DomainWarp::s_max_levels, "%d", ImGuiSliderFlags_AlwaysClamp);
+  if (perlin_noise_params.warp_levels > 0) {
+    ImGui::SliderFloat2("Warp grid step", perlin_noise_params.warp_grid_step, 0.1f, 10000.0f);
+    ImGui::SliderFloat("Warp strength", &perlin_noise_params.warp_strength, 0.0f, 1000.0f);
+  } else {
+    auto& supersampling = perlin_noise_params.supersampling;
+    ImGui::SliderInt("Supersampling (per axis)", &supersampling.samples, 1, Supersampling::s_max_samples, "%d", ImGuiSliderFlags_AlwaysClamp);
+    if (supersampling.samples > 1) {
+      bool rotated = supersampling.pattern == Supersampling::Pattern::rotated_grid;
+      ImGui::Checkbox("Rotated grid", &rotated);
+      supersampling.pattern = rotated ? Supersampling::Pattern::rotated_grid : Supersampling::Pattern::grid;
+    } else {
+      ImGui::SliderFloat("Dither", &perlin_noise_params.dither, 0.0f, 0.1f, "%.4f");
+    }
+  }
+  erosion_menu(perlin_noise_params.erosion);
+  filters_menu(perlin_noise_params.filters);
+  ImGui::Checkbox("Normal map", &perlin_noise_params.normal_map);
+  if (perlin_noise_params.normal_map) {
+    ImGui::SliderFloat("Normal map height", &perlin_noise_params.normal_map_height, 0.0f, 1000.0f);
+  }
 
   ImGui::Text("Colors:");
   ImGui::SameLine();
@@ -75,6 +154,7 @@ static void perlin_noise_menu(flecs::world& ecs, Menu::EventGeneratePerlinNoiseT
 
   ImGui::SliderInt("Random seed", &perlin_noise_params.random_seed, 0, 10000);
   perlin_noise_params.interpolation_algorithm = PerlinNoiseParameters::InterpolationAlgorithm(algo);
+  perlin_noise_params.gradient_source = PerlinNoiseParameters::GradientSource(gradientSource);
   if (ImGui::Button("Show gradients")) {
     ecs.event<Menu::EventShowPerlinGradients>()
       .entity(menu_event_receiver)
@@ -90,6 +170,112 @@ static void perlin_noise_menu(flecs::world& ecs, Menu::EventGeneratePerlinNoiseT
   }
 }
 
+static void simplex_noise_menu(Menu::EventGenerateSimplexNoiseTexture& simplex_noise_params) {
+  ImGui::SliderInt2("Texture size", simplex_noise_params.size, 1, 10000, "%d", ImGuiSliderFlags_AlwaysClamp);
+  ImGui::SliderFloat2("Grid step", simplex_noise_params.grid_step, 0.1f, 10000.0f);
+
+  filters_menu(simplex_noise_params.filters);
+
+  ImGui::Text("Colors:");
+  ImGui::SameLine();
+  ImGui::ColorEdit3("0.0", simplex_noise_params.color0, ImGuiColorEditFlags_NoInputs);
+  ImGui::SameLine();
+  ImGui::ColorEdit3("1.0", simplex_noise_params.color1, ImGuiColorEditFlags_NoInputs);
+
+  ImGui::SliderInt("Random seed", &simplex_noise_params.random_seed, 0, 10000);
+}
+
+static void fractal_noise_menu(Menu::EventGenerateFractalNoiseTexture& fractal_noise_params) {
+  ImGui::SliderInt2("Texture size", fractal_noise_params.size, 1, 10000, "%d", ImGuiSliderFlags_AlwaysClamp);
+  ImGui::SliderFloat2("Grid step", fractal_noise_params.grid_step, 0.1f, 10000.0f);
+  ImGui::SliderInt("Octaves", &fractal_noise_params.octaves, 1, FractalNoise::s_max_octaves, "%d", ImGuiSliderFlags_AlwaysClamp);
+  ImGui::SliderFloat("Lacunarity", &fractal_noise_params.lacunarity, 1.0f, 4.0f);
+  ImGui::SliderFloat("Gain", &fractal_noise_params.gain, 0.0f, 1.0f);
+  const char* bases[] = {"perlin", "simplex"};
+  int basis = int(fractal_noise_params.basis);
+  ImGui::ListBox("Basis", &basis, bases, sizeof(bases) / sizeof(const char*), 2);
+  const char* variants[] = {"fBm", "billow", "turbulence", "ridged"};
+  int variant = int(fractal_noise_params.variant);
+  ImGui::ListBox("Variant", &variant, variants, sizeof(variants) / sizeof(const char*), 4);
+  erosion_menu(fractal_noise_params.erosion);
+  filters_menu(fractal_noise_params.filters);
+
+  ImGui::Text("Colors:");
+  ImGui::SameLine();
+  ImGui::ColorEdit3("0.0", fractal_noise_params.color0, ImGuiColorEditFlags_NoInputs);
+  ImGui::SameLine();
+  ImGui::ColorEdit3("1.0", fractal_noise_params.color1, ImGuiColorEditFlags_NoInputs);
+
+  ImGui::SliderInt("Random seed", &fractal_noise_params.random_seed, 0, 10000);
+  fractal_noise_params.basis = FractalNoiseParameters::Basis(basis);
+  fractal_noise_params.variant = FractalNoiseParameters::Variant(variant);
+}
+
+static void worley_noise_menu(Menu::EventGenerateWorleyNoiseTexture& worley_noise_params) {
+  ImGui::SliderInt2("Texture size", worley_noise_params.size, 1, 10000, "%d", ImGuiSliderFlags_AlwaysClamp);
+  ImGui::SliderFloat2("Grid step", worley_noise_params.grid_step, 0.1f, 10000.0f);
+  ImGui::SliderFloat("Jitter", &worley_noise_params.jitter, 0.0f, 1.0f);
+  const char* metrics[] = {"euclidean", "manhattan", "chebyshev"};
+  int metric = int(worley_noise_params.metric);
+  ImGui::ListBox("Distance", &metric, metrics, sizeof(metrics) / sizeof(const char*), 3);
+  const char* features[] = {"F1", "F2", "F2 - F1"};
+  int feature = int(worley_noise_params.feature);
+  ImGui::ListBox("Feature", &feature, features, sizeof(features) / sizeof(const char*), 3);
+
+  filters_menu(worley_noise_params.filters);
+
+  ImGui::Text("Colors:");
+  ImGui::SameLine();
+  ImGui::ColorEdit3("0.0", worley_noise_params.color0, ImGuiColorEditFlags_NoInputs);
+  ImGui::SameLine();
+  ImGui::ColorEdit3("1.0", worley_noise_params.color1, ImGuiColorEditFlags_NoInputs);
+
+  ImGui::SliderInt("Random seed", &worley_noise_params.random_seed, 0, 10000);
+  worley_noise_params.metric = WorleyNoiseParameters::Metric(metric);
+  worley_noise_params.feature = WorleyNoiseParameters::Feature(feature);
+}
+
+static void spectral_noise_menu(Menu::EventGenerateSpectralNoiseTexture& spectral_noise_params) {
+  ImGui::SliderInt2("Texture size", spectral_noise_params.size, 1, 10000, "%d", ImGuiSliderFlags_AlwaysClamp);
+  ImGui::SliderFloat("Exponent", &spectral_noise_params.exponent, -2.0f, 4.0f);
+  // power of 1 / f for the usual colors
+  const std::pair<const char*, float> colors[] = {{"violet", -2.0f}, {"blue", -1.0f}, {"white", 0.0f}, {"pink", 1.0f}, {"brown", 2.0f}};
+  for (const auto& [name, exponent] : colors) {
+    if (ImGui::Button(name)) {
+      spectral_noise_params.exponent = exponent;
+    }
+    ImGui::SameLine();
+  }
+  ImGui::NewLine();
+  ImGui::SliderFloat("Min wavelength", &spectral_noise_params.min_wavelength, 2.0f, 1000.0f);
+  ImGui::SliderFloat("Max wavelength (0 - any)", &spectral_noise_params.max_wavelength, 0.0f, 10000.0f);
+
+  filters_menu(spectral_noise_params.filters);
+
+  ImGui::Text("Colors:");
+  ImGui::SameLine();
+  ImGui::ColorEdit3("0.0", spectral_noise_params.color0, ImGuiColorEditFlags_NoInputs);
+  ImGui::SameLine();
+  ImGui::ColorEdit3("1.0", spectral_noise_params.color1, ImGuiColorEditFlags_NoInputs);
+
+  ImGui::SliderInt("Random seed", &spectral_noise_params.random_seed, 0, 10000);
+}
+
+static void blue_noise_menu(Menu::EventGenerateBlueNoiseTexture& blue_noise_params) {
+  // every rank updates the energy around one pixel and rescans the tiles it touched, 1024 x 1024 takes several seconds
+  ImGui::SliderInt2("Texture size", blue_noise_params.size, 1, 1024, "%d", ImGuiSliderFlags_AlwaysClamp);
+  ImGui::SliderFloat("Sigma", &blue_noise_params.sigma, 0.5f, 4.0f);
+  ImGui::SliderFloat("Initial density", &blue_noise_params.initial_density, 0.01f, 0.5f);
+
+  ImGui::Text("Colors:");
+  ImGui::SameLine();
+  ImGui::ColorEdit3("0.0", blue_noise_params.color0, ImGuiColorEditFlags_NoInputs);
+  ImGui::SameLine();
+  ImGui::ColorEdit3("1.0", blue_noise_params.color1, ImGuiColorEditFlags_NoInputs);
+
+  ImGui::SliderInt("Random seed", &blue_noise_params.random_seed, 0, 10000);
+}
+
 
 static void interpolation_menu(flecs::world& ecs, Menu::EventGenerateInterpolatedTexture& interpolated_texture_params, flecs::entity menu_event_receiver) {
   ImGui::SliderInt2("Texture size", interpolated_texture_params.size, 1, 10000, "%d", ImGuiSliderFlags_AlwaysClamp);
@@ -163,6 +349,35 @@ static void native_save_dialog(flecs::world& ecs) {
     ImGuiFileDialog::Instance()->Close();
   }
 }
+
+static void sequence_export_menu(flecs::world& ecs, Menu::EventExportNoiseSequence& sequence_params, flecs::entity menu_event_receiver) {
+  ImGui::SliderInt2("Frame size", sequence_params.size, 1, 10000, "%d", ImGuiSliderFlags_AlwaysClamp);
+  ImGui::SliderFloat2("Grid step##sequence", sequence_params.grid_step, 0.1f, 10000.0f);
+  ImGui::SliderFloat("Time step", &sequence_params.time_step, 0.001f, 1.0f);
+  ImGui::SliderInt("Frames", &sequence_params.frame_count, 1, 10000, "%d", ImGuiSliderFlags_AlwaysClamp);
+  ImGui::Checkbox("Loop", &sequence_params.loop);
+  ImGui::SliderInt("Fps", &sequence_params.fps, 1, 120, "%d", ImGuiSliderFlags_AlwaysClamp);
+  ImGui::SliderInt("Random seed##sequence", &sequence_params.random_seed, 0, 10000);
+
+  const char* const fileDialogKey = "sequence_export_dialog_key";
+  if (ImGui::Button("Export")) {
+    ImGuiFileDialog::Instance()->OpenDialog(fileDialogKey, "Choose file", ".y4m,.pgm", ".", 1, nullptr, ImGuiFileDialogFlags_Modal | ImGuiFileDialogFlags_ConfirmOverwrite);
+  }
+
+  if (ImGuiFileDialog::Instance()->Display(fileDialogKey)) {
+    if (ImGuiFileDialog::Instance()->IsOk()) {
+      sequence_params.path = ImGuiFileDialog::Instance()->GetFilePathName();
+      info("exporting sequence to \"{}\"", sequence_params.path.c_str());
+      ecs.event<Menu::EventExportNoiseSequence>()
+        .ctx(sequence_params)
+        .id<Menu::EventReceiver>()
+        .entity(menu_event_receiver)
+        .emit();
+    }
+
+    ImGuiFileDialog::Instance()->Close();
+  }
+}
 #else // __EMSCRIPTEN__
 static void web_save_button(flecs::world& ecs) {
   if (ImGui::Button("Save")) {
@@ -246,12 +461,15 @@ void Menu::draw(flecs::world& ecs) {
     ImGui::SameLine();
     ImGui::Text("%.1f %s real time", value, name);
   }
+  if (m_post_process_progress >= 0.0f) {
+    ImGui::ProgressBar(m_post_process_progress, ImVec2(-1.0f, 0.0f), "Generating");
+  }
   
   ImGui::Separator();
   ImGui::Separator();
 
   // Generate new texture
-  ImGui::ListBox("Noise type", &(m_noise_idx), s_noises.data(), int(s_noises.size()), 3);
+  ImGui::ListBox("Noise type", &(m_noise_idx), s_noises.data(), int(s_noises.size()), 8);
   ImGui::Separator();
   if (m_noise_idx == int(MenuNoisesIndices::white)) {
     white_noise_menu(m_white_noise_params);
@@ -259,6 +477,16 @@ void Menu::draw(flecs::world& ecs) {
     perlin_noise_menu(ecs, m_perlin_noise_params, m_event_receiver);
   } else if (m_noise_idx == int(MenuNoisesIndices::interpolation)) {
     interpolation_menu(ecs, m_interpolated_texture_params, m_event_receiver);
+  } else if (m_noise_idx == int(MenuNoisesIndices::simplex)) {
+    simplex_noise_menu(m_simplex_noise_params);
+  } else if (m_noise_idx == int(MenuNoisesIndices::fractal)) {
+    fractal_noise_menu(m_fractal_noise_params);
+  } else if (m_noise_idx == int(MenuNoisesIndices::worley)) {
+    worley_noise_menu(m_worley_noise_params);
+  } else if (m_noise_idx == int(MenuNoisesIndices::spectral)) {
+    spectral_noise_menu(m_spectral_noise_params);
+  } else if (m_noise_idx == int(MenuNoisesIndices::blue)) {
+    blue_noise_menu(m_blue_noise_params);
   }
 
   static bool initialGenerationComplete = false;
@@ -288,6 +516,46 @@ void Menu::draw(flecs::world& ecs) {
         .emit();
       m_current_texture_size[0] = m_interpolated_texture_params.size[0];
       m_current_texture_size[1] = m_interpolated_texture_params.size[1];
+    } else if (m_noise_idx == int(MenuNoisesIndices::simplex)) {
+      ecs.event<Menu::EventGenerateSimplexNoiseTexture>()
+        .ctx(m_simplex_noise_params)
+        .id<Menu::EventReceiver>()
+        .entity(m_event_receiver)
+        .emit();
+      m_current_texture_size[0] = m_simplex_noise_params.size[0];
+      m_current_texture_size[1] = m_simplex_noise_params.size[1];
+    } else if (m_noise_idx == int(MenuNoisesIndices::fractal)) {
+      ecs.event<Menu::EventGenerateFractalNoiseTexture>()
+        .ctx(m_fractal_noise_params)
+        .id<Menu::EventReceiver>()
+        .entity(m_event_receiver)
+        .emit();
+      m_current_texture_size[0] = m_fractal_noise_params.size[0];
+      m_current_texture_size[1] = m_fractal_noise_params.size[1];
+    } else if (m_noise_idx == int(MenuNoisesIndices::worley)) {
+      ecs.event<Menu::EventGenerateWorleyNoiseTexture>()
+        .ctx(m_worley_noise_params)
+        .id<Menu::EventReceiver>()
+        .entity(m_event_receiver)
+        .emit();
+      m_current_texture_size[0] = m_worley_noise_params.size[0];
+      m_current_texture_size[1] = m_worley_noise_params.size[1];
+    } else if (m_noise_idx == int(MenuNoisesIndices::spectral)) {
+      ecs.event<Menu::EventGenerateSpectralNoiseTexture>()
+        .ctx(m_spectral_noise_params)
+        .id<Menu::EventReceiver>()
+        .entity(m_event_receiver)
+        .emit();
+      m_current_texture_size[0] = m_spectral_noise_params.size[0];
+      m_current_texture_size[1] = m_spectral_noise_params.size[1];
+    } else if (m_noise_idx == int(MenuNoisesIndices::blue)) {
+      ecs.event<Menu::EventGenerateBlueNoiseTexture>()
+        .ctx(m_blue_noise_params)
+        .id<Menu::EventReceiver>()
+        .entity(m_event_receiver)
+        .emit();
+      m_current_texture_size[0] = m_blue_noise_params.size[0];
+      m_current_texture_size[1] = m_blue_noise_params.size[1];
     }
   }
 
@@ -298,6 +566,13 @@ void Menu::draw(flecs::world& ecs) {
   web_save_button(ecs);
 #endif
 
+#ifndef __EMSCRIPTEN__
+  ImGui::Separator();
+  if (ImGui::CollapsingHeader("Animated noise export")) {
+    sequence_export_menu(ecs, m_sequence_export_params, m_event_receiver);
+  }
+#endif
+
   // TODO: show statistics? Like distribution of colors?
 }
 
@@ -5,19 +5,40 @@
 #include <ecs/camera_module.hpp>
 #include <ecs/util.hpp>
 #include <chrono>
+#include <string>
 #include <perlin.hpp>
+#include <warp.hpp>
+#include <fractal.hpp>
+#include <worley.hpp>
+#include <spectral.hpp>
+#include <blue_noise.hpp>
+#include <erosion.hpp>
+#include <filters.hpp>
 
-enum class MenuNoisesIndices { perlin, interpolation, white };
-static constexpr std::array s_noises {"perlin", "interpolation", "white"};
+enum class MenuNoisesIndices { perlin, interpolation, white, simplex, fractal, worley, spectral, blue };
+static constexpr std::array s_noises {"perlin", "interpolation", "white", "simplex", "fractal", "worley", "spectral", "blue"};
 
 // its nice to have default size be divided by 3, so interpolation example looks good by default
 constexpr int s_default_texture_size = 900;
 
+// Erosion of the noise as a heightmap, done on the whole field before it is drawn
+struct ErosionSettings {
+  bool enabled = false;
+  ErosionParameters parameters;
+};
+
+// Separable kernel and levels on the whole field before it is drawn, after the erosion
+struct FilterSettings {
+  bool enabled = false;
+  FilterParameters parameters;
+};
+
 class Menu : public GuiMenuContents {
 public:
   struct EventGenerateWhiteNoiseTexture {
     int size[2] = {s_default_texture_size, s_default_texture_size};
     float black_prob = 0.5f;
+    int random_seed = 0;
   };
 
   struct EventGeneratePerlinNoiseTexture {
@@ -31,6 +52,94 @@ public:
     float color1[3] = {1,1,1};
     bool normalize_offsets = false;
     PerlinNoiseParameters::InterpolationAlgorithm interpolation_algorithm = PerlinNoiseParameters::InterpolationAlgorithm::bicubic;
+    PerlinNoiseParameters::GradientSource gradient_source = PerlinNoiseParameters::GradientSource::grid;
+    // the texture is one period of the noise with period cells, the grid step is fitted to it
+    bool tileable = false;
+    int period[2] = {8, 8};
+    // 0 disables the domain warp
+    int warp_levels = 0;
+    float warp_grid_step[2] = {120.0f, 120.0f};
+    float warp_strength = 40.0f;
+    // normals instead of the colors, the field after all the other options is a height field with values
+    // up to normal_map_height
+    bool normal_map = false;
+    float normal_map_height = 30.0f;
+    // averaged samples per pixel against aliasing, not used with the warp
+    Supersampling supersampling;
+    // amplitude of white noise added against banding, only without the warp and supersampling
+    float dither = 0.0f;
+    ErosionSettings erosion;
+    FilterSettings filters;
+    int random_seed = 0;
+  };
+
+  struct EventGenerateSimplexNoiseTexture {
+    int size[2] = {s_default_texture_size, s_default_texture_size};
+
+    float grid_step[2] = {30.0f, 30.0f};
+
+    float offset[2] = {0.0f, 0.0f};
+    float color0[3] = {0,0,0};
+    float color1[3] = {1,1,1};
+    FilterSettings filters;
+    int random_seed = 0;
+  };
+
+  struct EventGenerateFractalNoiseTexture {
+    int size[2] = {s_default_texture_size, s_default_texture_size};
+
+    float grid_step[2] = {300.0f, 300.0f};
+
+    float offset[2] = {0.0f, 0.0f};
+    int octaves = 6;
+    float lacunarity = 2.0f;
+    float gain = 0.5f;
+    FractalNoiseParameters::Basis basis = FractalNoiseParameters::Basis::perlin;
+    FractalNoiseParameters::Variant variant = FractalNoiseParameters::Variant::fbm;
+    float color0[3] = {0,0,0};
+    float color1[3] = {1,1,1};
+    ErosionSettings erosion;
+    FilterSettings filters;
+    int random_seed = 0;
+  };
+
+  struct EventGenerateWorleyNoiseTexture {
+    int size[2] = {s_default_texture_size, s_default_texture_size};
+
+    float grid_step[2] = {60.0f, 60.0f};
+
+    float offset[2] = {0.0f, 0.0f};
+    float jitter = 1.0f;
+    WorleyNoiseParameters::Metric metric = WorleyNoiseParameters::Metric::euclidean;
+    WorleyNoiseParameters::Feature feature = WorleyNoiseParameters::Feature::f1;
+    float color0[3] = {0,0,0};
+    float color1[3] = {1,1,1};
+    FilterSettings filters;
+    int random_seed = 0;
+  };
+
+  // Colored 1/f^exponent noise, the texture is one period of it when the size is a power of two
+  struct EventGenerateSpectralNoiseTexture {
+    int size[2] = {s_default_texture_size, s_default_texture_size};
+
+    float exponent = 1.0f;
+    float min_wavelength = 2.0f;
+    // 0 is the texture size
+    float max_wavelength = 0.0f;
+    float color0[3] = {0,0,0};
+    float color1[3] = {1,1,1};
+    FilterSettings filters;
+    int random_seed = 0;
+  };
+
+  // Void-and-cluster threshold map, the texture is one period of it
+  struct EventGenerateBlueNoiseTexture {
+    int size[2] = {256, 256};
+
+    float sigma = 1.5f;
+    float initial_density = 0.1f;
+    float color0[3] = {0,0,0};
+    float color1[3] = {1,1,1};
     int random_seed = 0;
   };
 
@@ -47,6 +156,18 @@ public:
     } algorithm = Algorithm::bicubic;
   };
 
+  // Gradient noise moving through time, written to a .y4m stream or to numbered .pgm files
+  struct EventExportNoiseSequence {
+    int size[2] = {512, 512};
+    float grid_step[2] = {60.0f, 60.0f};
+    float time_step = 0.05f;
+    int frame_count = 120;
+    bool loop = true;
+    int fps = 30;
+    int random_seed = 0;
+    std::string path;
+  };
+
   struct EventReceiver{};
 
   struct EventGenerationFinished{
@@ -54,6 +175,11 @@ public:
     std::chrono::steady_clock::duration realDuration;
   };
 
+  // sent every frame while the generation prepares or post processes the field
+  struct EventGenerationProgress{
+    float done;
+  };
+
   struct EventShowInterpTruePixels : public EmptyEvent {};
   struct EventHideInterpTruePixels : public EmptyEvent {};
 
@@ -72,9 +198,17 @@ private:
   int m_current_texture_size[2] = {0, 0};
   double m_last_generation_time_seconds = 0.0;
   std::chrono::steady_clock::duration m_last_generation_real_time{};
+  // share of the post process done, negative when there is none running
+  float m_post_process_progress = -1.0f;
 
   EventGenerateWhiteNoiseTexture m_white_noise_params;
   EventGeneratePerlinNoiseTexture m_perlin_noise_params;
   EventGenerateInterpolatedTexture m_interpolated_texture_params;
+  EventGenerateSimplexNoiseTexture m_simplex_noise_params;
+  EventGenerateFractalNoiseTexture m_fractal_noise_params;
+  EventGenerateWorleyNoiseTexture m_worley_noise_params;
+  EventGenerateSpectralNoiseTexture m_spectral_noise_params;
+  EventGenerateBlueNoiseTexture m_blue_noise_params;
+  EventExportNoiseSequence m_sequence_export_params;
 };
 
@@ -1,5 +1,7 @@
 #include "noise_texture.hpp"
 
+#include <algorithm>
+
 
 NoiseTexture::NoiseTexture(int width, int height)
   : m_memory_bitmap(width, height, ALLEGRO_MEMORY_BITMAP)
@@ -21,6 +23,35 @@ void NoiseTexture::set(int x, int y, ALLEGRO_COLOR color) {
   al_put_pixel(x, y, color);
 }
 
+void NoiseTexture::set_rgba(int x0, int y0, int w, int h, std::span<const uint32_t> pixels, size_t stride) {
+  const ALLEGRO_LOCKED_REGION* region = m_locked_memory_bitmap;
+  // ABGR_8888 keeps R in the lowest byte like the packed colors, ARGB_8888 has R and B swapped
+  const bool rgba = region != nullptr
+    && (region->format == ALLEGRO_PIXEL_FORMAT_ABGR_8888 || region->format == ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE);
+  const bool bgra = region != nullptr && region->format == ALLEGRO_PIXEL_FORMAT_ARGB_8888;
+  if (!rgba && !bgra) {
+    for (int y = 0; y < h; ++y) {
+      for (int x = 0; x < w; ++x) {
+        const uint32_t pixel = pixels[size_t(y) * stride + size_t(x)];
+        set(x0 + x, y0 + y, al_map_rgba(pixel & 0xff, (pixel >> 8) & 0xff, (pixel >> 16) & 0xff, pixel >> 24));
+      }
+    }
+    return;
+  }
+
+  for (int y = 0; y < h; ++y) {
+    const uint32_t* in = pixels.data() + size_t(y) * stride;
+    auto* out = reinterpret_cast<uint32_t*>(static_cast<uint8_t*>(region->data) + ptrdiff_t(y0 + y) * region->pitch) + x0;
+    if (rgba) {
+      std::copy_n(in, w, out);
+    } else {
+      std::transform(in, in + w, out, [](uint32_t pixel) {
+        return (pixel & 0xff00ff00u) | ((pixel & 0xffu) << 16) | ((pixel >> 16) & 0xffu);
+      });
+    }
+  }
+}
+
 ALLEGRO_COLOR NoiseTexture::get(int x, int y) {
   return al_get_pixel(m_memory_bitmap.get_raw(), x, y);
 }
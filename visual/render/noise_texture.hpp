@@ -4,12 +4,17 @@
 #include <shared_mutex>
 #include <memory>
 #include <atomic>
+#include <span>
+#include <cstdint>
 
 
 struct NoiseTexture {
   NoiseTexture(int width, int height);
 
   void set(int x, int y, ALLEGRO_COLOR color);
+  // w x h colors packed as 8-bit R, G, B, A from the lowest byte up, rows are stride pixels apart.
+  // Rows are copied straight into the locked bitmap when it is 32-bit RGBA or BGRA
+  void set_rgba(int x0, int y0, int w, int h, std::span<const uint32_t> pixels, size_t stride);
 
   TargetBitmapOverride scoped_write_to_memory_bitmap();
   void mark_modified();
@@ -23,7 +28,7 @@ struct NoiseTexture {
 
   Bitmap m_memory_bitmap;
 
-  ALLEGRO_LOCKED_REGION* m_locked_memory_bitmap;
+  ALLEGRO_LOCKED_REGION* m_locked_memory_bitmap = nullptr; // locked between draws
   bool m_was_modified_during_update = true; // to update gpu state on creation
   std::unique_ptr<std::shared_mutex> m_memory_bitmap_mutex;
   std::unique_ptr<std::atomic<bool>> m_prepearing_for_draw;